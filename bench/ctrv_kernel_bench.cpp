@@ -0,0 +1,217 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../src/ctrv_kernel.hpp"
+#include "../src/fast_trig.hpp"
+
+using namespace std;
+
+/**
+ * Column by column reference implementation, as UKF::Prediction used to do it.
+ */
+void predictReference(const double *Xsig_aug, double *Xsig_pred, int n, double delta_t) {
+    for (int i = 0; i < n; i++) {
+        double p_x = Xsig_aug[i];
+        double p_y = Xsig_aug[n + i];
+        double v = Xsig_aug[2 * n + i];
+        double yaw = Xsig_aug[3 * n + i];
+        double yawd = Xsig_aug[4 * n + i];
+        double nu_a = Xsig_aug[5 * n + i];
+        double nu_yawdd = Xsig_aug[6 * n + i];
+
+        double px_p, py_p;
+        if (fabs(yawd) > 0.001) {
+            px_p = p_x + v / yawd * (sin(yaw + yawd * delta_t) - sin(yaw));
+            py_p = p_y + v / yawd * (cos(yaw) - cos(yaw + yawd * delta_t));
+        } else {
+            px_p = p_x + v * delta_t * cos(yaw);
+            py_p = p_y + v * delta_t * sin(yaw);
+        }
+
+        Xsig_pred[i] = px_p + 0.5 * nu_a * delta_t * delta_t * cos(yaw);
+        Xsig_pred[n + i] = py_p + 0.5 * nu_a * delta_t * delta_t * sin(yaw);
+        Xsig_pred[2 * n + i] = v + nu_a * delta_t;
+        Xsig_pred[3 * n + i] = yaw + yawd * delta_t + 0.5 * nu_yawdd * delta_t * delta_t;
+        Xsig_pred[4 * n + i] = yawd + nu_yawdd * delta_t;
+    }
+}
+
+/**
+ * @return The distance of a and b in units in the last place
+ */
+int64_t ulps(double a, double b) {
+    int64_t i, j;
+    memcpy(&i, &a, sizeof(double));
+    memcpy(&j, &b, sizeof(double));
+    // map the sign-magnitude representation onto a monotonic integer line
+    i = i < 0 ? INT64_MIN - i : i;
+    j = j < 0 ? INT64_MIN - j : j;
+    return i > j ? i - j : j - i;
+}
+
+template<typename F>
+double nsPerCall(F f, int iterations) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f();
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(end - start).count() / iterations;
+}
+
+int main() {
+    const int n = 15;
+    const int sets = 1024;
+    const int iterations = 200;
+    const double delta_t = 0.05;
+
+    // random sigma point sets, every fourth point is driving straight
+    mt19937 gen(42);
+    normal_distribution<double> normal;
+    vector<double> in(sets * 7 * n);
+    for (int s = 0; s < sets; s++) {
+        double *X = &in[s * 7 * n];
+        for (int i = 0; i < n; i++) {
+            X[i] = 10 * normal(gen);
+            X[n + i] = 10 * normal(gen);
+            X[2 * n + i] = 5 + normal(gen);
+            X[3 * n + i] = 3 * normal(gen);
+            X[4 * n + i] = i % 4 == 0 ? 1e-4 * normal(gen) : normal(gen);
+            X[5 * n + i] = normal(gen);
+            X[6 * n + i] = normal(gen);
+        }
+    }
+    vector<double> ref(sets * 5 * n);
+    vector<double> out(sets * 5 * n);
+
+    double max_error = 0;
+    for (int s = 0; s < sets; s++) {
+        predictReference(&in[s * 7 * n], &ref[s * 5 * n], n, delta_t);
+        ctrv::PredictSigmaPoints(&in[s * 7 * n], &out[s * 5 * n], n, delta_t);
+    }
+    for (size_t i = 0; i < ref.size(); i++) {
+        max_error = max(max_error, fabs(out[i] - ref[i]) / (1 + fabs(ref[i])));
+    }
+
+    double reference_ns = nsPerCall([&] {
+        for (int s = 0; s < sets; s++) {
+            predictReference(&in[s * 7 * n], &ref[s * 5 * n], n, delta_t);
+        }
+    }, iterations) / sets;
+    double kernel_ns = nsPerCall([&] {
+        for (int s = 0; s < sets; s++) {
+            ctrv::PredictSigmaPoints(&in[s * 7 * n], &out[s * 5 * n], n, delta_t);
+        }
+    }, iterations) / sets;
+
+    double fast_error = 0;
+    for (int s = 0; s < sets; s++) {
+        ctrv::PredictSigmaPoints(&in[s * 7 * n], &out[s * 5 * n], n, delta_t, true);
+    }
+    for (size_t i = 0; i < ref.size(); i++) {
+        fast_error = max(fast_error, fabs(out[i] - ref[i]) / (1 + fabs(ref[i])));
+    }
+    double fast_ns = nsPerCall([&] {
+        for (int s = 0; s < sets; s++) {
+            ctrv::PredictSigmaPoints(&in[s * 7 * n], &out[s * 5 * n], n, delta_t, true);
+        }
+    }, iterations) / sets;
+
+    // single precision kernel on the same points, relative to the double
+    // reference. Just above the straight line threshold of |yawd| = 0.001 the
+    // turn term multiplies the float sine error by v / yawd, which limits it
+    // to about 1e-3.
+    vector<float> in_float(in.begin(), in.end());
+    vector<float> out_float(out.size());
+    double float_error = 0;
+    for (int s = 0; s < sets; s++) {
+        ctrv::PredictSigmaPoints(&in_float[s * 7 * n], &out_float[s * 5 * n], n, (float) delta_t);
+    }
+    for (size_t i = 0; i < ref.size(); i++) {
+        float_error = max(float_error, fabs(out_float[i] - ref[i]) / (1 + fabs(ref[i])));
+    }
+    double float_ns = nsPerCall([&] {
+        for (int s = 0; s < sets; s++) {
+            ctrv::PredictSigmaPoints(&in_float[s * 7 * n], &out_float[s * 5 * n], n, (float) delta_t);
+        }
+    }, iterations) / sets;
+
+    cout << "CTRV prediction of " << n << " sigma points" << endl;
+    cout << "  reference: " << reference_ns << " ns/op" << endl;
+    cout << "  kernel:    " << kernel_ns << " ns/op" << endl;
+    cout << "  speedup:   " << reference_ns / kernel_ns << "x" << endl;
+    cout << "  max relative error: " << max_error << endl;
+    cout << "  fast trig: " << fast_ns << " ns/op" << endl;
+    cout << "  max relative error: " << fast_error << endl;
+    cout << "  float:     " << float_ns << " ns/op" << endl;
+    cout << "  max relative error: " << float_error << endl;
+
+    // absolute errors of the approximations against libm on a dense grid
+    const int samples = 2000000;
+    double sin_error = 0, cos_error = 0, atan2_error = 0;
+    for (int i = 0; i < samples; i++) {
+        double x = -50 + 100.0 * i / samples;
+        double s, c;
+        trig::FastSinCos(x, s, c);
+        sin_error = max(sin_error, fabs(s - sin(x)));
+        cos_error = max(cos_error, fabs(c - cos(x)));
+
+        double angle = -M_PI + 2 * M_PI * i / samples;
+        double radius = 0.01 + 100.0 * (i % 1000) / 1000;
+        double y = radius * sin(angle);
+        double x2 = radius * cos(angle);
+        atan2_error = max(atan2_error, fabs(trig::FastAtan2(y, x2) - atan2(y, x2)));
+    }
+    // ulps of the vectorized sine and cosine against libm, on the grid and
+    // on random inputs up to the libm fallback
+    vector<double> grid(samples), grid_sin(samples), grid_cos(samples);
+    uniform_real_distribution<double> large(-trig::kMaxReduced, trig::kMaxReduced);
+    for (int i = 0; i < samples; i++) {
+        grid[i] = i % 2 == 0 ? -50 + 100.0 * i / samples : large(gen);
+    }
+    ctrv::SinCos(grid.data(), grid_sin.data(), grid_cos.data(), samples);
+    int64_t sincos_ulps = 0;
+    for (int i = 0; i < samples; i++) {
+        sincos_ulps = max(sincos_ulps, max(ulps(grid_sin[i], sin(grid[i])), ulps(grid_cos[i], cos(grid[i]))));
+    }
+
+    // scalar calls as in the radar model, the sink keeps them alive
+    volatile double sink;
+    double sin_ns = nsPerCall([&] {
+        double s, c;
+        for (int i = 0; i < sets; i++) {
+            trig::FastSinCos(in[i], s, c);
+            sink = s + c;
+        }
+    }, iterations) / sets;
+    double libm_sin_ns = nsPerCall([&] {
+        for (int i = 0; i < sets; i++) {
+            sink = sin(in[i]) + cos(in[i]);
+        }
+    }, iterations) / sets;
+    double atan2_ns = nsPerCall([&] {
+        for (int i = 0; i < sets; i++) {
+            sink = trig::FastAtan2(in[i], in[i + 1]);
+        }
+    }, iterations) / sets;
+    double libm_atan2_ns = nsPerCall([&] {
+        for (int i = 0; i < sets; i++) {
+            sink = atan2(in[i], in[i + 1]);
+        }
+    }, iterations) / sets;
+    (void) sink;
+
+    cout << "trig::FastSinCos: " << sin_ns << " ns/op, libm sin + cos " << libm_sin_ns << " ns/op" << endl;
+    cout << "  max absolute error: sin " << sin_error << ", cos " << cos_error << endl;
+    cout << "ctrv::SinCos: max " << sincos_ulps << " ulp from libm" << endl;
+    cout << "trig::FastAtan2:  " << atan2_ns << " ns/op, libm " << libm_atan2_ns << " ns/op" << endl;
+    cout << "  max absolute error: " << atan2_error << endl;
+
+    bool ok = max_error < 1e-12 && sincos_ulps <= 2 && sin_error < 4e-8 && cos_error < 4e-8 && atan2_error < 1e-8
+              && float_error < 1e-3;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
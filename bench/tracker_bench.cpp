@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../src/tracker.hpp"
+
+using namespace std;
+
+/**
+ * A target moving with constant turn rate and velocity
+ */
+struct Target {
+    double p_x, p_y, v, yaw, yawd;
+};
+
+/**
+ * Detections of every target at one time, by a lidar or a radar at the origin,
+ * with the noise the default UKF assumes. Shuffled, the tracker must not
+ * rely on the order.
+ * @param order Receives the target of every detection
+ */
+vector<MeasurementPackage> detect(const vector<Target> &targets, long timestamp, bool radar, mt19937 &gen,
+                                  vector<int> &order) {
+    UKF ukf;
+    normal_distribution<double> normal;
+
+    order.resize(targets.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), gen);
+
+    vector<MeasurementPackage> detections(targets.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        const Target &target = targets[order[i]];
+        MeasurementPackage &detection = detections[i];
+        detection.timestamp_ = timestamp;
+        if (radar) {
+            double rho = sqrt(target.p_x * target.p_x + target.p_y * target.p_y);
+            double phi = atan2(target.p_y, target.p_x);
+            double rho_dot = (target.p_x * cos(target.yaw) + target.p_y * sin(target.yaw)) * target.v / rho;
+            detection.sensor_type_ = MeasurementPackage::RADAR;
+            detection.raw_measurements_.resize(3);
+            detection.raw_measurements_ << rho + ukf.std_radr_ * normal(gen),
+                    phi + ukf.std_radphi_ * normal(gen),
+                    rho_dot + ukf.std_radrd_ * normal(gen);
+        } else {
+            // std_laspx_ holds the variance
+            detection.sensor_type_ = MeasurementPackage::LASER;
+            detection.raw_measurements_.resize(2);
+            detection.raw_measurements_ << target.p_x + sqrt(ukf.std_laspx_) * normal(gen),
+                    target.p_y + sqrt(ukf.std_laspy_) * normal(gen);
+        }
+    }
+    return detections;
+}
+
+void move(vector<Target> &targets, double delta_t) {
+    for (size_t i = 0; i < targets.size(); i++) {
+        Target &t = targets[i];
+        if (fabs(t.yawd) > 0.001) {
+            t.p_x += t.v / t.yawd * (sin(t.yaw + t.yawd * delta_t) - sin(t.yaw));
+            t.p_y += t.v / t.yawd * (cos(t.yaw) - cos(t.yaw + t.yawd * delta_t));
+        } else {
+            t.p_x += t.v * delta_t * cos(t.yaw);
+            t.p_y += t.v * delta_t * sin(t.yaw);
+        }
+        t.yaw += t.yawd * delta_t;
+    }
+}
+
+int main() {
+    const int frames = 20;
+    const long frame_us = 100000;
+    const int target_counts[] = {500, 2000, 8000};
+
+    bool ok = true;
+    cout << "targets  grid ms/frame  tests/frame  all pairs ms/frame  tests/frame  same track" << endl;
+    for (int n : target_counts) {
+        // targets about 10 m apart on a square away from the radar at the origin
+        mt19937 gen(n);
+        uniform_real_distribution<double> uniform(0, 1);
+        normal_distribution<double> normal;
+        int side = (int) ceil(sqrt((double) n));
+        vector<Target> targets(n);
+        for (int i = 0; i < n; i++) {
+            Target &t = targets[i];
+            t.p_x = 50 + 10 * (i % side) + 3 * uniform(gen);
+            t.p_y = 50 + 10 * (i / side) + 3 * uniform(gen);
+            t.v = 5 + normal(gen);
+            t.yaw = 2 * M_PI * uniform(gen);
+            t.yawd = 0.2 * normal(gen);
+        }
+
+        Tracker grid;
+        Tracker all_pairs;
+        all_pairs.use_grid_ = false;
+
+        double grid_ns = 0, all_pairs_ns = 0;
+        long grid_tests = 0, all_pairs_tests = 0;
+        // detections that continue the track of their target from the last frame
+        long same_track = 0, associations = 0;
+        vector<long> target_ids(n);
+        vector<long> grid_ids, all_pairs_ids;
+        vector<int> order;
+        for (int frame = 0; frame < frames; frame++) {
+            long timestamp = frame * frame_us;
+            vector<MeasurementPackage> detections = detect(targets, timestamp, frame % 3 == 2, gen, order);
+
+            auto start = chrono::steady_clock::now();
+            grid.ProcessFrame(timestamp, detections, &grid_ids);
+            auto middle = chrono::steady_clock::now();
+            all_pairs.ProcessFrame(timestamp, detections, &all_pairs_ids);
+            auto end = chrono::steady_clock::now();
+
+            // the grid only prunes pairs, both have to associate alike
+            if (grid_ids != all_pairs_ids) {
+                cout << "MISMATCH in frame " << frame << " with " << n << " targets" << endl;
+                ok = false;
+            }
+
+            if (frame > 0) {
+                grid_ns += chrono::duration<double, nano>(middle - start).count();
+                all_pairs_ns += chrono::duration<double, nano>(end - middle).count();
+                grid_tests += grid.gate_tests_;
+                all_pairs_tests += all_pairs.gate_tests_;
+                for (int i = 0; i < n; i++) {
+                    same_track += grid_ids[i] == target_ids[order[i]];
+                }
+                associations += n;
+            }
+            for (int i = 0; i < n; i++) {
+                target_ids[order[i]] = grid_ids[i];
+            }
+            move(targets, frame_us * 1e-6);
+        }
+
+        printf("%7d %15.2f %12ld %19.2f %12ld %10.2f%%\n", n,
+               grid_ns * 1e-6 / (frames - 1), grid_tests / (frames - 1),
+               all_pairs_ns * 1e-6 / (frames - 1), all_pairs_tests / (frames - 1),
+               100.0 * same_track / associations);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
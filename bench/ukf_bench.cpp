@@ -0,0 +1,366 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "../src/imm.hpp"
+#include "../src/log_reader.hpp"
+#include "../src/output_writer.hpp"
+#include "../src/replay.hpp"
+#include "../src/tools.hpp"
+#include "../src/ukf.hpp"
+#include "../src/ukf_batch.hpp"
+
+using namespace std;
+using Eigen::VectorXd;
+
+///* number of heap allocations made so far
+static long allocations = 0;
+
+#ifdef __GLIBC__
+// count every malloc, which also covers operator new and Eigen's aligned allocations
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    allocations++;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size) {
+    allocations++;
+    return __libc_realloc(p, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    allocations++;
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    allocations++;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size) {
+    allocations++;
+    *p = __libc_memalign(alignment, size);
+    return *p == NULL ? 12 : 0;
+}
+}
+#else
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+#endif
+
+///* keeps results alive so the compiler cannot drop the benchmarked code
+static volatile double sink;
+
+/**
+ * Runs fn a tenth of the iterations to warm up, then times the given
+ * number of iterations and prints ns/op, allocations/op and items/sec.
+ */
+template<typename F>
+void run(const char *name, long iterations, double items_per_op, F fn) {
+    for (long i = 0; i < iterations / 10 + 1; i++) {
+        fn();
+    }
+
+    long allocations_before = allocations;
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = chrono::steady_clock::now();
+
+    double ns = chrono::duration<double, nano>(end - start).count() / iterations;
+    double allocs = double(allocations - allocations_before) / iterations;
+    printf("%-32s %12.1f %12.2f %14.0f\n", name, ns, allocs, items_per_op * 1e9 / ns);
+}
+
+vector<string> readLines(const string &file_name) {
+    vector<string> lines;
+    ifstream in_file(file_name.c_str());
+    string line;
+    while (getline(in_file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/**
+ * Replays a log through processStream, writing the rows to out_file
+ * @return number of measurements
+ */
+long replay(const string &file_name, OutputWriter &out_file, const ReplayOptions &options) {
+    LogReader in_file;
+    in_file.Open(file_name);
+    ReplayResult result = processStream(in_file, out_file, options);
+    sink = result.rmse.RMSE()(0);
+    return result.rmse.count;
+}
+
+/**
+ * Times a prediction, a lidar and a radar update of a filter warmed up with
+ * the given measurements
+ */
+template<class Filter>
+void runSteps(const char *suffix, bool use_sqrt, bool fast_trig, const vector<MeasurementPackage> &warm_up,
+              const MeasurementPackage &lidar_package, const MeasurementPackage &radar_package) {
+    Filter snapshot;
+    snapshot.use_sqrt_ = use_sqrt;
+    snapshot.use_fast_trig_ = fast_trig;
+    for (size_t i = 0; i < warm_up.size(); i++) {
+        snapshot.ProcessMeasurement(warm_up[i]);
+    }
+
+    // repeated steps drift away from a realistic state, so the filter is
+    // reset every kReset operations
+    const int kReset = 1000;
+    Filter ukf = snapshot;
+    int step = 0;
+    run((string("UKF::Prediction") + suffix).c_str(), 200000, 1, [&] {
+        if (++step % kReset == 0) {
+            ukf = snapshot;
+        }
+        ukf.Prediction(0.05);
+    });
+    ukf = snapshot;
+    run((string("UKF::UpdateLidar") + suffix).c_str(), 200000, 1, [&] {
+        if (++step % kReset == 0) {
+            ukf = snapshot;
+        }
+        ukf.UpdateLidar(lidar_package);
+    });
+    ukf = snapshot;
+    run((string("UKF::UpdateRadar") + suffix).c_str(), 200000, 1, [&] {
+        if (++step % kReset == 0) {
+            ukf = snapshot;
+        }
+        ukf.UpdateRadar(radar_package);
+    });
+}
+
+/**
+ * Times a prediction and a radar update of n tracks in a UKFBatch and in n
+ * independent UKFs, all starting from the state of a filter warmed up with
+ * the given measurements
+ */
+void runBatch(int n, const vector<MeasurementPackage> &warm_up, const MeasurementPackage &radar_package) {
+    UKF prototype;
+    for (size_t i = 0; i < warm_up.size(); i++) {
+        prototype.ProcessMeasurement(warm_up[i]);
+    }
+    prototype.Prediction(0.05);
+
+    UKFBatch batch_snapshot(n, prototype);
+    for (int t = 0; t < n; t++) {
+        batch_snapshot.SetTrack(t, prototype.x_, prototype.P_);
+    }
+    batch_snapshot.Prediction(UKFBatch::TrackArray::Constant(n, 0.05));
+    vector<UKF, Eigen::aligned_allocator<UKF> > ukfs_snapshot(n, prototype);
+
+    UKFBatch::TrackArray delta_t = UKFBatch::TrackArray::Constant(n, 0.05);
+    UKFBatch::TrackArray active = UKFBatch::TrackArray::Ones(n);
+    UKFBatch::TrackMatrix z(n, 3);
+    z.rowwise() = radar_package.raw_measurements_.head<3>().transpose().array();
+    models::RadarModel::Vector z_radar = radar_package.raw_measurements_.head<3>();
+
+    // repeated steps drift away from a realistic state, so the filters are
+    // reset every kReset operations
+    const int kReset = 100;
+    string tracks = " (" + to_string(n) + " tracks)";
+    UKFBatch batch = batch_snapshot;
+    int step = 0;
+    run(("UKFBatch::Prediction" + tracks).c_str(), 1000, n, [&] {
+        if (++step % kReset == 0) {
+            batch = batch_snapshot;
+        }
+        batch.Prediction(delta_t);
+    });
+    vector<UKF, Eigen::aligned_allocator<UKF> > ukfs = ukfs_snapshot;
+    run(("UKF::Prediction" + tracks).c_str(), 1000, n, [&] {
+        if (++step % kReset == 0) {
+            ukfs = ukfs_snapshot;
+        }
+        for (int t = 0; t < n; t++) {
+            ukfs[t].Prediction(0.05);
+        }
+    });
+    batch = batch_snapshot;
+    run(("UKFBatch::UpdateRadar" + tracks).c_str(), 1000, n, [&] {
+        if (++step % kReset == 0) {
+            batch = batch_snapshot;
+        }
+        batch.UpdateRadar(z, active);
+    });
+    ukfs = ukfs_snapshot;
+    run(("UKF::UpdateRadar" + tracks).c_str(), 1000, n, [&] {
+        if (++step % kReset == 0) {
+            ukfs = ukfs_snapshot;
+        }
+        for (int t = 0; t < n; t++) {
+            ukfs[t].NIS_radar_ = ukfs[t].Update(ukfs[t].radar_model_, z_radar);
+        }
+    });
+}
+
+/**
+ * Filters a log and collects the position estimates and ground truth
+ */
+void collectEstimations(const string &file_name, vector<VectorXd> &estimations, vector<VectorXd> &ground_truth) {
+    LogReader in_file;
+    in_file.Open(file_name);
+    UKF ukf;
+    MeasurementPackage meas_package;
+    GroundTruthPackage gt_package;
+    while (in_file.Next(meas_package, gt_package)) {
+        ukf.ProcessMeasurement(meas_package);
+        estimations.push_back(ukf.x_.head(2));
+        ground_truth.push_back(gt_package.gt_values_.head(2));
+    }
+}
+
+int main() {
+    const string data_1 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-1.txt";
+    const string data_2 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-2.txt";
+
+    vector<string> lines = readLines(data_1);
+    if (lines.empty()) {
+        fprintf(stderr, "Cannot read sample data: %s\n", data_1.c_str());
+        return EXIT_FAILURE;
+    }
+
+    OutputWriter null_file;
+    if (!null_file.Open("/dev/null")) {
+        fprintf(stderr, "Cannot open /dev/null\n");
+        return EXIT_FAILURE;
+    }
+
+    // filter state after the first 100 measurements of the first log, plus
+    // one measurement of each sensor to update with
+    MeasurementPackage meas_package, lidar_package, radar_package;
+    GroundTruthPackage gt_package;
+    vector<MeasurementPackage> warm_up;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (!parseLine(lines[i], meas_package, gt_package)) {
+            continue;
+        }
+        if (warm_up.size() < 100) {
+            warm_up.push_back(meas_package);
+        } else if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
+            lidar_package = meas_package;
+        } else {
+            radar_package = meas_package;
+        }
+    }
+
+    printf("%-32s %12s %12s %14s\n", "benchmark", "ns/op", "allocs/op", "meas/sec");
+
+    // standard, square-root, fast trigonometry and single precision mode
+    const char *suffixes[] = {"", " (sqrt)", " (fast trig)", " (float)", " (imm)"};
+    for (int mode = 0; mode < 3; mode++) {
+        runSteps<UKF>(suffixes[mode], mode == 1, mode == 2, warm_up, lidar_package, radar_package);
+    }
+    runSteps<UKFT<float> >(suffixes[3], false, false, warm_up, lidar_package, radar_package);
+
+    // the batch engine of the tracker against as many independent filters
+    runBatch(1000, warm_up, radar_package);
+
+    // the three models of the IMM, prediction and the step up to the next measurement
+    IMM imm_snapshot;
+    for (size_t i = 0; i < warm_up.size(); i++) {
+        imm_snapshot.ProcessMeasurement(warm_up[i]);
+    }
+    IMM imm = imm_snapshot;
+    int imm_step = 0;
+    run("IMM::Prediction", 100000, 1, [&] {
+        if (++imm_step % 1000 == 0) {
+            imm = imm_snapshot;
+        }
+        imm.Prediction(0.05);
+    });
+    MeasurementPackage next_radar = radar_package;
+    run("IMM::ProcessMeasurement radar", 100000, 1, [&] {
+        if (++imm_step % 1000 == 0) {
+            imm = imm_snapshot;
+            next_radar.timestamp_ = radar_package.timestamp_;
+        }
+        next_radar.timestamp_ += 50000;
+        imm.ProcessMeasurement(next_radar);
+    });
+
+    size_t line = 0;
+    run("parseLine", 1000000, 1, [&] {
+        parseLine(lines[line], meas_package, gt_package);
+        line = line + 1 < lines.size() ? line + 1 : 0;
+    });
+
+    UKF ukf;
+    for (size_t i = 0; i < warm_up.size(); i++) {
+        ukf.ProcessMeasurement(warm_up[i]);
+    }
+    run("writeLine", 1000000, 1, [&] {
+        writeLine(null_file, ukf, radar_package, gt_package);
+    });
+
+    vector<VectorXd> estimations, ground_truth;
+    collectEstimations(data_1, estimations, ground_truth);
+    run("tools::CalculateRMSE", 10000, estimations.size(), [&] {
+        sink = tools::CalculateRMSE(estimations, ground_truth)(0);
+    });
+
+    ReplayOptions options;
+    long count_1 = replay(data_1, null_file, options);
+    long count_2 = replay(data_2, null_file, options);
+    for (int mode = 0; mode < 5; mode++) {
+        options.use_sqrt = mode == 1;
+        options.fast_trig = mode == 2;
+        options.use_float = mode == 3;
+        options.use_imm = mode == 4;
+        const char *suffix = suffixes[mode];
+        run((string("replay data-1") + suffix).c_str(), 200, count_1, [&] {
+            replay(data_1, null_file, options);
+        });
+        run((string("replay data-2") + suffix).c_str(), 1000, count_2, [&] {
+            replay(data_2, null_file, options);
+        });
+    }
+    options.use_sqrt = false;
+    options.fast_trig = false;
+    options.use_float = false;
+    options.use_imm = false;
+    options.joint_updates = true;
+    run("replay data-2 (joint)", 1000, count_2, [&] {
+        replay(data_2, null_file, options);
+    });
+    options.joint_updates = false;
+    options.time_stages = true;
+    run("replay data-1 (timing)", 200, count_1, [&] {
+        replay(data_1, null_file, options);
+    });
+
+    return EXIT_SUCCESS;
+}
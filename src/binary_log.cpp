@@ -0,0 +1,118 @@
+#include <cstring>
+#include "binary_log.hpp"
+
+namespace binary_log {
+
+    namespace {
+        ///* stdio buffer of the writer
+        const size_t kWriteBuffer = 1 << 20;
+    }
+
+    bool HasMagic(const char *data, size_t size) {
+        return size >= sizeof(kMagic) && memcmp(data, kMagic, sizeof(kMagic)) == 0;
+    }
+
+    bool IsBinaryLog(const char *data, size_t size) {
+        if (size < sizeof(Header)) {
+            return false;
+        }
+        Header header;
+        memcpy(&header, data, sizeof(Header));
+        return memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+               && header.version == kVersion
+               && header.record_size == sizeof(Record)
+               && header.byte_order == kByteOrderMark;
+    }
+
+    size_t RecordCount(const char *data, size_t size) {
+        Header header;
+        memcpy(&header, data, sizeof(Header));
+        size_t complete = (size - sizeof(Header)) / sizeof(Record);
+        if (header.record_count == 0 || header.record_count > complete) {
+            return complete;
+        }
+        return header.record_count;
+    }
+
+    bool IsValid(const Record &record) {
+        return (record.sensor_type == MeasurementPackage::LASER && record.n_measurements == 2)
+               || (record.sensor_type == MeasurementPackage::RADAR && record.n_measurements == 3);
+    }
+
+    bool ToPackages(const Record &record, MeasurementPackage &meas_package, GroundTruthPackage &gt_package) {
+        if (!IsValid(record)) {
+            return false;
+        }
+        meas_package.sensor_type_ = (MeasurementPackage::SensorType) record.sensor_type;
+        meas_package.timestamp_ = record.timestamp;
+        meas_package.raw_measurements_.resize(record.n_measurements);
+        for (int i = 0; i < record.n_measurements; i++) {
+            meas_package.raw_measurements_(i) = record.measurements[i];
+        }
+
+        gt_package.sensor_type_ = (GroundTruthPackage::SensorType) record.sensor_type;
+        gt_package.timestamp_ = record.timestamp;
+        for (int i = 0; i < 4; i++) {
+            gt_package.gt_values_(i) = record.ground_truth[i];
+        }
+        return true;
+    }
+
+    void FromPackages(const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package, Record &record) {
+        memset(&record, 0, sizeof(Record));
+        record.sensor_type = (uint8_t) meas_package.sensor_type_;
+        record.n_measurements = (uint8_t) meas_package.raw_measurements_.size();
+        record.timestamp = meas_package.timestamp_;
+        for (int i = 0; i < record.n_measurements; i++) {
+            record.measurements[i] = meas_package.raw_measurements_(i);
+        }
+        for (int i = 0; i < 4; i++) {
+            record.ground_truth[i] = gt_package.gt_values_(i);
+        }
+    }
+
+    Writer::Writer() : file_(NULL), record_count_(0) {}
+
+    Writer::~Writer() {
+        Close();
+    }
+
+    bool Writer::Open(const std::string &file_name) {
+        Close();
+        file_ = fopen(file_name.c_str(), "wb");
+        if (file_ == NULL) {
+            return false;
+        }
+        setvbuf(file_, NULL, _IOFBF, kWriteBuffer);
+
+        Header header;
+        memset(&header, 0, sizeof(Header));
+        memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.record_size = sizeof(Record);
+        header.byte_order = kByteOrderMark;
+        record_count_ = 0;
+        return fwrite(&header, sizeof(Header), 1, file_) == 1;
+    }
+
+    bool Writer::Write(const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package) {
+        Record record;
+        FromPackages(meas_package, gt_package, record);
+        if (fwrite(&record, sizeof(Record), 1, file_) != 1) {
+            return false;
+        }
+        record_count_++;
+        return true;
+    }
+
+    bool Writer::Close() {
+        if (file_ == NULL) {
+            return true;
+        }
+        bool ok = fseek(file_, offsetof(Header, record_count), SEEK_SET) == 0
+                  && fwrite(&record_count_, sizeof(record_count_), 1, file_) == 1;
+        ok = fclose(file_) == 0 && ok;
+        file_ = NULL;
+        return ok;
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef UNSCENTED_KALMAN_FILTER_BINARY_LOG_HPP
+#define UNSCENTED_KALMAN_FILTER_BINARY_LOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "measurement_package.hpp"
+#include "ground_truth_package.hpp"
+
+/**
+ * Compact binary measurement log.
+ *
+ * A 24 byte header is followed by fixed-width 72 byte records, one per
+ * measurement, with the same columns as the text format: sensor type,
+ * timestamp, up to three measurement values and four ground truth values.
+ * All fields are in the byte order of the machine that wrote the log, which
+ * the header records; logs of the other byte order are rejected. Records can
+ * be read straight out of a memory-mapped file without any parsing.
+ */
+namespace binary_log {
+
+    const char kMagic[4] = {'U', 'K', 'F', 'B'};
+
+    const uint32_t kVersion = 2;
+
+    ///* written in the byte order of the writer, reads back swapped on a machine of the other order
+    const uint32_t kByteOrderMark = 0x01020304;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t record_size;
+        ///* kByteOrderMark
+        uint32_t byte_order;
+        ///* number of records, 0 if the writer did not finish
+        uint64_t record_count;
+    };
+
+    struct Record {
+        ///* MeasurementPackage::SensorType
+        uint8_t sensor_type;
+        ///* number of used entries in measurements
+        uint8_t n_measurements;
+        uint8_t reserved[6];
+        int64_t timestamp;
+        double measurements[3];
+        double ground_truth[4];
+    };
+
+    static_assert(sizeof(Header) == 24, "unexpected binary log header layout");
+    static_assert(sizeof(Record) == 72, "unexpected binary log record layout");
+
+    /**
+     * @return true if the data starts with the magic of a binary log, of any
+     * version or byte order
+     */
+    bool HasMagic(const char *data, size_t size);
+
+    /**
+     * @return true if the data starts with a binary log header of a supported
+     * version and the byte order of this machine
+     */
+    bool IsBinaryLog(const char *data, size_t size);
+
+    /**
+     * @return The number of complete records in a mapped binary log
+     */
+    size_t RecordCount(const char *data, size_t size);
+
+    /**
+     * @return true if the record is a lidar measurement with 2 values or a
+     * radar measurement with 3 values
+     */
+    bool IsValid(const Record &record);
+
+    /**
+     * Decodes a record, the packages are left unchanged if it is not valid
+     * @return false if the record is not valid
+     */
+    bool ToPackages(const Record &record, MeasurementPackage &meas_package, GroundTruthPackage &gt_package);
+
+    void FromPackages(const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package, Record &record);
+
+    /**
+     * Writes a binary log record by record.
+     */
+    class Writer {
+    public:
+        Writer();
+
+        virtual ~Writer();
+
+        bool Open(const std::string &file_name);
+
+        bool Write(const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package);
+
+        /**
+         * Stores the final record count in the header and closes the file
+         */
+        bool Close();
+
+    private:
+        FILE *file_;
+        uint64_t record_count_;
+
+        Writer(const Writer &);
+        Writer &operator=(const Writer &);
+    };
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_BINARY_LOG_HPP
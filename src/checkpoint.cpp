@@ -0,0 +1,303 @@
+#include <cstring>
+#include "checkpoint.hpp"
+#include "replay.hpp"
+
+namespace checkpoint {
+
+    namespace {
+        template<typename T>
+        void put(std::vector<char> &state, const T &value) {
+            const char *bytes = reinterpret_cast<const char *>(&value);
+            state.insert(state.end(), bytes, bytes + sizeof(T));
+        }
+
+        template<typename Scalar, int Rows, int Cols, int Options>
+        void putMatrix(std::vector<char> &state, const Eigen::Matrix<Scalar, Rows, Cols, Options> &m) {
+            const char *bytes = reinterpret_cast<const char *>(m.data());
+            state.insert(state.end(), bytes, bytes + sizeof(Scalar) * Rows * Cols);
+        }
+
+        /**
+         * Reads the values of a state in the order they were put, fails
+         * instead of reading past the end
+         */
+        class StateReader {
+        public:
+            explicit StateReader(const std::vector<char> &state) : state_(state), pos_(0), ok_(true) {}
+
+            template<typename T>
+            void Get(T &value) {
+                Read(&value, sizeof(T));
+            }
+
+            template<typename Scalar, int Rows, int Cols, int Options>
+            void GetMatrix(Eigen::Matrix<Scalar, Rows, Cols, Options> &m) {
+                Read(m.data(), sizeof(Scalar) * Rows * Cols);
+            }
+
+            /**
+             * @return true if all values were read and nothing is left
+             */
+            bool Done() const {
+                return ok_ && pos_ == state_.size();
+            }
+
+        private:
+            const std::vector<char> &state_;
+            size_t pos_;
+            bool ok_;
+
+            void Read(void *value, size_t size) {
+                if (!ok_ || state_.size() - pos_ < size) {
+                    ok_ = false;
+                    return;
+                }
+                memcpy(value, &state_[pos_], size);
+                pos_ += size;
+            }
+        };
+
+        template<typename Scalar>
+        void saveUKF(const UKFT<Scalar> &ukf, std::vector<char> &state) {
+            state.clear();
+            put<uint8_t>(state, ukf.is_initialized_);
+            put<uint8_t>(state, ukf.use_sqrt_);
+            put<uint8_t>(state, ukf.use_fast_trig_);
+            put<int64_t>(state, ukf.previous_timestamp_);
+            put(state, ukf.Noise());
+            putMatrix(state, ukf.x_);
+            putMatrix(state, ukf.P_);
+            putMatrix(state, ukf.sqrt_P_);
+            put(state, ukf.NIS_radar_);
+            put(state, ukf.NIS_laser_);
+        }
+
+        template<typename Scalar>
+        bool loadUKF(const std::vector<char> &state, UKFT<Scalar> &ukf) {
+            // read everything first, the filter stays untouched if the state does not fit
+            StateReader reader(state);
+            uint8_t is_initialized = 0, use_sqrt = 0, use_fast_trig = 0;
+            int64_t previous_timestamp = 0;
+            NoiseParameters noise;
+            typename UKFT<Scalar>::StateVector x;
+            typename UKFT<Scalar>::StateMatrix P, sqrt_P;
+            Scalar nis_radar = 0, nis_laser = 0;
+            reader.Get(is_initialized);
+            reader.Get(use_sqrt);
+            reader.Get(use_fast_trig);
+            reader.Get(previous_timestamp);
+            reader.Get(noise);
+            reader.GetMatrix(x);
+            reader.GetMatrix(P);
+            reader.GetMatrix(sqrt_P);
+            reader.Get(nis_radar);
+            reader.Get(nis_laser);
+            if (!reader.Done()) {
+                return false;
+            }
+            ukf.is_initialized_ = is_initialized;
+            ukf.use_sqrt_ = use_sqrt;
+            ukf.use_fast_trig_ = use_fast_trig;
+            ukf.previous_timestamp_ = previous_timestamp;
+            ukf.SetNoise(noise);
+            ukf.x_ = x;
+            ukf.P_ = P;
+            ukf.sqrt_P_ = sqrt_P;
+            ukf.NIS_radar_ = nis_radar;
+            ukf.NIS_laser_ = nis_laser;
+            return true;
+        }
+    }
+
+    void SaveStatistics(const ReplayResult &result, Header &header) {
+        header.count = result.rmse.count;
+        header.squared_error[0] = result.rmse.squared_error(0);
+        header.squared_error[1] = result.rmse.squared_error(1);
+        header.lidar_count = result.lidar_nis.count;
+        header.lidar_nis_over = result.lidar_nis.over;
+        header.radar_count = result.radar_nis.count;
+        header.radar_nis_over = result.radar_nis.over;
+        header.nees_count = result.nees.count;
+        header.nees_over = result.nees.over;
+        header.nees_sum = result.nees.sum;
+        header.late_count = result.late_count;
+        header.dropped_count = result.dropped_count;
+        header.latency_sum = result.latency_sum;
+        header.latency_max = result.latency_max;
+    }
+
+    void RestoreStatistics(const Header &header, ReplayResult &result) {
+        result.rmse.count = header.count;
+        result.rmse.squared_error << header.squared_error[0], header.squared_error[1];
+        result.lidar_nis.count = header.lidar_count;
+        result.lidar_nis.over = header.lidar_nis_over;
+        result.radar_nis.count = header.radar_count;
+        result.radar_nis.over = header.radar_nis_over;
+        result.nees.count = header.nees_count;
+        result.nees.over = header.nees_over;
+        result.nees.sum = header.nees_sum;
+        result.late_count = header.late_count;
+        result.dropped_count = header.dropped_count;
+        result.latency_sum = header.latency_sum;
+        result.latency_max = header.latency_max;
+    }
+
+    void SaveFilter(const UKF &ukf, std::vector<char> &state) {
+        saveUKF(ukf, state);
+    }
+
+    void SaveFilter(const UKFT<float> &ukf, std::vector<char> &state) {
+        saveUKF(ukf, state);
+    }
+
+    void SaveFilter(const IMM &imm, std::vector<char> &state) {
+        state.clear();
+        put<uint8_t>(state, imm.is_initialized_);
+        put<uint8_t>(state, imm.use_fast_trig_);
+        put<int64_t>(state, imm.previous_timestamp_);
+        putMatrix(state, imm.x_);
+        putMatrix(state, imm.P_);
+        putMatrix(state, imm.x_models_);
+        for (int j = 0; j < IMM::n_models_; j++) {
+            putMatrix(state, imm.P_models_[j]);
+        }
+        putMatrix(state, imm.mu_);
+        putMatrix(state, imm.transition_);
+        putMatrix(state, imm.std_a_);
+        putMatrix(state, imm.std_yawdd_);
+        putMatrix(state, imm.lidar_model_.R);
+        putMatrix(state, imm.radar_model_.R);
+        put(state, imm.NIS_radar_);
+        put(state, imm.NIS_laser_);
+    }
+
+    bool LoadFilter(const std::vector<char> &state, UKF &ukf) {
+        return loadUKF(state, ukf);
+    }
+
+    bool LoadFilter(const std::vector<char> &state, UKFT<float> &ukf) {
+        return loadUKF(state, ukf);
+    }
+
+    bool LoadFilter(const std::vector<char> &state, IMM &imm) {
+        // read into a copy, the filter stays untouched if the state does not fit
+        StateReader reader(state);
+        uint8_t is_initialized = 0, use_fast_trig = 0;
+        int64_t previous_timestamp = 0;
+        models::LidarModel::Matrix R_lidar;
+        models::RadarModel::Matrix R_radar;
+        IMM loaded(imm);
+        reader.Get(is_initialized);
+        reader.Get(use_fast_trig);
+        reader.Get(previous_timestamp);
+        reader.GetMatrix(loaded.x_);
+        reader.GetMatrix(loaded.P_);
+        reader.GetMatrix(loaded.x_models_);
+        for (int j = 0; j < IMM::n_models_; j++) {
+            reader.GetMatrix(loaded.P_models_[j]);
+        }
+        reader.GetMatrix(loaded.mu_);
+        reader.GetMatrix(loaded.transition_);
+        reader.GetMatrix(loaded.std_a_);
+        reader.GetMatrix(loaded.std_yawdd_);
+        reader.GetMatrix(R_lidar);
+        reader.GetMatrix(R_radar);
+        reader.Get(loaded.NIS_radar_);
+        reader.Get(loaded.NIS_laser_);
+        if (!reader.Done()) {
+            return false;
+        }
+        loaded.is_initialized_ = is_initialized;
+        loaded.use_fast_trig_ = use_fast_trig;
+        loaded.previous_timestamp_ = previous_timestamp;
+        loaded.lidar_model_.SetNoise(R_lidar);
+        loaded.radar_model_.SetNoise(R_radar);
+        imm = loaded;
+        return true;
+    }
+
+    bool Fits(const Snapshot &snapshot, FilterKind kind) {
+        std::vector<char> state;
+        switch (kind) {
+            case UKF_DOUBLE:
+                SaveFilter(UKF(), state);
+                break;
+            case UKF_FLOAT:
+                SaveFilter(UKFT<float>(), state);
+                break;
+            case IMM_FILTER:
+                SaveFilter(IMM(), state);
+                break;
+        }
+        return snapshot.header.filter_kind == (uint32_t) kind && snapshot.filter.size() == state.size();
+    }
+
+    bool ReadSnapshot(const std::string &file_name, long timestamp, Snapshot &snapshot) {
+        FILE *file = fopen(file_name.c_str(), "rb");
+        if (file == NULL) {
+            return false;
+        }
+
+        // the snapshots are in replay order, the last one in time wins
+        bool found = false;
+        Snapshot current;
+        while (fread(&current.header, sizeof(Header), 1, file) == 1) {
+            const Header &header = current.header;
+            if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+                break;
+            }
+            current.filter.resize(header.filter_size);
+            if (header.filter_size > 0 && fread(&current.filter[0], header.filter_size, 1, file) != 1) {
+                // a snapshot cut short by a killed replay
+                break;
+            }
+            if (header.timestamp <= timestamp) {
+                snapshot = current;
+                found = true;
+            }
+        }
+        fclose(file);
+        return found;
+    }
+
+    Writer::Writer() : file_(NULL), failed_(false) {}
+
+    Writer::~Writer() {
+        Close();
+    }
+
+    bool Writer::Open(const std::string &file_name) {
+        Close();
+        file_ = fopen(file_name.c_str(), "wb");
+        failed_ = false;
+        return file_ != NULL;
+    }
+
+    bool Writer::IsOpen() const {
+        return file_ != NULL;
+    }
+
+    bool Writer::Write(Snapshot &snapshot) {
+        Header &header = snapshot.header;
+        memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.filter_size = snapshot.filter.size();
+        memset(header.reserved, 0, sizeof(header.reserved));
+
+        bool ok = fwrite(&header, sizeof(Header), 1, file_) == 1
+                  && (snapshot.filter.empty()
+                      || fwrite(&snapshot.filter[0], snapshot.filter.size(), 1, file_) == 1)
+                  && fflush(file_) == 0;
+        failed_ = failed_ || !ok;
+        return ok;
+    }
+
+    bool Writer::Close() {
+        if (file_ == NULL) {
+            return true;
+        }
+        bool ok = fclose(file_) == 0 && !failed_;
+        file_ = NULL;
+        return ok;
+    }
+}
@@ -0,0 +1,162 @@
+#ifndef UNSCENTED_KALMAN_FILTER_CHECKPOINT_HPP
+#define UNSCENTED_KALMAN_FILTER_CHECKPOINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "imm.hpp"
+#include "ukf.hpp"
+
+struct ReplayResult;
+
+/**
+ * Snapshots of a replay: the complete filter state, the position in the log
+ * and the running statistics, so a replay can continue from the middle of a
+ * log with the same output rows and report as a replay from its start.
+ *
+ * A checkpoint file is a sequence of snapshots, each a fixed 152 byte header
+ * followed by filter_size bytes of filter state. Sigma points and other
+ * values recomputed by every prediction are not part of the state. The
+ * fields are in the byte order of the machine, like the binary logs.
+ */
+namespace checkpoint {
+
+    const char kMagic[4] = {'U', 'K', 'F', 'S'};
+
+    const uint32_t kVersion = 2;
+
+    ///* the filter a snapshot is of
+    enum FilterKind {
+        UKF_DOUBLE = 0,
+        UKF_FLOAT = 1,
+        IMM_FILTER = 2
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        ///* FilterKind
+        uint32_t filter_kind;
+        ///* bytes of filter state after the header
+        uint32_t filter_size;
+        ///* offset in the log of the first measurement not processed yet
+        uint64_t log_offset;
+        ///* timestamp of the last processed measurement in us
+        int64_t timestamp;
+        ///* running statistics of the replay, see ReplayResult
+        int64_t count;
+        double squared_error[2];
+        int64_t lidar_count;
+        int64_t lidar_nis_over;
+        int64_t radar_count;
+        int64_t radar_nis_over;
+        int64_t nees_count;
+        int64_t nees_over;
+        double nees_sum;
+        int64_t late_count;
+        int64_t dropped_count;
+        double latency_sum;
+        double latency_max;
+        uint8_t reserved[8];
+    };
+
+    static_assert(sizeof(Header) == 152, "unexpected checkpoint header layout");
+
+    struct Snapshot {
+        Header header;
+        std::vector<char> filter;
+    };
+
+    /**
+     * @return The FilterKind of a filter
+     */
+    inline FilterKind KindOf(const UKF &) {
+        return UKF_DOUBLE;
+    }
+
+    inline FilterKind KindOf(const UKFT<float> &) {
+        return UKF_FLOAT;
+    }
+
+    inline FilterKind KindOf(const IMM &) {
+        return IMM_FILTER;
+    }
+
+    /**
+     * Stores the accumulators, late and dropped counts and latencies of a
+     * replay in the header
+     */
+    void SaveStatistics(const ReplayResult &result, Header &header);
+
+    void RestoreStatistics(const Header &header, ReplayResult &result);
+
+    /**
+     * Serializes the filter state: flags, timestamp, state, covariance, noise
+     * and the last NIS values
+     */
+    void SaveFilter(const UKF &ukf, std::vector<char> &state);
+
+    void SaveFilter(const UKFT<float> &ukf, std::vector<char> &state);
+
+    void SaveFilter(const IMM &imm, std::vector<char> &state);
+
+    /**
+     * Restores a state saved from the same kind of filter
+     * @return false if the state does not fit the filter, which is then unchanged
+     */
+    bool LoadFilter(const std::vector<char> &state, UKF &ukf);
+
+    bool LoadFilter(const std::vector<char> &state, UKFT<float> &ukf);
+
+    bool LoadFilter(const std::vector<char> &state, IMM &imm);
+
+    /**
+     * @return true if the snapshot is of the given kind of filter and its
+     * state has the size that kind saves, so LoadFilter cannot fail
+     */
+    bool Fits(const Snapshot &snapshot, FilterKind kind);
+
+    /**
+     * Reads the last snapshot of a checkpoint file whose timestamp is not
+     * after the given one
+     * @param timestamp In us, LONG_MAX reads the last snapshot
+     * @return false if the file cannot be read or has no such snapshot
+     */
+    bool ReadSnapshot(const std::string &file_name, long timestamp, Snapshot &snapshot);
+
+    /**
+     * Appends snapshots to a checkpoint file. Every snapshot is flushed, so
+     * the file holds all complete snapshots if the replay is killed.
+     */
+    class Writer {
+    public:
+        Writer();
+
+        virtual ~Writer();
+
+        /**
+         * Creates or truncates the file
+         */
+        bool Open(const std::string &file_name);
+
+        bool IsOpen() const;
+
+        /**
+         * Sets magic, version and filter_size of the header and writes the snapshot
+         */
+        bool Write(Snapshot &snapshot);
+
+        bool Close();
+
+    private:
+        FILE *file_;
+        bool failed_;
+
+        Writer(const Writer &);
+        Writer &operator=(const Writer &);
+    };
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_CHECKPOINT_HPP
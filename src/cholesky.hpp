@@ -0,0 +1,54 @@
+#ifndef UNSCENTED_KALMAN_FILTER_CHOLESKY_HPP
+#define UNSCENTED_KALMAN_FILTER_CHOLESKY_HPP
+
+#include <cmath>
+#include "lib/Eigen/Dense"
+
+namespace cholesky {
+
+    /**
+     * Lower triangular L with L * L^T = A^T * A, taken from the R factor of a
+     * QR decomposition of A.
+     */
+    template<typename Scalar, int rows, int cols>
+    Eigen::Matrix<Scalar, cols, cols> LowerFactorQR(const Eigen::Matrix<Scalar, rows, cols> &A) {
+        Eigen::HouseholderQR<Eigen::Matrix<Scalar, rows, cols> > qr(A);
+        Eigen::Matrix<Scalar, cols, cols> L =
+                qr.matrixQR().template topRows<cols>().template triangularView<Eigen::Upper>().transpose();
+
+        // flip columns to a positive diagonal, L * L^T is unchanged
+        for (int j = 0; j < cols; j++) {
+            if (L(j, j) < 0) {
+                L.col(j) *= -1;
+            }
+        }
+        return L;
+    }
+
+    /**
+     * Turns the lower Cholesky factor L of A into the factor of
+     * A + sigma * v * v^T in place.
+     * @return false if the result is not positive definite, L is then invalid
+     */
+    template<typename Scalar, int n>
+    bool RankUpdate(Eigen::Matrix<Scalar, n, n> &L, Eigen::Matrix<Scalar, n, 1> v,
+                    typename Eigen::Matrix<Scalar, n, 1>::Scalar sigma) {
+        for (int k = 0; k < n; k++) {
+            Scalar r2 = L(k, k) * L(k, k) + sigma * v(k) * v(k);
+            if (!(r2 > 0) || L(k, k) == 0) {
+                return false;
+            }
+            Scalar r = std::sqrt(r2);
+            Scalar c = r / L(k, k);
+            Scalar s = v(k) / L(k, k);
+            L(k, k) = r;
+            for (int i = k + 1; i < n; i++) {
+                L(i, k) = (L(i, k) + sigma * s * v(i)) / c;
+                v(i) = c * v(i) - s * L(i, k);
+            }
+        }
+        return true;
+    }
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_CHOLESKY_HPP
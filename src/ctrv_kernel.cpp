@@ -0,0 +1,147 @@
+#include <cmath>
+#include "ctrv_kernel.hpp"
+#include "fast_trig.hpp"
+
+namespace ctrv {
+
+    namespace {
+        ///* number of points processed per block, sized for the stack buffers
+        const int kBlock = 16;
+
+        /**
+         * Rare slow path for diverged angles, also catches NaN
+         */
+        void SinCosLarge(const double *x, double *s, double *c, int n) {
+            for (int i = 0; i < n; i++) {
+                if (!(std::fabs(x[i]) < trig::kMaxReduced)) {
+                    s[i] = std::sin(x[i]);
+                    c[i] = std::cos(x[i]);
+                }
+            }
+        }
+    }
+
+    void SinCos(const double *x, double *s, double *c, int n) {
+        for (int i = 0; i < n; i++) {
+            double q;
+            double r = trig::Reduce(x[i], q);
+            double z = r * r;
+
+            // minimax polynomials on [-pi/4, pi/4] (Cephes)
+            double sr = r + r * z * (((((1.58962301576546568060e-10 * z
+                                         - 2.50507477628578072866e-8) * z
+                                        + 2.75573136213857245213e-6) * z
+                                       - 1.98412698295895385996e-4) * z
+                                      + 8.33333333332211858878e-3) * z
+                                     - 1.66666666666666307295e-1);
+            double cr = 1.0 - 0.5 * z + z * z * (((((-1.13585365213876817300e-11 * z
+                                                      + 2.08757008419747316778e-9) * z
+                                                     - 2.75573141792967388112e-7) * z
+                                                    + 2.48015872888517045348e-5) * z
+                                                   - 1.38888888888730564116e-3) * z
+                                                  + 4.16666666666665929218e-2);
+
+            trig::Unreduce(q, sr, cr, s[i], c[i]);
+        }
+        SinCosLarge(x, s, c, n);
+    }
+
+    void SinCosFast(const double *x, double *s, double *c, int n) {
+        for (int i = 0; i < n; i++) {
+            trig::FastSinCosReduced(x[i], s[i], c[i]);
+        }
+        SinCosLarge(x, s, c, n);
+    }
+
+    void SinCos(const float *x, float *s, float *c, int n) {
+        for (int i = 0; i < n; i++) {
+            trig::SinCosReduced(x[i], s[i], c[i]);
+        }
+        for (int i = 0; i < n; i++) {
+            if (!(std::fabs(x[i]) < trig::Reduction<float>::MaxReduced())) {
+                s[i] = std::sin(x[i]);
+                c[i] = std::cos(x[i]);
+            }
+        }
+    }
+
+    namespace {
+        /**
+         * The CTRV kernel in double or single precision with the given SinCos
+         */
+        template<typename T>
+        void predictSigmaPoints(const T *Xsig_aug, T *Xsig_pred, int n, T delta_t,
+                                void (*sin_cos)(const T *, T *, T *, int)) {
+            const T dt2 = T(0.5) * delta_t * delta_t;
+
+            for (int begin = 0; begin < n; begin += kBlock) {
+                const int m = n - begin < kBlock ? n - begin : kBlock;
+
+                const T *p_x = Xsig_aug + begin;
+                const T *p_y = p_x + n;
+                const T *v = p_y + n;
+                const T *yaw = v + n;
+                const T *yawd = yaw + n;
+                const T *nu_a = yawd + n;
+                const T *nu_yawdd = nu_a + n;
+
+                T *px_p = Xsig_pred + begin;
+                T *py_p = px_p + n;
+                T *v_p = py_p + n;
+                T *yaw_p = v_p + n;
+                T *yawd_p = yaw_p + n;
+
+                T sin_yaw[kBlock], cos_yaw[kBlock];
+                T sin_yaw_p[kBlock], cos_yaw_p[kBlock];
+
+                for (int i = 0; i < m; i++) {
+                    yaw_p[i] = yaw[i] + yawd[i] * delta_t;
+                }
+                sin_cos(yaw, sin_yaw, cos_yaw, m);
+                sin_cos(yaw_p, sin_yaw_p, cos_yaw_p, m);
+
+                //avoid division by zero, both CTRV branches are computed for every
+                //point and selected; one loop per output keeps the loops vectorizable
+                T ratio[kBlock];
+                for (int i = 0; i < m; i++) {
+                    ratio[i] = v[i] / (std::fabs(yawd[i]) > T(0.001) ? yawd[i] : T(1.0));
+                }
+
+                //predicted state values with noise
+                for (int i = 0; i < m; i++) {
+                    T turn = ratio[i] * (sin_yaw_p[i] - sin_yaw[i]);
+                    T straight = v[i] * delta_t * cos_yaw[i];
+                    px_p[i] = p_x[i] + (std::fabs(yawd[i]) > T(0.001) ? turn : straight) + nu_a[i] * dt2 * cos_yaw[i];
+                }
+                for (int i = 0; i < m; i++) {
+                    T turn = ratio[i] * (cos_yaw[i] - cos_yaw_p[i]);
+                    T straight = v[i] * delta_t * sin_yaw[i];
+                    py_p[i] = p_y[i] + (std::fabs(yawd[i]) > T(0.001) ? turn : straight) + nu_a[i] * dt2 * sin_yaw[i];
+                }
+                for (int i = 0; i < m; i++) {
+                    v_p[i] = v[i] + nu_a[i] * delta_t;
+                }
+                for (int i = 0; i < m; i++) {
+                    yaw_p[i] = yaw_p[i] + nu_yawdd[i] * dt2;
+                }
+                for (int i = 0; i < m; i++) {
+                    yawd_p[i] = yawd[i] + nu_yawdd[i] * delta_t;
+                }
+            }
+        }
+    }
+
+    void PredictSigmaPoints(const double *Xsig_aug, double *Xsig_pred, int n, double delta_t, bool fast_trig) {
+        void (*sin_cos)(const double *, double *, double *, int) = SinCos;
+        if (fast_trig) {
+            sin_cos = SinCosFast;
+        }
+        predictSigmaPoints(Xsig_aug, Xsig_pred, n, delta_t, sin_cos);
+    }
+
+    void PredictSigmaPoints(const float *Xsig_aug, float *Xsig_pred, int n, float delta_t, bool /*fast_trig*/) {
+        // the float polynomials are already short, there is no faster variant
+        void (*sin_cos)(const float *, float *, float *, int) = SinCos;
+        predictSigmaPoints(Xsig_aug, Xsig_pred, n, delta_t, sin_cos);
+    }
+}
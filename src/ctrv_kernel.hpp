@@ -0,0 +1,45 @@
+#ifndef UNSCENTED_KALMAN_FILTER_CTRV_KERNEL_HPP
+#define UNSCENTED_KALMAN_FILTER_CTRV_KERNEL_HPP
+
+namespace ctrv {
+
+    /**
+     * Computes sine and cosine of n values. The loops are branch free so the
+     * compiler can vectorize them; the result is within 2 ulp of libm for
+     * |x| < 1e8, larger inputs fall back to std::sin / std::cos.
+     */
+    void SinCos(const double *x, double *s, double *c, int n);
+
+    /**
+     * Like SinCos with the polynomials of trig::FastSinCos, absolute error
+     * below 4e-8.
+     */
+    void SinCosFast(const double *x, double *s, double *c, int n);
+
+    /**
+     * Single precision SinCos, absolute error below 1.2e-7 for |x| < 8192,
+     * larger inputs fall back to std::sin / std::cos
+     */
+    void SinCos(const float *x, float *s, float *c, int n);
+
+    /**
+     * Propagates augmented sigma points through the CTRV process model.
+     * @param Xsig_aug Row-major 7 x n matrix [p_x p_y v yaw yawd nu_a nu_yawdd]
+     * @param Xsig_pred Row-major 5 x n output matrix [p_x p_y v yaw yawd]
+     * @param n Number of sigma points
+     * @param delta_t Time between k and k+1 in s
+     * @param fast_trig Use SinCosFast instead of SinCos
+     */
+    void PredictSigmaPoints(const double *Xsig_aug, double *Xsig_pred, int n, double delta_t,
+                            bool fast_trig = false);
+
+    /**
+     * Single precision PredictSigmaPoints, twice the points per vector. Always
+     * uses SinCos, fast_trig has no effect.
+     */
+    void PredictSigmaPoints(const float *Xsig_aug, float *Xsig_pred, int n, float delta_t,
+                            bool fast_trig = false);
+
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_CTRV_KERNEL_HPP
@@ -0,0 +1,206 @@
+#ifndef UNSCENTED_KALMAN_FILTER_FAST_TRIG_HPP
+#define UNSCENTED_KALMAN_FILTER_FAST_TRIG_HPP
+
+#include <cmath>
+
+/**
+ * Trigonometry for the process and measurement models.
+ *
+ * Exact and Fast are policies with the same static interface, the models
+ * take them as a template parameter. Fast uses short polynomials, which is
+ * far below the sensor noise: the absolute error is below 4e-8 for sin and
+ * cos and below 1e-8 rad for atan2.
+ */
+namespace trig {
+
+    ///* pi/2 split into three parts so that q * kPio2A is exact (Cephes)
+    const double kPio2A = 1.57079625129699707031e+00;
+    const double kPio2B = 7.54978941586159635336e-08;
+    const double kPio2C = 5.39030285815811905290e-15;
+    const double kTwoOverPi = 0.63661977236758134308;
+
+    ///* adding and subtracting 1.5 * 2^52 rounds to the nearest integer
+    const double kRoundMagic = 6755399441055744.0;
+
+    ///* above this the three part reduction loses precision
+    const double kMaxReduced = 1e8;
+
+    /**
+     * Range reduction constants for double and float. The float split of
+     * pi/2 is exact for |q| < 2^16 (Cephes sinf).
+     */
+    template<typename T>
+    struct Reduction;
+
+    template<>
+    struct Reduction<double> {
+        static double Pio2A() { return kPio2A; }
+        static double Pio2B() { return kPio2B; }
+        static double Pio2C() { return kPio2C; }
+        static double TwoOverPi() { return kTwoOverPi; }
+        static double RoundMagic() { return kRoundMagic; }
+        static double MaxReduced() { return kMaxReduced; }
+    };
+
+    template<>
+    struct Reduction<float> {
+        static float Pio2A() { return 1.5703125f; }
+        static float Pio2B() { return 4.837512969970703125e-4f; }
+        static float Pio2C() { return 7.54978995489188216e-8f; }
+        static float TwoOverPi() { return 0.636619772367581343f; }
+        ///* 1.5 * 2^23
+        static float RoundMagic() { return 12582912.0f; }
+        static float MaxReduced() { return 8192.0f; }
+    };
+
+    /**
+     * Reduces x to r in [-pi/4, pi/4] with x = q * pi/2 + r
+     */
+    template<typename T>
+    inline T Reduce(T x, T &q) {
+        typedef Reduction<T> R;
+        q = (x * R::TwoOverPi() + R::RoundMagic()) - R::RoundMagic();
+        return ((x - q * R::Pio2A()) - q * R::Pio2B()) - q * R::Pio2C();
+    }
+
+    /**
+     * Sine and cosine of x from those of the reduced r and the quadrant q.
+     * Branch free, so loops calling it stay vectorizable.
+     */
+    template<typename T>
+    inline void Unreduce(T q, T sr, T cr, T &s, T &c) {
+        typedef Reduction<T> R;
+        // quadrant q mod 4, kept in floating point so the loop stays vectorizable
+        T quarter = (q * T(0.25) - T(0.375) + R::RoundMagic()) - R::RoundMagic();
+        T quadrant = q - T(4.0) * quarter;
+        bool swap = quadrant == T(1.0) || quadrant == T(3.0);
+        T sv = swap ? cr : sr;
+        T cv = swap ? sr : cr;
+        s = quadrant > T(1.5) ? -sv : sv;
+        c = quadrant > T(0.5) && quadrant < T(2.5) ? -cv : cv;
+    }
+
+    /**
+     * Single precision sine and cosine for |x| < Reduction<float>::MaxReduced(),
+     * Cephes sinf/cosf polynomials, absolute error below 1.2e-7 against
+     * sinf/cosf.
+     */
+    inline void SinCosReduced(float x, float &s, float &c) {
+        float q;
+        float r = Reduce(x, q);
+        float z = r * r;
+        float sr = r + r * z * ((-1.9515295891e-4f * z
+                                 + 8.3321608736e-3f) * z
+                                - 1.6666654611e-1f);
+        float cr = 1.0f - 0.5f * z + z * z * ((2.443315711809948e-5f * z
+                                               - 1.388731625493765e-3f) * z
+                                              + 4.166664568298827e-2f);
+        Unreduce(q, sr, cr, s, c);
+    }
+
+    /**
+     * Fast sine and cosine for |x| < kMaxReduced, degree 7 and 6 minimax
+     * polynomials on [-pi/4, pi/4]. Absolute error below 4e-8, the quadrants
+     * swap the polynomials so the bound holds for both.
+     */
+    inline void FastSinCosReduced(double x, double &s, double &c) {
+        double q;
+        double r = Reduce(x, q);
+        double z = r * r;
+        double sr = r + r * z * ((-1.94956361256835e-4 * z
+                                  + 8.33197866210143e-3) * z
+                                 - 1.66666506692708e-1);
+        double cr = 1.0 + z * ((-1.35978230951046e-3 * z
+                                + 4.16562945768827e-2) * z
+                               - 4.99998947813348e-1);
+        Unreduce(q, sr, cr, s, c);
+    }
+
+    /**
+     * Fast sine and cosine for any x, large inputs and NaN use libm
+     */
+    inline void FastSinCos(double x, double &s, double &c) {
+        if (std::fabs(x) < kMaxReduced) {
+            FastSinCosReduced(x, s, c);
+        } else {
+            s = std::sin(x);
+            c = std::cos(x);
+        }
+    }
+
+    /**
+     * Fast atan2. The ratio of the smaller to the larger coordinate is
+     * reduced to [-tan(pi/8), tan(pi/8)] and evaluated with a degree 9
+     * minimax polynomial. Absolute error below 1e-8 rad, atan2(0, 0) is 0.
+     */
+    inline double FastAtan2(double y, double x) {
+        double ax = std::fabs(x);
+        double ay = std::fabs(y);
+        double hi = ax > ay ? ax : ay;
+        double lo = ax > ay ? ay : ax;
+        double t = hi > 0 ? lo / hi : 0;
+
+        // atan(t) = pi/4 + atan((t - 1) / (t + 1))
+        bool shift = t > 0.41421356237309503;
+        double u = shift ? (t - 1) / (t + 1) : t;
+        double z = u * u;
+        double a = u + u * z * (((7.90259776651056e-2 * z
+                                  - 1.38244536114853e-1) * z
+                                 + 1.99718792900192e-1) * z
+                                - 3.33327566685754e-1);
+        if (shift) {
+            a += M_PI_4;
+        }
+
+        if (ay > ax) {
+            a = M_PI_2 - a;
+        }
+        if (x < 0) {
+            a = M_PI - a;
+        }
+        return y < 0 ? -a : a;
+    }
+
+    /**
+     * libm, the default
+     */
+    struct Exact {
+        template<typename T>
+        static void SinCos(T x, T &s, T &c) {
+            s = std::sin(x);
+            c = std::cos(x);
+        }
+
+        template<typename T>
+        static T Atan2(T y, T x) {
+            return std::atan2(y, x);
+        }
+    };
+
+    /**
+     * Polynomial approximations, opt-in with UKF::use_fast_trig_
+     */
+    struct Fast {
+        static void SinCos(double x, double &s, double &c) {
+            FastSinCos(x, s, c);
+        }
+
+        static double Atan2(double y, double x) {
+            return FastAtan2(y, x);
+        }
+
+        ///* the polynomials are below float resolution, so float rounds once
+        static void SinCos(float x, float &s, float &c) {
+            double s_d, c_d;
+            FastSinCos(x, s_d, c_d);
+            s = (float) s_d;
+            c = (float) c_d;
+        }
+
+        static float Atan2(float y, float x) {
+            return (float) FastAtan2(y, x);
+        }
+    };
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_FAST_TRIG_HPP
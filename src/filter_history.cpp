@@ -0,0 +1,102 @@
+#include "filter_history.hpp"
+
+template<class Filter>
+FilterHistoryT<Filter>::FilterHistoryT(Filter &ukf, long max_lag, int capacity)
+        : late_count_(0), dropped_count_(0), ukf_(ukf), max_lag_(max_lag),
+          entries_(capacity > 1 ? capacity : 1), head_(0), size_(0), late_(false) {}
+
+template<class Filter>
+FilterHistoryT<Filter>::~FilterHistoryT() {}
+
+template<class Filter>
+typename FilterHistoryT<Filter>::Entry &FilterHistoryT<Filter>::At(int i) {
+    return entries_[(head_ + i) % entries_.size()];
+}
+
+template<class Filter>
+bool FilterHistoryT<Filter>::Process(const MeasurementPackage &meas_package) {
+    return Insert(meas_package, NULL);
+}
+
+template<class Filter>
+bool FilterHistoryT<Filter>::ProcessJoint(const MeasurementPackage &laser_pack, const MeasurementPackage &radar_pack) {
+    return Insert(laser_pack, &radar_pack);
+}
+
+template<class Filter>
+const Filter &FilterHistoryT<Filter>::Applied() const {
+    return late_ ? applied_ : ukf_;
+}
+
+template<class Filter>
+void FilterHistoryT<Filter>::Apply(const Entry &entry) {
+    if (entry.joint) {
+        ukf_.ProcessJointMeasurement(entry.meas, entry.radar);
+    } else {
+        ukf_.ProcessMeasurement(entry.meas);
+    }
+}
+
+template<class Filter>
+bool FilterHistoryT<Filter>::Insert(const MeasurementPackage &meas_package, const MeasurementPackage *radar_pack) {
+    long timestamp = meas_package.timestamp_;
+    long newest = size_ > 0 ? At(size_ - 1).meas.timestamp_ : timestamp;
+
+    if (newest - timestamp > max_lag_) {
+        dropped_count_ += radar_pack != NULL ? 2 : 1;
+        return false;
+    }
+
+    // forget what does not fit, and entries no accepted measurement can go
+    // before: the oldest kept one is the restart point for the lag bound
+    long horizon = timestamp > newest ? timestamp : newest;
+    while (size_ == (int) entries_.size() ||
+           (size_ > 1 && horizon - At(1).meas.timestamp_ >= max_lag_)) {
+        head_ = (head_ + 1) % entries_.size();
+        size_--;
+    }
+
+    // position behind all entries of the same or an earlier time, there has
+    // to be an earlier one to restart from
+    int k = size_;
+    while (k > 0 && At(k - 1).meas.timestamp_ > timestamp) {
+        k--;
+    }
+    if (k == 0 && size_ > 0) {
+        dropped_count_ += radar_pack != NULL ? 2 : 1;
+        return false;
+    }
+    if (k < size_) {
+        late_count_ += radar_pack != NULL ? 2 : 1;
+        ukf_ = At(k).prior;
+        for (int i = size_; i > k; i--) {
+            At(i) = At(i - 1);
+        }
+    }
+    size_++;
+
+    Entry &entry = At(k);
+    entry.meas = meas_package;
+    entry.joint = radar_pack != NULL;
+    if (entry.joint) {
+        entry.radar = *radar_pack;
+    }
+
+    // process the new measurement and everything after it again
+    late_ = k < size_ - 1;
+    for (int i = k; i < size_; i++) {
+        Entry &current = At(i);
+        current.prior = ukf_;
+        Apply(current);
+        if (i == k && late_) {
+            applied_ = ukf_;
+        }
+    }
+    return true;
+}
+
+template class FilterHistoryT<UKF>;
+
+template class FilterHistoryT<UKFT<float> >;
+
+template class FilterHistoryT<IMM>;
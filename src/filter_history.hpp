@@ -0,0 +1,92 @@
+#ifndef UNSCENTED_KALMAN_FILTER_FILTER_HISTORY_HPP
+#define UNSCENTED_KALMAN_FILTER_FILTER_HISTORY_HPP
+
+#include <vector>
+#include "lib/Eigen/StdVector"
+#include "imm.hpp"
+#include "measurement_package.hpp"
+#include "ukf.hpp"
+
+/**
+ * Handles out-of-sequence measurements for a UKF.
+ *
+ * The recent measurements are kept in a ring buffer together with the filter
+ * state before each of them. A measurement that arrives late is inserted at
+ * its time: the filter is reset to the state before the first newer
+ * measurement and the tail of the buffer is processed again. Measurements
+ * older than the lag bound or than the oldest buffered one are dropped.
+ * Instantiated for UKF, UKFT<float> and IMM.
+ */
+template<class Filter>
+class FilterHistoryT {
+public:
+    /**
+     * @param ukf The filter to drive, keeps the newest state
+     * @param max_lag Oldest accepted lag behind the newest measurement in us
+     * @param capacity Number of buffered measurements, bounds the memory
+     */
+    FilterHistoryT(Filter &ukf, long max_lag, int capacity);
+
+    virtual ~FilterHistoryT();
+
+    /**
+     * Processes a measurement, late ones at their time
+     * @return false if the measurement was too old and dropped
+     */
+    bool Process(const MeasurementPackage &meas_package);
+
+    /**
+     * Processes a laser and a radar measurement of the same time jointly
+     * @return false if the measurements were too old and dropped
+     */
+    bool ProcessJoint(const MeasurementPackage &laser_pack, const MeasurementPackage &radar_pack);
+
+    /**
+     * @return The filter right after the measurement of the last Process or
+     * ProcessJoint call, the estimate and NIS its row shows. For a late
+     * measurement that is not the newest state of the filter.
+     */
+    const Filter &Applied() const;
+
+    ///* number of measurements processed out of sequence
+    long late_count_;
+
+    ///* number of measurements dropped as too old
+    long dropped_count_;
+
+private:
+    struct Entry {
+        MeasurementPackage meas;
+        ///* radar measurement of a joint update, meas is then the laser one
+        MeasurementPackage radar;
+        bool joint;
+        ///* filter state before the measurement
+        Filter prior;
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    Filter &ukf_;
+    long max_lag_;
+    std::vector<Entry, Eigen::aligned_allocator<Entry> > entries_;
+    ///* ring buffer position of the oldest entry and number of entries
+    int head_;
+    int size_;
+    ///* the filter after the last measurement if newer ones were processed
+    ///* again after it, see Applied
+    Filter applied_;
+    bool late_;
+
+    Entry &At(int i);
+
+    bool Insert(const MeasurementPackage &meas_package, const MeasurementPackage *radar_pack);
+
+    void Apply(const Entry &entry);
+
+    FilterHistoryT(const FilterHistoryT &);
+    FilterHistoryT &operator=(const FilterHistoryT &);
+};
+
+typedef FilterHistoryT<UKF> FilterHistory;
+
+#endif //UNSCENTED_KALMAN_FILTER_FILTER_HISTORY_HPP
@@ -5,6 +5,9 @@
 
 class GroundTruthPackage {
 public:
+    ///* [px py vx vy], unaligned so packages can be stored in any container
+    typedef Eigen::Matrix<double, 4, 1, Eigen::DontAlign> GroundTruthVector;
+
     long timestamp_;
 
     enum SensorType {
@@ -12,7 +15,7 @@ public:
         RADAR
     } sensor_type_;
 
-    Eigen::VectorXd gt_values_;
+    GroundTruthVector gt_values_;
 
 };
 
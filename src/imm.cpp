@@ -0,0 +1,340 @@
+#include <cmath>
+#include "imm.hpp"
+#include "ctrv_kernel.hpp"
+#include "tools.hpp"
+
+const int IMM::n_x_;
+const int IMM::n_aug_;
+const int IMM::n_sig_;
+const int IMM::n_sig_x_;
+const int IMM::n_models_;
+
+static_assert(IMM::n_x_ > models::n_x, "the IMM state has to extend the state of the measurement models");
+
+namespace {
+    const int kBlock = 64;
+
+    /**
+     * Propagates sigma points through the CTRA process model without noise.
+     * CTRV and CV are CTRA with the acceleration, and also the yaw rate,
+     * masked out. Branch free like ctrv::PredictSigmaPoints.
+     * @param Xsig Row-major 6 x n matrix [p_x p_y v yaw yawd a]
+     * @param Xsig_pred Row-major 6 x n output matrix
+     * @param turn_mask, accel_mask 1 where the yaw rate or the acceleration is modelled, else 0
+     */
+    void predictSigmaPoints(const double *Xsig, double *Xsig_pred, const double *turn_mask,
+                            const double *accel_mask, int n, double delta_t,
+                            void (*sin_cos)(const double *, double *, double *, int)) {
+        const double dt2 = 0.5 * delta_t * delta_t;
+
+        for (int begin = 0; begin < n; begin += kBlock) {
+            const int m = n - begin < kBlock ? n - begin : kBlock;
+
+            const double *p_x = Xsig + begin;
+            const double *p_y = p_x + n;
+            const double *v = p_y + n;
+            const double *yaw = v + n;
+            const double *yawd = yaw + n;
+            const double *acc = yawd + n;
+            const double *turn = turn_mask + begin;
+            const double *accel = accel_mask + begin;
+
+            double *px_p = Xsig_pred + begin;
+            double *py_p = px_p + n;
+            double *v_p = py_p + n;
+            double *yaw_p = v_p + n;
+            double *yawd_p = yaw_p + n;
+            double *acc_p = yawd_p + n;
+
+            double w[kBlock], a[kBlock];
+            double sin_yaw[kBlock], cos_yaw[kBlock];
+            double sin_yaw_p[kBlock], cos_yaw_p[kBlock];
+
+            for (int i = 0; i < m; i++) {
+                w[i] = yawd[i] * turn[i];
+                a[i] = acc[i] * accel[i];
+                yaw_p[i] = yaw[i] + w[i] * delta_t;
+            }
+            sin_cos(yaw, sin_yaw, cos_yaw, m);
+            sin_cos(yaw_p, sin_yaw_p, cos_yaw_p, m);
+
+            //both branches are computed for every point and selected, the
+            //turn uses 1 as yaw rate where it is not taken
+            double inv_w[kBlock];
+            for (int i = 0; i < m; i++) {
+                inv_w[i] = 1.0 / (std::fabs(w[i]) > 0.001 ? w[i] : 1.0);
+            }
+
+            for (int i = 0; i < m; i++) {
+                double v_end = v[i] + a[i] * delta_t;
+                double turn_x = ((v_end * sin_yaw_p[i] - v[i] * sin_yaw[i])
+                                 + a[i] * inv_w[i] * (cos_yaw_p[i] - cos_yaw[i])) * inv_w[i];
+                double straight = (v[i] * delta_t + a[i] * dt2) * cos_yaw[i];
+                px_p[i] = p_x[i] + (std::fabs(w[i]) > 0.001 ? turn_x : straight);
+            }
+            for (int i = 0; i < m; i++) {
+                double v_end = v[i] + a[i] * delta_t;
+                double turn_y = ((v[i] * cos_yaw[i] - v_end * cos_yaw_p[i])
+                                 + a[i] * inv_w[i] * (sin_yaw_p[i] - sin_yaw[i])) * inv_w[i];
+                double straight = (v[i] * delta_t + a[i] * dt2) * sin_yaw[i];
+                py_p[i] = p_y[i] + (std::fabs(w[i]) > 0.001 ? turn_y : straight);
+            }
+            for (int i = 0; i < m; i++) {
+                v_p[i] = v[i] + a[i] * delta_t;
+            }
+            for (int i = 0; i < m; i++) {
+                yawd_p[i] = yawd[i];
+            }
+            for (int i = 0; i < m; i++) {
+                acc_p[i] = acc[i];
+            }
+        }
+    }
+}
+
+/**
+ * Initializes the models with the noise of the prototype. CV gets less yaw
+ * noise and CTRA is the agile model with more; the models stay in their mode
+ * with 95% per measurement. Tuned on the sample logs.
+ */
+IMM::IMM(const UKF &prototype) {
+    use_fast_trig_ = prototype.use_fast_trig_;
+
+    stats_ = NULL;
+
+    previous_timestamp_ = 0;
+
+    NIS_radar_ = 0;
+
+    NIS_laser_ = 0;
+
+    lidar_model_ = prototype.lidar_model_;
+    radar_model_ = prototype.radar_model_;
+
+    std_a_ << prototype.std_a_, prototype.std_a_, 1.0;
+    std_yawdd_ << 0.5, prototype.std_yawdd_, 3.0;
+
+    transition_ << 0.95, 0.025, 0.025,
+            0.025, 0.95, 0.025,
+            0.025, 0.025, 0.95;
+
+    lambda_ = 3 - n_aug_;
+    weights_.fill(0.5 / (n_aug_ + lambda_));
+    weights_(0) = lambda_ / (lambda_ + n_aug_);
+
+    Reset();
+
+    for (int j = 0; j < n_models_; j++) {
+        turn_mask_.segment<n_sig_x_>(j * n_sig_x_).setConstant(j == CV ? 0 : 1);
+        accel_mask_.segment<n_sig_x_>(j * n_sig_x_).setConstant(j == CTRA ? 1 : 0);
+    }
+}
+
+IMM::~IMM() {}
+
+void IMM::Reset() {
+    is_initialized_ = false;
+
+    // initial state vector and covariance, 1 m/s^2 initial acceleration uncertainty
+    x_.fill(0.0);
+    P_.setZero();
+    P_.topLeftCorner<models::n_x, models::n_x>() = UKF::InitialCovariance();
+    P_(n_x_ - 1, n_x_ - 1) = 1;
+    mu_.fill(1.0 / n_models_);
+    for (int j = 0; j < n_models_; j++) {
+        x_models_.col(j) = x_;
+        P_models_[j] = P_;
+    }
+}
+
+void IMM::ProcessMeasurement(const MeasurementPackage &measurement_pack) {
+    if (is_initialized_ && prediction::IsStale(previous_timestamp_, measurement_pack.timestamp_)) {
+        Reset();
+    }
+    if (measurement_pack.sensor_type_ == MeasurementPackage::RADAR) {
+        const models::RadarModel::Vector z = measurement_pack.raw_measurements_.head<models::RadarModel::n_z>();
+        if (!is_initialized_) {
+            Initialize(radar_model_, z);
+            previous_timestamp_ = measurement_pack.timestamp_;
+            return;
+        }
+        PredictTo(measurement_pack.timestamp_);
+        timing::ScopedTimer timer(stats_, timing::RADAR_UPDATE);
+        NIS_radar_ = Update(radar_model_, z);
+    } else {
+        const models::LidarModel::Vector z = measurement_pack.raw_measurements_.head<models::LidarModel::n_z>();
+        if (!is_initialized_) {
+            Initialize(lidar_model_, z);
+            previous_timestamp_ = measurement_pack.timestamp_;
+            return;
+        }
+        PredictTo(measurement_pack.timestamp_);
+        timing::ScopedTimer timer(stats_, timing::LIDAR_UPDATE);
+        NIS_laser_ = Update(lidar_model_, z);
+    }
+}
+
+void IMM::ProcessJointMeasurement(const MeasurementPackage &laser_pack, const MeasurementPackage &radar_pack) {
+    if (is_initialized_ && prediction::IsStale(previous_timestamp_, laser_pack.timestamp_)) {
+        Reset();
+    }
+    if (!is_initialized_) {
+        ProcessMeasurement(laser_pack);
+        ProcessMeasurement(radar_pack);
+        return;
+    }
+
+    PredictTo(laser_pack.timestamp_);
+    timing::ScopedTimer timer(stats_, timing::JOINT_UPDATE);
+
+    typedef models::StackedModel<models::LidarModel, models::RadarModel> Stacked;
+    Stacked model(lidar_model_, radar_model_);
+    Stacked::Vector z;
+    z << laser_pack.raw_measurements_.head<models::LidarModel::n_z>(),
+            radar_pack.raw_measurements_.head<models::RadarModel::n_z>();
+
+    Stacked::Vector z_diff;
+    Stacked::Matrix S;
+    Update(model, z, &z_diff, &S);
+
+    //marginal NIS of each measurement against its block of S
+    models::LidarModel::Vector z_diff_laser = z_diff.head<models::LidarModel::n_z>();
+    models::RadarModel::Vector z_diff_radar = z_diff.tail<models::RadarModel::n_z>();
+    models::LidarModel::Matrix S_laser = S.topLeftCorner<models::LidarModel::n_z, models::LidarModel::n_z>();
+    models::RadarModel::Matrix S_radar = S.bottomRightCorner<models::RadarModel::n_z, models::RadarModel::n_z>();
+    NIS_laser_ = z_diff_laser.transpose() * S_laser.inverse() * z_diff_laser;
+    NIS_radar_ = z_diff_radar.transpose() * S_radar.inverse() * z_diff_radar;
+}
+
+void IMM::PredictTo(long timestamp) {
+    timing::ScopedTimer timer(stats_, timing::PREDICT);
+    double dt = (timestamp - previous_timestamp_) / 1000000.0;
+    previous_timestamp_ = timestamp;
+
+    Mix();
+
+    // long gaps in equal smaller steps, as in UKF::PredictTo
+    int steps = prediction::StepCount(dt);
+    for (int i = 0; i < steps; i++) {
+        Prediction(dt / steps);
+    }
+
+    Combine();
+}
+
+/**
+ * c_j = sum_i p_ij mu_i is the predicted probability of model j and
+ * p_ij mu_i / c_j the weight of model i in the mixed start of model j.
+ */
+void IMM::Mix() {
+    ModelVector c = transition_.transpose() * mu_;
+    ModelMatrix weights = transition_.array().colwise() * mu_.array();
+    weights = weights.array().rowwise() / c.transpose().array();
+
+    ModelStates x_mixed = x_models_ * weights;
+    StateMatrix P_mixed[n_models_];
+    for (int j = 0; j < n_models_; j++) {
+        P_mixed[j].setZero();
+        for (int i = 0; i < n_models_; i++) {
+            StateVector x_diff = x_models_.col(i) - x_mixed.col(j);
+            x_diff(3) = tools::NormalizeAngle(x_diff(3));
+            P_mixed[j] += weights(i, j) * (P_models_[i] + x_diff * x_diff.transpose());
+        }
+    }
+
+    x_models_ = x_mixed;
+    for (int j = 0; j < n_models_; j++) {
+        P_models_[j] = P_mixed[j];
+    }
+    mu_ = c;
+}
+
+void IMM::Combine() {
+    x_ = x_models_ * mu_;
+    P_.setZero();
+    for (int j = 0; j < n_models_; j++) {
+        StateVector x_diff = x_models_.col(j) - x_;
+        x_diff(3) = tools::NormalizeAngle(x_diff(3));
+        P_ += mu_(j) * (P_models_[j] + x_diff * x_diff.transpose());
+    }
+}
+
+/**
+ * Generates the sigma points of every model from its own state and predicts
+ * all of them in one kernel call. P_aug is block diagonal with the noise
+ * variances, so only the state block is factored. The noise sigma points
+ * have the mean state, and the noise enters the models linearly with the
+ * gain of the mean: their prediction is that of the center point plus the
+ * scaled gain, as the augmented kernel would compute it.
+ */
+void IMM::Prediction(double delta_t) {
+    const double scale = std::sqrt(lambda_ + n_aug_);
+    for (int j = 0; j < n_models_; j++) {
+        StateMatrix L = P_models_[j].llt().matrixL();
+        L *= scale;
+
+        auto Xsig = Xsig_.middleCols<n_sig_x_>(j * n_sig_x_);
+        Xsig.colwise() = x_models_.col(j);
+        Xsig.block<n_x_, n_x_>(0, 1) += L;
+        Xsig.block<n_x_, n_x_>(0, n_x_ + 1) -= L;
+    }
+
+    void (*sin_cos)(const double *, double *, double *, int) = ctrv::SinCos;
+    if (use_fast_trig_) {
+        sin_cos = ctrv::SinCosFast;
+    }
+    predictSigmaPoints(Xsig_.data(), Xsig_x_pred_.data(), turn_mask_.data(), accel_mask_.data(),
+                       n_models_ * n_sig_x_, delta_t, sin_cos);
+
+    const double dt2 = 0.5 * delta_t * delta_t;
+    const double dt3 = delta_t * delta_t * delta_t / 6;
+    for (int j = 0; j < n_models_; j++) {
+        auto Xsig_pred = Xsig_pred_.middleCols<n_sig_>(j * n_sig_);
+        Xsig_pred.leftCols<n_sig_x_>() = Xsig_x_pred_.middleCols<n_sig_x_>(j * n_sig_x_);
+
+        //gain of the acceleration noise, for CTRA it changes the acceleration
+        double yaw = x_models_(3, j);
+        bool accel = j == CTRA;
+        StateVector gain_a;
+        gain_a << std::cos(yaw), std::sin(yaw), 0, 0, 0, 0;
+        gain_a *= accel ? dt3 : dt2;
+        gain_a(2) = accel ? dt2 : delta_t;
+        gain_a(5) = accel ? delta_t : 0;
+        gain_a *= scale * std_a_(j);
+
+        StateVector gain_yawdd;
+        gain_yawdd << 0, 0, 0, dt2, delta_t, 0;
+        gain_yawdd *= scale * std_yawdd_(j);
+
+        StateVector center = Xsig_pred.col(0);
+        Xsig_pred.col(n_sig_x_) = center + gain_a;
+        Xsig_pred.col(n_sig_x_ + 1) = center + gain_yawdd;
+        Xsig_pred.col(n_sig_x_ + 2) = center - gain_a;
+        Xsig_pred.col(n_sig_x_ + 3) = center - gain_yawdd;
+    }
+
+    //mean and covariance of every model, rows of the row-major deviations
+    //are contiguous so every covariance entry is one dot product
+    Eigen::Matrix<double, n_x_, n_sig_, Eigen::RowMajor> X_diff, X_weighted;
+    for (int j = 0; j < n_models_; j++) {
+        auto Xsig_pred = Xsig_pred_.middleCols<n_sig_>(j * n_sig_);
+        StateVector x = Xsig_pred * weights_;
+
+        for (int r = 0; r < n_x_; r++) {
+            X_diff.row(r) = Xsig_pred.row(r).array() - x(r);
+        }
+        for (int i = 0; i < n_sig_; i++) {
+            X_diff(3, i) = tools::NormalizeAngle(X_diff(3, i));
+        }
+        X_weighted = X_diff.array().rowwise() * weights_.transpose().array();
+
+        StateMatrix &P = P_models_[j];
+        for (int r = 0; r < n_x_; r++) {
+            for (int c = 0; c <= r; c++) {
+                P(r, c) = X_weighted.row(r).dot(X_diff.row(c));
+                P(c, r) = P(r, c);
+            }
+        }
+        x_models_.col(j) = x;
+    }
+}
@@ -0,0 +1,309 @@
+#ifndef UNSCENTED_KALMAN_FILTER_IMM_HPP
+#define UNSCENTED_KALMAN_FILTER_IMM_HPP
+
+#include "lib/Eigen/Dense"
+#include "measurement_models.hpp"
+#include "measurement_package.hpp"
+#include "timing.hpp"
+#include "ukf.hpp"
+
+/**
+ * Interacting Multiple Model estimator with constant velocity (CV), constant
+ * turn rate and velocity (CTRV) and constant turn rate and acceleration
+ * (CTRA) unscented filters.
+ *
+ * All models share the state [pos1 pos2 vel_abs yaw_angle yaw_rate
+ * acceleration]; CV ignores the yaw rate and CV and CTRV the acceleration,
+ * which they carry along for the mixing. The state sigma points of all models
+ * are kept in one matrix and predicted in one pass of a CTRA kernel that masks
+ * the unused terms per model. The process noise enters all models linearly,
+ * so the sigma points of the noise are the predicted center point plus a
+ * noise column and need no kernel evaluation. The mixing and the model
+ * probabilities are matrix operations across the models.
+ */
+class IMM {
+public:
+    ///* State dimension
+    static const int n_x_ = 6;
+
+    ///* Augmented state dimension
+    static const int n_aug_ = n_x_ + 2;
+
+    ///* Number of sigma points per model
+    static const int n_sig_ = 2 * n_aug_ + 1;
+
+    ///* Number of sigma points per model that go through the process model
+    static const int n_sig_x_ = 2 * n_x_ + 1;
+
+    ///* Number of motion models
+    static const int n_models_ = 3;
+
+    enum MotionModel {
+        CV,
+        CTRV,
+        CTRA
+    };
+
+    typedef Eigen::Matrix<double, n_x_, 1> StateVector;
+    typedef Eigen::Matrix<double, n_x_, n_x_> StateMatrix;
+    typedef Eigen::Matrix<double, n_x_, n_models_ * n_sig_x_, Eigen::RowMajor> StateSigmaMatrix;
+    typedef Eigen::Matrix<double, n_x_, n_models_ * n_sig_, Eigen::RowMajor> SigmaMatrix;
+    typedef Eigen::Matrix<double, n_sig_, 1> WeightVector;
+    typedef Eigen::Matrix<double, n_models_, 1> ModelVector;
+    typedef Eigen::Matrix<double, n_models_, n_models_> ModelMatrix;
+    typedef Eigen::Matrix<double, n_x_, n_models_> ModelStates;
+
+    ///* initially set to false, set to true in first call of ProcessMeasurement
+    bool is_initialized_;
+
+    ///* if true the models use the trig::Fast approximations
+    bool use_fast_trig_;
+
+    ///* if not NULL the prediction and update stages are timed into it
+    timing::StageStats *stats_;
+
+    ///* combined state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate acceleration]
+    StateVector x_;
+
+    ///* combined state covariance matrix
+    StateMatrix P_;
+
+    ///* state of each model, one column per MotionModel
+    ModelStates x_models_;
+
+    ///* state covariance of each model
+    StateMatrix P_models_[n_models_];
+
+    ///* model probabilities
+    ModelVector mu_;
+
+    ///* Markov chain of the models, (i, j) is the probability to switch from i to j
+    ModelMatrix transition_;
+
+    ///* per model process noise standard deviation longitudinal acceleration in
+    ///* m/s^2, for CTRA the change of the acceleration in m/s^3
+    ModelVector std_a_;
+
+    ///* per model process noise standard deviation yaw acceleration in rad/s^2
+    ModelVector std_yawdd_;
+
+    ///* measurement models with the noise of the sensors
+    models::LidarModel lidar_model_;
+
+    models::RadarModel radar_model_;
+
+    ///* previous_timestamp  in us
+    long previous_timestamp_;
+
+    ///* Weights of sigma points
+    WeightVector weights_;
+
+    ///* Sigma point spreading parameter
+    double lambda_;
+
+    ///* the current NIS for radar, against the combined innovation covariance
+    double NIS_radar_;
+
+    ///* the current NIS for laser, against the combined innovation covariance
+    double NIS_laser_;
+
+    /**
+     * Constructor
+     * @param prototype Filter whose measurement noise, initial covariance and
+     * trigonometry mode are used. Its process noise is the one of CTRV.
+     */
+    explicit IMM(const UKF &prototype = UKF());
+
+    /**
+     * Destructor
+     */
+    virtual ~IMM();
+
+    /**
+     * Forgets the state of all models, the next measurement initializes the
+     * filter again
+     */
+    void Reset();
+
+    /**
+     * ProcessMeasurement, after a gap longer than prediction::kMaxGap it
+     * initializes the filter again
+     * @param meas_package The latest measurement data of either radar or laser
+     */
+    void ProcessMeasurement(const MeasurementPackage &measurement_pack);
+
+    /**
+     * Processes a laser and a radar measurement with the same timestamp with
+     * one prediction and one stacked update. Sets the marginal NIS of both.
+     */
+    void ProcessJointMeasurement(const MeasurementPackage &laser_pack, const MeasurementPackage &radar_pack);
+
+    /**
+     * Mixes the models and predicts them to the given time, long gaps in
+     * several steps
+     * @param timestamp Time in us
+     */
+    void PredictTo(long timestamp);
+
+    /**
+     * Predicts the sigma points, state and covariance of every model
+     * @param delta_t Time between k and k+1 in s
+     */
+    void Prediction(double delta_t);
+
+    /**
+     * Updates every model with a measurement of any sensor model, then the
+     * model probabilities and the combined estimate
+     * @param z_diff_out If given, receives the combined residual
+     * @param S_out If given, receives the combined innovation covariance
+     * @return The NIS of the measurement against the combined prediction
+     */
+    template<class Model>
+    double Update(const Model &model, const typename Model::Vector &z,
+                  typename Model::Vector *z_diff_out = NULL, typename Model::Matrix *S_out = NULL);
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+    ///* state sigma points of all models, model j in columns j * n_sig_x_ to (j + 1) * n_sig_x_ - 1
+    StateSigmaMatrix Xsig_;
+
+    ///* their prediction without noise
+    StateSigmaMatrix Xsig_x_pred_;
+
+    ///* predicted sigma points of all models, model j in columns j * n_sig_ to
+    ///* (j + 1) * n_sig_ - 1: the state sigma points followed by the noise ones
+    SigmaMatrix Xsig_pred_;
+
+    ///* per sigma point masks of the yaw rate and acceleration terms
+    Eigen::Matrix<double, 1, n_models_ * n_sig_x_> turn_mask_;
+    Eigen::Matrix<double, 1, n_models_ * n_sig_x_> accel_mask_;
+
+    /**
+     * Replaces the model states by their mixture weighted with the
+     * probability of each model to switch into the other
+     */
+    void Mix();
+
+    /**
+     * Combines the model states into x_ and P_
+     */
+    void Combine();
+
+    /**
+     * Initializes all models from the first measurement
+     */
+    template<class Model>
+    void Initialize(const Model &model, const typename Model::Vector &z);
+};
+
+template<class Model>
+void IMM::Initialize(const Model &model, const typename Model::Vector &z) {
+    models::StateVector x;
+    models::StateMatrix P = P_.topLeftCorner<models::n_x, models::n_x>();
+    model.Initialize(z, x, P);
+    x_ << x, 0;
+    P_.topLeftCorner<models::n_x, models::n_x>() = P;
+    for (int j = 0; j < n_models_; j++) {
+        x_models_.col(j) = x_;
+        P_models_[j] = P_;
+    }
+    is_initialized_ = true;
+}
+
+template<class Model>
+double IMM::Update(const Model &model, const typename Model::Vector &z,
+                   typename Model::Vector *z_diff_out, typename Model::Matrix *S_out) {
+    const int n_z = Model::n_z;
+    typedef typename Model::Vector ZVector;
+    typedef typename Model::Matrix ZMatrix;
+    typedef Eigen::Matrix<double, n_x_, n_z> CrossMatrix;
+
+    //predicted measurement, innovation covariance and cross correlation of every model
+    Eigen::Matrix<double, n_z, n_models_> z_preds;
+    ZMatrix S_models[n_models_];
+    CrossMatrix Tc_models[n_models_];
+    if constexpr (Model::is_linear) {
+        Eigen::Matrix<double, n_z, n_x_> H = Eigen::Matrix<double, n_z, n_x_>::Zero();
+        H.template leftCols<models::n_x>() = model.H;
+        for (int j = 0; j < n_models_; j++) {
+            z_preds.col(j) = H * x_models_.col(j);
+            Tc_models[j] = P_models_[j] * H.transpose();
+            S_models[j] = H * Tc_models[j] + model.R;
+        }
+    } else {
+        //transform the sigma points of all models into measurement space
+        Eigen::Matrix<double, n_z, n_models_ * n_sig_> Zsig;
+        for (int i = 0; i < n_models_ * n_sig_; i++) {
+            models::StateVector x = Xsig_pred_.col(i).template head<models::n_x>();
+            if (use_fast_trig_) {
+                Zsig.col(i) = models::Measure<trig::Fast>(model, x);
+            } else {
+                Zsig.col(i) = models::Measure<trig::Exact>(model, x);
+            }
+        }
+
+        //deviations from the means, the covariances are then matrix products
+        Eigen::Matrix<double, n_z, n_sig_> Z_diff;
+        Eigen::Matrix<double, n_x_, n_sig_> X_diff;
+        for (int j = 0; j < n_models_; j++) {
+            ZVector z_pred = Zsig.template middleCols<n_sig_>(j * n_sig_) * weights_;
+            z_preds.col(j) = z_pred;
+            for (int i = 0; i < n_sig_; i++) {
+                ZVector z_diff = Zsig.col(j * n_sig_ + i) - z_pred;
+                Model::Normalize(z_diff);
+                Z_diff.col(i) = z_diff;
+                X_diff.col(i) = Xsig_pred_.col(j * n_sig_ + i) - x_models_.col(j);
+                X_diff(3, i) = tools::NormalizeAngle(X_diff(3, i));
+            }
+            Eigen::Matrix<double, n_sig_, n_z> Z_weighted = weights_.asDiagonal() * Z_diff.transpose();
+            S_models[j] = Z_diff * Z_weighted + model.R;
+            Tc_models[j] = X_diff * Z_weighted;
+        }
+    }
+
+    ModelVector log_likelihood;
+    for (int j = 0; j < n_models_; j++) {
+        ZVector z_diff = z - z_preds.col(j);
+        Model::Normalize(z_diff);
+
+        //Kalman update of the model
+        Eigen::LDLT<ZMatrix> ldlt(S_models[j]);
+        CrossMatrix K = ldlt.solve(Tc_models[j].transpose()).transpose();
+        x_models_.col(j) += K * z_diff;
+        P_models_[j] -= K * Tc_models[j].transpose();
+
+        //Gaussian log likelihood up to the constant shared by all models
+        double nis = z_diff.dot(ldlt.solve(z_diff));
+        log_likelihood(j) = -0.5 * (nis + std::log(ldlt.vectorD().prod()));
+    }
+
+    //NIS against the moment matched mixture of the model predictions,
+    //weighted with the predicted model probabilities
+    ZVector z_pred = z_preds * mu_;
+    ZMatrix S = ZMatrix::Zero();
+    for (int j = 0; j < n_models_; j++) {
+        ZVector spread = z_preds.col(j) - z_pred;
+        Model::Normalize(spread);
+        S += mu_(j) * (S_models[j] + spread * spread.transpose());
+    }
+
+    //model probabilities, relative to the most likely model so exp cannot underflow all of them
+    ModelVector likelihood = (log_likelihood.array() - log_likelihood.maxCoeff()).exp();
+    mu_ = mu_.cwiseProduct(likelihood);
+    mu_ /= mu_.sum();
+
+    Combine();
+
+    ZVector z_diff = z - z_pred;
+    Model::Normalize(z_diff);
+    if (z_diff_out != NULL) {
+        *z_diff_out = z_diff;
+    }
+    if (S_out != NULL) {
+        *S_out = S;
+    }
+    return z_diff.dot(S.ldlt().solve(z_diff));
+}
+
+#endif //UNSCENTED_KALMAN_FILTER_IMM_HPP
@@ -0,0 +1,52 @@
+#include <iostream>
+#include <string>
+#include "binary_log.hpp"
+#include "log_reader.hpp"
+
+using namespace std;
+
+/**
+ * Converts a tab separated L/R measurement log into the binary log format.
+ */
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        cout << "Usage: " << argv[0] << " <input.txt> <output.ukfb>" << endl;
+        return EXIT_FAILURE;
+    }
+    string in_file_name = argv[1];
+    string out_file_name = argv[2];
+
+    LogReader in_file;
+    if (!in_file.Open(in_file_name)) {
+        cerr << "Cannot open input file: " << in_file_name << endl;
+        return EXIT_FAILURE;
+    }
+    if (in_file.IsBinary()) {
+        cerr << "Input file is already a binary log: " << in_file_name << endl;
+        return EXIT_FAILURE;
+    }
+
+    binary_log::Writer out_file;
+    if (!out_file.Open(out_file_name)) {
+        cerr << "Cannot open output file: " << out_file_name << endl;
+        return EXIT_FAILURE;
+    }
+
+    MeasurementPackage meas_package;
+    GroundTruthPackage gt_package;
+    long records = 0;
+    while (in_file.Next(meas_package, gt_package)) {
+        if (!out_file.Write(meas_package, gt_package)) {
+            cerr << "Cannot write output file: " << out_file_name << endl;
+            return EXIT_FAILURE;
+        }
+        records++;
+    }
+
+    if (!out_file.Close()) {
+        cerr << "Cannot write output file: " << out_file_name << endl;
+        return EXIT_FAILURE;
+    }
+    cout << "Converted " << records << " measurements" << endl;
+    return EXIT_SUCCESS;
+}
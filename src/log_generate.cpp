@@ -0,0 +1,172 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include "binary_log.hpp"
+#include "output_writer.hpp"
+#include "parallel.hpp"
+#include "scenario.hpp"
+#include "lib/cxxopts.hpp"
+
+using namespace std;
+
+ScenarioOptions scenario;
+bool binary = false;
+bool split = false;
+int jobs = 0;
+string out_file_name_ = "";
+
+void parseOptions(int argc, char *argv[]) {
+    try {
+        cxxopts::Options options(argv[0], " - Generates a measurement log of CTRV targets with ground truth.\n"
+                "The same options and seed give the same log");
+
+        options.add_options()
+                ("h,help", "Print help")
+                ("o,output", "Output file, - is standard output", cxxopts::value<std::string>())
+                ("n,targets", "number of targets (default 1)", cxxopts::value<int>(scenario.targets))
+                ("d,duration", "length in s (default 25)", cxxopts::value<double>(scenario.duration))
+                ("lidar-rate", "lidar measurements per s and target, 0 disables (default 10)",
+                 cxxopts::value<double>(scenario.lidar_rate))
+                ("radar-rate", "radar measurements per s and target, 0 disables (default 10)",
+                 cxxopts::value<double>(scenario.radar_rate))
+                ("seed", "random seed (default 1)", cxxopts::value<uint64_t>(scenario.seed))
+                ("area", "edge length in m of the start area around the radar (default 100)",
+                 cxxopts::value<double>(scenario.area))
+                ("std-a", "process noise, as UKF::std_a_", cxxopts::value<double>(scenario.std_a))
+                ("std-yawdd", "process noise, as UKF::std_yawdd_", cxxopts::value<double>(scenario.std_yawdd))
+                ("std-laspx", "lidar noise, as UKF::std_laspx_ a variance", cxxopts::value<double>(scenario.std_laspx))
+                ("std-laspy", "lidar noise, as UKF::std_laspy_ a variance", cxxopts::value<double>(scenario.std_laspy))
+                ("std-radr", "radar noise, as UKF::std_radr_", cxxopts::value<double>(scenario.std_radr))
+                ("std-radphi", "radar noise, as UKF::std_radphi_", cxxopts::value<double>(scenario.std_radphi))
+                ("std-radrd", "radar noise, as UKF::std_radrd_", cxxopts::value<double>(scenario.std_radrd))
+                ("b,binary", "write the binary log format", cxxopts::value<bool>(binary))
+                ("split", "write one log per target into the output directory, for --multi",
+                 cxxopts::value<bool>(split))
+                ("j,jobs", "threads for --split, defaults to all cores", cxxopts::value<int>(jobs));
+
+        vector<string> optionals = {"output"};
+        options.parse_positional(optionals);
+
+        options.parse(argc, argv);
+
+        if (options.count("help")) {
+            cout << options.help({"", "Group"}) << endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        if (options.count("output") == 0) {
+            cout << "Please include an output file.\nUse -h to get more information" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        out_file_name_ = options["output"].as<string>();
+
+    } catch (const cxxopts::OptionException &e) {
+        std::cout << "error parsing options: " << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Writes a measurement as a line of the tab separated L/R log format
+ */
+void writeLogLine(OutputWriter &out_file, const MeasurementPackage &meas_package,
+                  const GroundTruthPackage &gt_package) {
+    bool radar = meas_package.sensor_type_ == MeasurementPackage::RADAR;
+    out_file.WriteText(radar ? "R" : "L");
+    for (int i = 0; i < meas_package.raw_measurements_.size(); i++) {
+        out_file.Write(meas_package.raw_measurements_(i));
+    }
+    out_file.WriteInteger(meas_package.timestamp_);
+    for (int i = 0; i < 4; i++) {
+        out_file.Write(gt_package.gt_values_(i));
+    }
+    out_file.EndRow();
+}
+
+/**
+ * Generates a scenario into a text or binary log
+ * @return The number of measurements, -1 if the file cannot be written
+ */
+long generate(const ScenarioOptions &options, const string &file_name) {
+    ScenarioGenerator generator(options);
+    MeasurementPackage meas_package;
+    GroundTruthPackage gt_package;
+    long records = 0;
+
+    if (binary) {
+        binary_log::Writer out_file;
+        if (!out_file.Open(file_name)) {
+            return -1;
+        }
+        while (generator.Next(meas_package, gt_package)) {
+            if (!out_file.Write(meas_package, gt_package)) {
+                return -1;
+            }
+            records++;
+        }
+        return out_file.Close() ? records : -1;
+    }
+
+    OutputWriter out_file;
+    if (!out_file.Open(file_name)) {
+        return -1;
+    }
+    while (generator.Next(meas_package, gt_package)) {
+        writeLogLine(out_file, meas_package, gt_package);
+        records++;
+    }
+    return out_file.Close() ? records : -1;
+}
+
+/**
+ * Writes target k of the scenario to <output>/target-k.txt, or .ukfb
+ */
+int generateSplit() {
+    std::error_code error;
+    filesystem::create_directories(out_file_name_, error);
+    if (error) {
+        cerr << "Cannot create output directory: " << out_file_name_ << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<long> records(scenario.targets > 0 ? scenario.targets : 0);
+    parallel::For((int) records.size(), jobs > 0 ? jobs : parallel::DefaultThreads(), [&](int i) {
+        ScenarioOptions options = scenario;
+        options.targets = 1;
+        options.first_target = scenario.first_target + i;
+        string file_name = (filesystem::path(out_file_name_) /
+                            ("target-" + to_string(options.first_target) + (binary ? ".ukfb" : ".txt"))).string();
+        records[i] = generate(options, file_name);
+        if (records[i] < 0) {
+            cerr << "Cannot write output file: " << file_name << endl;
+        }
+    });
+
+    long total = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (records[i] < 0) {
+            return EXIT_FAILURE;
+        }
+        total += records[i];
+    }
+    cerr << "Generated " << total << " measurements in " << records.size() << " logs" << endl;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    parseOptions(argc, argv);
+
+    if (split) {
+        return generateSplit();
+    }
+
+    long records = generate(scenario, out_file_name_);
+    if (records < 0) {
+        cerr << "Cannot write output file: " << out_file_name_ << endl;
+        return EXIT_FAILURE;
+    }
+    // the log itself can go to standard output
+    cerr << "Generated " << records << " measurements" << endl;
+    return EXIT_SUCCESS;
+}
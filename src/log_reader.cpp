@@ -0,0 +1,306 @@
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "binary_log.hpp"
+#include "log_reader.hpp"
+#include "output_writer.hpp"
+
+namespace {
+    inline const char *skipBlanks(const char *p, const char *end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            p++;
+        }
+        return p;
+    }
+
+    /**
+     * Parses the next whitespace separated number and advances p behind it.
+     * from_chars is locale independent and correctly rounded.
+     */
+    template<typename T>
+    inline bool parseField(const char *&p, const char *end, T &value) {
+        p = skipBlanks(p, end);
+        if (p < end && *p == '+') {
+            p++;
+        }
+        std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+    }
+}
+
+bool parseLine(const char *begin, const char *end,
+               MeasurementPackage &meas_package, GroundTruthPackage &gt_package) {
+    const char *p = skipBlanks(begin, end);
+    if (p == end) {
+        return false;
+    }
+
+    // reads first element from the current line
+    char sensor_type = *p++;
+    // a separator has to follow, "Lfoo" is not a laser line
+    if (p < end && *p != ' ' && *p != '\t') {
+        return false;
+    }
+    long timestamp = 0;
+    bool ok = true;
+
+    if (sensor_type == 'L') {
+        // LASER MEASUREMENT
+        meas_package.sensor_type_ = MeasurementPackage::LASER;
+        gt_package.sensor_type_ = GroundTruthPackage::LASER;
+        meas_package.raw_measurements_.resize(2);
+        ok = ok && parseField(p, end, meas_package.raw_measurements_(0));
+        ok = ok && parseField(p, end, meas_package.raw_measurements_(1));
+    } else if (sensor_type == 'R') {
+        // RADAR MEASUREMENT
+        meas_package.sensor_type_ = MeasurementPackage::RADAR;
+        gt_package.sensor_type_ = GroundTruthPackage::RADAR;
+        meas_package.raw_measurements_.resize(3);
+        ok = ok && parseField(p, end, meas_package.raw_measurements_(0));
+        ok = ok && parseField(p, end, meas_package.raw_measurements_(1));
+        ok = ok && parseField(p, end, meas_package.raw_measurements_(2));
+    } else {
+        return false;
+    }
+    ok = ok && parseField(p, end, timestamp);
+
+    // read ground truth data to compare later
+    for (int i = 0; i < 4; i++) {
+        ok = ok && parseField(p, end, gt_package.gt_values_(i));
+    }
+    if (ok) {
+        meas_package.timestamp_ = timestamp;
+        gt_package.timestamp_ = timestamp;
+    }
+
+    return ok;
+}
+
+LogReader::LogReader()
+        : fd_(-1), data_(NULL), size_(0), begin_(NULL), pos_(NULL), end_(NULL), binary_(false), stats_(NULL),
+          stream_(false), buffer_pos_(0), buffer_end_(0), stream_offset_(0), idle_output_(NULL) {}
+
+LogReader::~LogReader() {
+    Close();
+}
+
+bool LogReader::Open(const std::string &file_name) {
+    Close();
+
+    fd_ = file_name == "-" ? dup(STDIN_FILENO) : open(file_name.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        Close();
+        return false;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        stream_ = true;
+        buffer_.resize(1 << 16);
+        return true;
+    }
+    size_ = (size_t) st.st_size;
+
+    if (size_ > 0) {
+        void *mapped = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (mapped == MAP_FAILED) {
+            Close();
+            return false;
+        }
+        madvise(mapped, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(mapped);
+    }
+    begin_ = data_;
+    pos_ = data_;
+    end_ = data_ + size_;
+
+    binary_ = binary_log::IsBinaryLog(data_, size_);
+    if (!binary_ && binary_log::HasMagic(data_, size_)) {
+        // another version or byte order, the records cannot be read
+        Close();
+        return false;
+    }
+    if (binary_) {
+        pos_ = data_ + sizeof(binary_log::Header);
+        end_ = pos_ + binary_log::RecordCount(data_, size_) * sizeof(binary_log::Record);
+    }
+    return true;
+}
+
+void LogReader::OpenRecords(const binary_log::Record *records, size_t count) {
+    Close();
+    binary_ = true;
+    begin_ = reinterpret_cast<const char *>(records);
+    pos_ = begin_;
+    end_ = pos_ + count * sizeof(binary_log::Record);
+}
+
+bool LogReader::IsOpen() const {
+    // records in memory have no file
+    return fd_ >= 0 || binary_;
+}
+
+bool LogReader::IsBinary() const {
+    return binary_;
+}
+
+bool LogReader::IsStream() const {
+    return stream_;
+}
+
+long LogReader::Offset() const {
+    return stream_ ? stream_offset_ : pos_ - begin_;
+}
+
+bool LogReader::Seek(long offset) {
+    if (stream_ || offset < 0 || offset > end_ - begin_) {
+        return false;
+    }
+    if (binary_) {
+        // mapped files start with the header, records in memory do not
+        long first = data_ != NULL ? sizeof(binary_log::Header) : 0;
+        if (offset < first || (offset - first) % sizeof(binary_log::Record) != 0) {
+            return false;
+        }
+    }
+    pos_ = begin_ + offset;
+    return true;
+}
+
+void LogReader::SetStats(timing::StageStats *stats) {
+    stats_ = stats;
+}
+
+void LogReader::SetIdleOutput(OutputWriter *output) {
+    idle_output_ = output;
+}
+
+void LogReader::Close() {
+    if (data_ != NULL) {
+        munmap(const_cast<char *>(data_), size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    fd_ = -1;
+    data_ = NULL;
+    size_ = 0;
+    begin_ = NULL;
+    pos_ = NULL;
+    end_ = NULL;
+    binary_ = false;
+    stream_ = false;
+    buffer_.clear();
+    buffer_pos_ = 0;
+    buffer_end_ = 0;
+    stream_offset_ = 0;
+}
+
+bool LogReader::NextStreamLine(const char *&line, const char *&line_end) {
+    size_t searched = buffer_pos_;
+    while (true) {
+        const char *begin = &buffer_[0];
+        const char *found = static_cast<const char *>(
+                memchr(begin + searched, '\n', buffer_end_ - searched));
+        if (found != NULL) {
+            line = begin + buffer_pos_;
+            line_end = found;
+            stream_offset_ += found - line + 1;
+            buffer_pos_ = found - begin + 1;
+            return true;
+        }
+        searched = buffer_end_;
+
+        // move the partial line to the front, grow for very long lines
+        if (buffer_pos_ > 0) {
+            memmove(&buffer_[0], &buffer_[buffer_pos_], buffer_end_ - buffer_pos_);
+            searched -= buffer_pos_;
+            buffer_end_ -= buffer_pos_;
+            buffer_pos_ = 0;
+        }
+        if (buffer_end_ == buffer_.size()) {
+            buffer_.resize(2 * buffer_.size());
+        }
+
+        // nothing to read yet, the read below would block
+        if (idle_output_ != NULL) {
+            pollfd ready = {fd_, POLLIN, 0};
+            if (poll(&ready, 1, 0) == 0) {
+                idle_output_->Idle();
+            }
+        }
+
+        // returns whatever arrived, so lines are handled without waiting for more
+        ssize_t n = read(fd_, &buffer_[buffer_end_], buffer_.size() - buffer_end_);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // a last line without newline
+            if (buffer_pos_ < buffer_end_) {
+                line = &buffer_[buffer_pos_];
+                line_end = &buffer_[buffer_end_];
+                stream_offset_ += buffer_end_ - buffer_pos_;
+                buffer_pos_ = buffer_end_;
+                return true;
+            }
+            return false;
+        }
+        buffer_end_ += n;
+    }
+}
+
+bool LogReader::Next(MeasurementPackage &meas_package, GroundTruthPackage &gt_package) {
+    if (stream_) {
+        const char *line, *line_end;
+        while (NextStreamLine(line, line_end)) {
+            // waiting for input is not part of the stage
+            timing::ScopedTimer timer(stats_, timing::PARSE);
+            if (parseLine(line, line_end, meas_package, gt_package)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (binary_) {
+        while (pos_ < end_) {
+            timing::ScopedTimer timer(stats_, timing::PARSE);
+            binary_log::Record record;
+            memcpy(&record, pos_, sizeof(binary_log::Record));
+            pos_ += sizeof(binary_log::Record);
+            if (binary_log::ToPackages(record, meas_package, gt_package)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *end = end_;
+    while (pos_ < end) {
+        timing::ScopedTimer timer(stats_, timing::PARSE);
+        const char *line_end = static_cast<const char *>(memchr(pos_, '\n', end - pos_));
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        const char *line = pos_;
+        pos_ = line_end < end ? line_end + 1 : end;
+
+        if (parseLine(line, line_end, meas_package, gt_package)) {
+            return true;
+        }
+    }
+    return false;
+}
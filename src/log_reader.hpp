@@ -0,0 +1,126 @@
+#ifndef UNSCENTED_KALMAN_FILTER_LOG_READER_HPP
+#define UNSCENTED_KALMAN_FILTER_LOG_READER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "binary_log.hpp"
+#include "measurement_package.hpp"
+#include "ground_truth_package.hpp"
+#include "timing.hpp"
+
+class OutputWriter;
+
+/**
+ * Parses one line of the tab separated L/R log format into the given packages.
+ * @return false if the line is empty or malformed
+ */
+bool parseLine(const char *begin, const char *end,
+               MeasurementPackage &meas_package, GroundTruthPackage &gt_package);
+
+inline bool parseLine(const std::string &line,
+                      MeasurementPackage &meas_package, GroundTruthPackage &gt_package) {
+    return parseLine(line.data(), line.data() + line.size(), meas_package, gt_package);
+}
+
+/**
+ * Reads a measurement log by mapping it into memory and parsing the fields
+ * in place, without copying lines. Binary logs (see binary_log.hpp) are
+ * detected by their header and decoded record by record.
+ *
+ * Standard input ("-"), pipes and other files that cannot be mapped are read
+ * as text line by line: Next returns as soon as a complete line arrived.
+ */
+class LogReader {
+public:
+    LogReader();
+
+    virtual ~LogReader();
+
+    /**
+     * Maps the given file, "-" reads standard input
+     * @return false if the file cannot be opened or mapped, or is a binary
+     * log of another version or byte order
+     */
+    bool Open(const std::string &file_name);
+
+    /**
+     * Reads records of a binary log already in memory, which the caller keeps
+     * alive until Close. Lets several readers share one parsed log.
+     */
+    void OpenRecords(const binary_log::Record *records, size_t count);
+
+    bool IsOpen() const;
+
+    bool IsBinary() const;
+
+    /**
+     * @return true if the input is read line by line as it arrives
+     */
+    bool IsStream() const;
+
+    /**
+     * @return The byte offset in the log of the next measurement Next reads,
+     * for records in memory the offset from the first record
+     */
+    long Offset() const;
+
+    /**
+     * Continues reading at an offset Offset returned, not for stream inputs
+     * @return false if the offset is not in the log
+     */
+    bool Seek(long offset);
+
+    /**
+     * Times the parsing of every record into stats, NULL disables
+     */
+    void SetStats(timing::StageStats *stats);
+
+    /**
+     * Calls Idle of the output before a stream input blocks waiting for the
+     * next line, so its flush policy holds while no line arrives. NULL disables.
+     */
+    void SetIdleOutput(OutputWriter *output);
+
+    void Close();
+
+    /**
+     * Reads the next measurement, skipping empty and malformed lines and
+     * invalid binary records
+     * @return false at the end of the log
+     */
+    bool Next(MeasurementPackage &meas_package, GroundTruthPackage &gt_package);
+
+private:
+    int fd_;
+    const char *data_;
+    size_t size_;
+    ///* where offsets count from, the mapped file or the records in memory
+    const char *begin_;
+    const char *pos_;
+    ///* end of the readable records
+    const char *end_;
+    bool binary_;
+    timing::StageStats *stats_;
+
+    ///* read buffer of stream inputs, unconsumed data is [buffer_pos_, buffer_end_)
+    bool stream_;
+    std::vector<char> buffer_;
+    size_t buffer_pos_;
+    size_t buffer_end_;
+    ///* bytes of the stream input consumed by Next
+    long stream_offset_;
+    ///* told when a stream input waits, may be NULL
+    OutputWriter *idle_output_;
+
+    /**
+     * Reads from a stream input until a complete line is buffered
+     * @return false at the end of the input
+     */
+    bool NextStreamLine(const char *&line, const char *&line_end);
+
+    LogReader(const LogReader &);
+    LogReader &operator=(const LogReader &);
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_LOG_READER_HPP
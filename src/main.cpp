@@ -1,12 +1,21 @@
+#include <algorithm>
+#include <climits>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <vector>
 #include <iomanip>
 #include "lib/Eigen/Dense"
 #include "tools.hpp"
+#include "checkpoint.hpp"
 #include "ground_truth_package.hpp"
 #include "measurement_package.hpp"
+#include "log_reader.hpp"
+#include "output_writer.hpp"
+#include "parallel.hpp"
+#include "replay.hpp"
+#include "timing.hpp"
+#include "tuning.hpp"
 #include "lib/cxxopts.hpp"
 #include "ukf.hpp"
 
@@ -18,6 +27,27 @@ using std::vector;
 bool verbose = false;
 bool useOnlyRadar = false;
 bool useOnlyLidar = false;
+bool useSqrt = false;
+bool fastTrig = false;
+bool useFloat = false;
+bool useImm = false;
+bool jointUpdates = false;
+double maxLag = 0;
+int historySize = 64;
+bool reportLatency = false;
+bool timeStages = false;
+int flushRows = 0;
+double flushSeconds = 0;
+bool multiMode = false;
+int jobs = 0;
+string checkpointFile = "";
+int checkpointEvery = 100000;
+string resumeFile = "";
+long resumeAt = LONG_MAX;
+vector<string> tuneSpecs;
+bool smooth = false;
+int smoothLag = 0;
+double nisLimit = tuning::kNISLimit95;
 string in_file_name_ = "";
 string out_file_name_ = "";
 
@@ -25,7 +55,7 @@ void parseOptions(int argc, char *argv[]) {
     try {
         cxxopts::Options options(argv[0], " - Implementation of an Unscented Kalman Filter to"
                 " fuse lidar and radar sensor data.\n"
-                "Input and Output files are required");
+                "Input and Output files are required, - is standard input or output");
 
         options.add_options()
                 ("h,help", "Print help")
@@ -33,7 +63,41 @@ void parseOptions(int argc, char *argv[]) {
                 ("o,output", "Output file", cxxopts::value<std::string>())
                 ("v,verbose", "verbose flag", cxxopts::value<bool>(verbose))
                 ("r,radar", "use only radar data", cxxopts::value<bool>(useOnlyRadar))
-                ("l,lidar", "use only lidar data", cxxopts::value<bool>(useOnlyLidar));
+                ("l,lidar", "use only lidar data", cxxopts::value<bool>(useOnlyLidar))
+                ("s,sqrt", "propagate the Cholesky factor of P (square-root UKF)", cxxopts::value<bool>(useSqrt))
+                ("fast-trig", "polynomial sin, cos and atan2 in the process and radar models",
+                 cxxopts::value<bool>(fastTrig))
+                ("float", "run the filter in single precision", cxxopts::value<bool>(useFloat))
+                ("imm", "interacting multiple models: CV, CTRV and CTRA", cxxopts::value<bool>(useImm))
+                ("joint", "update same-time laser and radar measurements in one stacked update",
+                 cxxopts::value<bool>(jointUpdates))
+                ("flush-rows", "flush the output every N rows", cxxopts::value<int>(flushRows))
+                ("flush-seconds", "flush the output at least every S seconds", cxxopts::value<double>(flushSeconds))
+                ("max-lag", "process measurements up to this many ms late at their time",
+                 cxxopts::value<double>(maxLag))
+                ("history", "measurements kept for --max-lag (default 64)", cxxopts::value<int>(historySize))
+                ("latency", "append the processing latency in us to every row", cxxopts::value<bool>(reportLatency))
+                ("timing", "report latency percentiles of the parse, predict, update and write stages",
+                 cxxopts::value<bool>(timeStages))
+                ("checkpoint", "append a snapshot of the filter and the statistics to this file periodically",
+                 cxxopts::value<std::string>(checkpointFile))
+                ("checkpoint-every", "measurements between snapshots (default 100000)",
+                 cxxopts::value<int>(checkpointEvery))
+                ("resume", "continue the replay from a snapshot of this file", cxxopts::value<std::string>(resumeFile))
+                ("resume-at", "resume from the last snapshot at or before this timestamp in us (default the last)",
+                 cxxopts::value<long>(resumeAt))
+                ("smooth", "write the estimates of an unscented RTS smoother over the whole log",
+                 cxxopts::value<bool>(smooth))
+                ("smooth-lag", "smooth with at least N later measurements in bounded memory, implies --smooth",
+                 cxxopts::value<int>(smoothLag))
+                ("m,multi", "input is a directory or a file listing logs, output a directory",
+                 cxxopts::value<bool>(multiMode))
+                ("tune", "sweep a noise parameter, name=v1,v2,... or name=from:to:step, repeatable; "
+                         "ranks every combination into the output file",
+                 cxxopts::value<vector<string>>(tuneSpecs))
+                ("nis-limit", "chi-square limit of the test of the NIS shares against 5% for --tune "
+                              "(default 3.841, the 95% level)", cxxopts::value<double>(nisLimit))
+                ("j,jobs", "threads for --multi, --tune and --smooth, defaults to all cores", cxxopts::value<int>(jobs));
 
         vector<string> optionals = {"input", "output"};
         options.parse_positional(optionals);
@@ -64,209 +128,392 @@ void parseOptions(int argc, char *argv[]) {
     }
 }
 
-void check_files(ifstream &in_file, string &in_name,
-                 ofstream &out_file, string &out_name) {
-    if (!in_file.is_open()) {
+void check_files(LogReader &in_file, string &in_name,
+                 OutputWriter &out_file, string &out_name) {
+    if (!in_file.IsOpen()) {
         cerr << "Cannot open input file: " << in_name << endl;
         exit(EXIT_FAILURE);
     }
 
-    if (!out_file.is_open()) {
+    if (!out_file.IsOpen()) {
         cerr << "Cannot open output file: " << out_name << endl;
         exit(EXIT_FAILURE);
     }
 }
 
 
-tuple<MeasurementPackage, GroundTruthPackage> parseLine(string line) {
-    istringstream iss(line);
-    string sensor_type;
-    MeasurementPackage meas_package;
-    GroundTruthPackage gt_package;
-    long timestamp;
-
-    // reads first element from the current line
-    iss >> sensor_type;
-    if (sensor_type.compare("L") == 0) {
-        // LASER MEASUREMENT
-        // read measurements at this timestamp
-        meas_package.sensor_type_ = MeasurementPackage::LASER;
-        gt_package.sensor_type_ = GroundTruthPackage::LASER;
-        meas_package.raw_measurements_ = VectorXd(2);
-        float x;
-        float y;
-        iss >> x;
-        iss >> y;
-        meas_package.raw_measurements_ << x, y;
-        iss >> timestamp;
-        meas_package.timestamp_ = timestamp;
-    } else if (sensor_type.compare("R") == 0) {
-        // RADAR MEASUREMENT
-        // read measurements at this timestamp
-        meas_package.sensor_type_ = MeasurementPackage::RADAR;
-        gt_package.sensor_type_ = GroundTruthPackage::RADAR;
-        meas_package.raw_measurements_ = VectorXd(3);
-        float ro;
-        float theta;
-        float ro_dot;
-        iss >> ro;
-        iss >> theta;
-        iss >> ro_dot;
-        meas_package.raw_measurements_ << ro, theta, ro_dot;
-        iss >> timestamp;
-        meas_package.timestamp_ = timestamp;
-    }
-
-    // read ground truth data to compare later
-    float x_gt;
-    float y_gt;
-    float vx_gt;
-    float vy_gt;
-    iss >> x_gt;
-    iss >> y_gt;
-    iss >> vx_gt;
-    iss >> vy_gt;
-    gt_package.timestamp_ = timestamp;
-    gt_package.gt_values_ = VectorXd(4);
-    gt_package.gt_values_ << x_gt, y_gt, vx_gt, vy_gt;
-
-    return make_tuple(meas_package, gt_package);
+/**
+ * Prints p50/p99/p99.9/max per stage and the throughput
+ */
+void printTiming(const timing::StageStats &stats, long count) {
+    cout << endl << left << setw(14) << "Stage" << right << setw(10) << "count"
+         << setw(10) << "mean us" << setw(10) << "p50 us" << setw(10) << "p99 us"
+         << setw(10) << "p99.9 us" << setw(10) << "max us" << endl;
+    cout << fixed << setprecision(2);
+    for (int i = 0; i < timing::STAGE_COUNT; i++) {
+        const timing::Histogram &h = stats.stages[i];
+        if (h.Count() == 0) {
+            continue;
+        }
+        cout << left << setw(14) << timing::StageName((timing::Stage) i) << right
+             << setw(10) << h.Count() << setw(10) << h.Mean() / 1000
+             << setw(10) << h.Percentile(0.5) / 1000.0 << setw(10) << h.Percentile(0.99) / 1000.0
+             << setw(10) << h.Percentile(0.999) / 1000.0 << setw(10) << h.Max() / 1000.0 << endl;
+    }
+    cout << defaultfloat << setprecision(6);
+    cout << "Throughput: " << count << " measurements in " << stats.elapsed << " s, "
+         << count / stats.elapsed << " meas/s" << endl;
 }
 
-
-void writeLine(ofstream &out_file_, UKF &ukf,
-               MeasurementPackage meas_package, GroundTruthPackage gt_package) {
-    // output the estimation
-    out_file_ << ukf.x_(0) << "\t"; // pos1 - est
-    out_file_ << ukf.x_(1) << "\t"; // pos2 - est
-    out_file_ << ukf.x_(2) << "\t"; // vel_abs - est
-    out_file_ << ukf.x_(3) << "\t"; // yaw_angle - est
-    out_file_ << ukf.x_(4) << "\t"; // yaw_rate - est
-
-    // output the measurements
-    if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
-        // output the measurements
-        out_file_ << meas_package.raw_measurements_(0) << "\t";
-        out_file_ << meas_package.raw_measurements_(1) << "\t";
-    } else if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
-        // output the measurements in the cartesian coordinates
-        double rho = meas_package.raw_measurements_(0);
-        double phi = meas_package.raw_measurements_(1);
-        out_file_ << rho * cos(phi) << "\t";
-        out_file_ << rho * sin(phi) << "\t";
-    }
-
-    // output the ground truth packages
-    double x_gt;
-    double y_gt;
-    double vx_gt;
-    double vy_gt;
-    double v_gt;
-    double yaw_gt;
-    double yaw_rate_gt;
-
-    x_gt = gt_package.gt_values_(0);
-    y_gt = gt_package.gt_values_(1);
-    vx_gt = gt_package.gt_values_(2);
-    vy_gt = gt_package.gt_values_(3);
-    v_gt = sqrt(vx_gt * vx_gt + vy_gt * vy_gt);
-    yaw_gt = fabs(vx_gt) > 0.0001 ? atan(vy_gt / vx_gt) : 0;
-    yaw_rate_gt = 0;
-
-    out_file_ << x_gt << "\t";
-    out_file_ << y_gt << "\t";
-    out_file_ << v_gt << "\t";
-    out_file_ << yaw_gt << "\t";
-    out_file_ << yaw_rate_gt << "\t";
-    out_file_ << vx_gt << "\t";
-    out_file_ << vy_gt << "\t";
-
-    // output nis
-    out_file_ << ukf.NIS_laser_ << "\t";
-    out_file_ << ukf.NIS_radar_ << endl;
+void printReport(const ReplayResult &result) {
+    // compute the accuracy (RMSE)
+    cout << "Accuracy - RMSE:" << endl << result.rmse.RMSE() << endl << endl;
+    cout << "NIS Radar: " << setprecision(4) << setw(4) << result.radar_nis.Share() * 100 << '%' << endl;
+    cout << "NIS Lidar: " << setprecision(4) << setw(4) << result.lidar_nis.Share() * 100 << '%' << endl;
+    cout << "NEES position: mean " << result.nees.Mean() << ", "
+         << result.nees.Share() * 100 << "% above the 95% limit" << endl;
+    if (result.late_count > 0 || result.dropped_count > 0) {
+        cout << endl << "Late measurements: " << result.late_count
+             << ", dropped: " << result.dropped_count << endl;
+    }
+    if (result.latency_max > 0 && result.rmse.count > 0) {
+        cout << endl << "Latency: mean " << result.latency_sum / result.rmse.count
+             << " us, max " << result.latency_max << " us" << endl;
+    }
+    if (result.stage_stats.elapsed > 0) {
+        printTiming(result.stage_stats, result.rmse.count);
+    }
 }
 
 
-void processStream(ifstream &in_file_, ofstream &out_file_) {
-    UKF ukf;
-    vector<VectorXd> estimations;
-    vector<VectorXd> ground_truth;
-    vector<float> radar_nis_values;
-    vector<float> lidar_nis_values;
-    string line;
-    int cnt = 0;
+ReplayOptions replayOptions() {
+    ReplayOptions options;
+    options.use_only_radar = useOnlyRadar;
+    options.use_only_lidar = useOnlyLidar;
+    options.use_sqrt = useSqrt;
+    options.fast_trig = fastTrig;
+    options.use_float = useFloat;
+    options.use_imm = useImm;
+    options.joint_updates = jointUpdates;
+    options.verbose = verbose;
+    options.max_lag = (long) (maxLag * 1000);
+    options.history_size = historySize;
+    options.report_latency = reportLatency;
+    options.time_stages = timeStages;
+    options.checkpoint_every = checkpointEvery;
+    options.smooth = smooth || smoothLag > 0;
+    options.smooth_lag = smoothLag;
+    options.smooth_threads = jobs > 0 ? jobs : parallel::DefaultThreads();
+    return options;
+}
 
+OutputWriter::FlushPolicy flushPolicy() {
+    OutputWriter::FlushPolicy policy = {flushRows, flushSeconds};
+    return policy;
+}
 
-    while (getline(in_file_, line)) {
-        if (line.empty()) {
-            continue;
+/**
+ * @return The files of a directory in name order, or the paths listed line by line in a file
+ */
+vector<string> listLogs(const string &input) {
+    namespace fs = std::filesystem;
+    vector<string> logs;
+    error_code ec;
+    if (fs::is_directory(input, ec)) {
+        for (const fs::directory_entry &entry : fs::directory_iterator(input, ec)) {
+            if (entry.is_regular_file(ec)) {
+                logs.push_back(entry.path().string());
+            }
+        }
+        sort(logs.begin(), logs.end());
+    } else {
+        ifstream list(input.c_str());
+        string line;
+        while (getline(list, line)) {
+            if (!line.empty()) {
+                logs.push_back(line);
+            }
         }
+    }
+    return logs;
+}
+
+/**
+ * Replays every log on a thread pool, writing each output to the output
+ * directory under the name of its log, and reports the merged results.
+ */
+int processMulti() {
+    namespace fs = std::filesystem;
+    vector<string> logs = listLogs(in_file_name_);
+    if (logs.empty()) {
+        cerr << "No logs found in: " << in_file_name_ << endl;
+        return EXIT_FAILURE;
+    }
 
-        auto lineParsed = parseLine(line);
-        auto meas_package = get<0>(lineParsed);
-        auto gt_package = get<1>(lineParsed);
-        auto sensorType = meas_package.sensor_type_;
+    error_code ec;
+    fs::create_directories(out_file_name_, ec);
+    if (!fs::is_directory(out_file_name_, ec)) {
+        cerr << "Cannot create output directory: " << out_file_name_ << endl;
+        return EXIT_FAILURE;
+    }
 
-        if (useOnlyRadar & sensorType == MeasurementPackage::LASER) {
-            continue;
-        } else if (useOnlyLidar & sensorType == MeasurementPackage::RADAR) {
+    ReplayOptions options = replayOptions();
+    // per measurement output of concurrent logs would interleave
+    options.verbose = false;
+    // the logs already keep the threads busy
+    options.smooth_threads = 1;
+    OutputWriter::FlushPolicy flush_policy = flushPolicy();
+
+    vector<ReplayResult> results(logs.size());
+    vector<char> failed(logs.size(), 0);
+    uint64_t start = timing::Now();
+    parallel::For((int) logs.size(), jobs > 0 ? jobs : parallel::DefaultThreads(), [&](int i) {
+        string out_name = (fs::path(out_file_name_) / fs::path(logs[i]).filename()).string();
+        LogReader in_file;
+        OutputWriter out_file;
+        if (!in_file.Open(logs[i]) || !out_file.Open(out_name)) {
+            failed[i] = 1;
+            return;
+        }
+        out_file.SetFlushPolicy(flush_policy);
+        in_file.SetIdleOutput(&out_file);
+        results[i] = processStream(in_file, out_file, options);
+        failed[i] = !out_file.Close();
+    });
+
+    ReplayResult total;
+    int n_failed = 0;
+    for (size_t i = 0; i < logs.size(); i++) {
+        if (failed[i]) {
+            cerr << "Cannot process log: " << logs[i] << endl;
+            n_failed++;
             continue;
         }
+        VectorXd rmse = results[i].rmse.RMSE();
+        cout << logs[i] << ": " << results[i].rmse.count << " measurements, RMSE "
+             << rmse(0) << " " << rmse(1) << endl;
+        total.Merge(results[i]);
+    }
 
-        ukf.ProcessMeasurement(meas_package);
+    if (options.time_stages) {
+        // the logs ran concurrently, throughput is over the wall time of all
+        total.stage_stats.elapsed = (timing::Now() - start) * 1e-9;
+    }
 
-        writeLine(out_file_, ukf, meas_package, gt_package);
+    cout << endl << "Logs: " << logs.size() - n_failed << endl << endl;
+    printReport(total);
+    return n_failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
 
-        estimations.push_back(ukf.x_.head(2));
-        ground_truth.push_back(gt_package.gt_values_.head(2));
-        if (sensorType == MeasurementPackage::LASER) {
-            lidar_nis_values.push_back(ukf.NIS_laser_);
-        } else if (sensorType == MeasurementPackage::RADAR) {
-            radar_nis_values.push_back(ukf.NIS_radar_);
+/**
+ * Replays every combination of the --tune values over the input logs, which
+ * are parsed once and shared by all threads. Prints the best configurations
+ * and writes all of them ranked to the output file.
+ */
+int processTune() {
+    tuning::Grid grid;
+    for (size_t i = 0; i < tuneSpecs.size(); i++) {
+        string error;
+        if (!tuning::ParseSpec(tuneSpecs[i], grid, error)) {
+            cerr << "Invalid --tune: " << error << endl;
+            return EXIT_FAILURE;
         }
+    }
+    vector<NoiseParameters> configurations = tuning::Configurations(grid, UKF().Noise());
 
-        if (verbose) {
-            cout << "***** Entry: " << cnt++ << " *****" << endl << endl;
-            cout << "SensorType = " << (sensorType == MeasurementPackage::LASER ? "Laser" : "Radar") << endl << endl;
-            cout << "x_ = " << ukf.x_ << endl << endl;
-            cout << "P_ = " << ukf.P_ << endl << endl;
+    vector<string> logs = multiMode ? listLogs(in_file_name_) : vector<string>(1, in_file_name_);
+    if (logs.empty()) {
+        cerr << "No logs found in: " << in_file_name_ << endl;
+        return EXIT_FAILURE;
+    }
+    int threads = jobs > 0 ? jobs : parallel::DefaultThreads();
+    vector<vector<binary_log::Record> > records(logs.size());
+    vector<char> failed(logs.size(), 0);
+    parallel::For((int) logs.size(), threads, [&](int i) {
+        failed[i] = !tuning::LoadLog(logs[i], records[i]);
+    });
+    for (size_t i = 0; i < logs.size(); i++) {
+        if (failed[i]) {
+            cerr << "Cannot open input file: " << logs[i] << endl;
+            return EXIT_FAILURE;
+        }
+    }
 
-            if (sensorType == MeasurementPackage::LASER) {
-                cout << "NIS Laser = " << ukf.NIS_laser_ << endl << endl;
-            } else if (sensorType == MeasurementPackage::RADAR) {
-                cout << "NIS Radar = " << ukf.NIS_radar_ << endl << endl;
-            }
+    OutputWriter out_file;
+    if (!out_file.Open(out_file_name_)) {
+        cerr << "Cannot open output file: " << out_file_name_ << endl;
+        return EXIT_FAILURE;
+    }
+
+    uint64_t start = timing::Now();
+    vector<tuning::Result> results = tuning::Evaluate(records, configurations, replayOptions(), threads);
+    double elapsed = (timing::Now() - start) * 1e-9;
+    if (out_file_name_ == "-") {
+        cout.rdbuf(cerr.rdbuf());
+    }
+
+    tuning::Rank(results, nisLimit);
+
+    for (int i = 0; i < tuning::kParameterCount; i++) {
+        out_file.WriteText(tuning::ParameterName(i));
+    }
+    const char *columns[] = {"rmse_px", "rmse_py", "nis_lidar", "nis_radar", "nees_mean", "consistent"};
+    for (const char *column : columns) {
+        out_file.WriteText(column);
+    }
+    out_file.EndRow();
+    for (size_t r = 0; r < results.size(); r++) {
+        tuning::Result &result = results[r];
+        for (int i = 0; i < tuning::kParameterCount; i++) {
+            out_file.Write(tuning::Parameter(result.noise, i));
         }
+        VectorXd rmse = result.rmse.RMSE();
+        out_file.Write(rmse(0));
+        out_file.Write(rmse(1));
+        out_file.Write(result.lidar_nis.Share());
+        out_file.Write(result.radar_nis.Share());
+        out_file.Write(result.nees.Mean());
+        out_file.WriteInteger(result.consistent);
+        out_file.EndRow();
     }
 
-    // compute the accuracy (RMSE)
-    cout << "Accuracy - RMSE:" << endl << tools::CalculateRMSE(estimations, ground_truth) << endl << endl;
-    cout << "NIS Radar: " << setprecision(4) << setw(4)
-         << tools::CalculateNISPerformance(radar_nis_values, MeasurementPackage::RADAR)*100 << '%' << endl;
-    cout << "NIS Lidar: " << setprecision(4) << setw(4)
-         << tools::CalculateNISPerformance(lidar_nis_values, MeasurementPackage::LASER)*100 << '%' << endl;
+    cout << configurations.size() << " configurations over " << logs.size() << " logs in "
+         << elapsed << " s" << endl << endl;
+    for (int i = 0; i < tuning::kParameterCount; i++) {
+        cout << setw(11) << tuning::ParameterName(i);
+    }
+    cout << setw(11) << "RMSE px" << setw(11) << "RMSE py" << setw(11) << "NIS lidar" << setw(11) << "NIS radar"
+         << endl;
+    for (size_t r = 0; r < results.size() && r < 10; r++) {
+        tuning::Result &result = results[r];
+        for (int i = 0; i < tuning::kParameterCount; i++) {
+            cout << setw(11) << tuning::Parameter(result.noise, i);
+        }
+        VectorXd rmse = result.rmse.RMSE();
+        cout << setw(11) << rmse(0) << setw(11) << rmse(1)
+             << setw(10) << result.lidar_nis.Share() * 100 << '%' << setw(10) << result.radar_nis.Share() * 100 << '%'
+             << (result.consistent ? "" : "  inconsistent") << endl;
+    }
 
+    if (!out_file.Close()) {
+        cerr << "Cannot write output file: " << out_file_name_ << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
 }
 
 
 int main(int argc, char *argv[]) {
     parseOptions(argc, argv);
 
-    ifstream in_file_(in_file_name_.c_str(), ifstream::in);
-    ofstream out_file_(out_file_name_.c_str(), ofstream::out);
+#ifndef UKF_TIMING
+    if (timeStages) {
+        cerr << "--timing has no effect, the instrumentation is compiled out (UKF_TIMING=OFF)" << endl;
+    }
+#endif
+    if (useImm && (useSqrt || useFloat)) {
+        cerr << "--sqrt and --float have no effect with --imm" << endl;
+    }
+    if (useFloat && !useImm && fastTrig) {
+        cerr << "--fast-trig only applies to the radar model with --float" << endl;
+    }
+
+    if ((!checkpointFile.empty() || !resumeFile.empty()) && (multiMode || !tuneSpecs.empty() || maxLag > 0)) {
+        cerr << "--checkpoint and --resume need a single replay without --max-lag" << endl;
+        return EXIT_FAILURE;
+    }
+    if ((smooth || smoothLag > 0)
+        && (useImm || useFloat || maxLag > 0 || verbose || reportLatency
+            || !checkpointFile.empty() || !resumeFile.empty())) {
+        cerr << "--smooth works with the double precision UKF only, without --max-lag, --verbose, --latency "
+                "and checkpoints" << endl;
+        return EXIT_FAILURE;
+    }
+    if (smoothLag < 0) {
+        cerr << "--smooth-lag has to be positive" << endl;
+        return EXIT_FAILURE;
+    }
+    if (!tuneSpecs.empty()) {
+        return processTune();
+    }
+    if (multiMode) {
+        return processMulti();
+    }
+
+    LogReader in_file_;
+    in_file_.Open(in_file_name_);
+    OutputWriter out_file_;
+    out_file_.Open(out_file_name_);
+    out_file_.SetFlushPolicy(flushPolicy());
+    in_file_.SetIdleOutput(&out_file_);
 
     check_files(in_file_, in_file_name_, out_file_, out_file_name_);
 
-    processStream(in_file_, out_file_);
+    ReplayOptions options = replayOptions();
+    if (in_file_.IsStream() && jointUpdates) {
+        // pairing same-time measurements would wait for the next line
+        cerr << "--joint has no effect on standard input" << endl;
+        options.joint_updates = false;
+    }
+    if (out_file_name_ == "-") {
+        // the rows own standard output, messages and the report go to stderr,
+        // and every row is written as soon as it is complete
+        cout.rdbuf(cerr.rdbuf());
+        if (flushRows == 0 && flushSeconds == 0) {
+            OutputWriter::FlushPolicy policy = {1, 0};
+            out_file_.SetFlushPolicy(policy);
+        }
+    }
 
-    // close files
-    if (out_file_.is_open()) {
-        out_file_.close();
+    checkpoint::Snapshot snapshot;
+    if (!resumeFile.empty()) {
+        checkpoint::FilterKind kind = useImm ? checkpoint::IMM_FILTER
+                                             : useFloat ? checkpoint::UKF_FLOAT : checkpoint::UKF_DOUBLE;
+        if (!checkpoint::ReadSnapshot(resumeFile, resumeAt, snapshot)) {
+            cerr << "No snapshot to resume from in: " << resumeFile << endl;
+            return EXIT_FAILURE;
+        }
+        if (!checkpoint::Fits(snapshot, kind)) {
+            cerr << "The snapshot is of another filter, --imm and --float have to match" << endl;
+            return EXIT_FAILURE;
+        }
+        if (!in_file_.Seek(snapshot.header.log_offset)) {
+            cerr << "Cannot resume in the input, it has to be the file the snapshot was taken of" << endl;
+            return EXIT_FAILURE;
+        }
+        options.resume = &snapshot;
     }
 
-    if (in_file_.is_open()) {
-        in_file_.close();
+    // opened after reading the snapshot, the files may be the same
+    checkpoint::Writer checkpoints;
+    if (!checkpointFile.empty()) {
+        if (!checkpoints.Open(checkpointFile)) {
+            cerr << "Cannot open checkpoint file: " << checkpointFile << endl;
+            return EXIT_FAILURE;
+        }
+        options.checkpoints = &checkpoints;
     }
 
+    cout << (useImm ? "IMM: " : "UKF: ") << endl;
+    ReplayResult result = processStream(in_file_, out_file_, options);
+    if (result.resume_failed) {
+        cerr << "Cannot load the filter state of the snapshot in: " << resumeFile << endl;
+        return EXIT_FAILURE;
+    }
+    printReport(result);
+
+    if (!checkpoints.Close()) {
+        cerr << "Cannot write checkpoint file: " << checkpointFile << endl;
+        return EXIT_FAILURE;
+    }
+
+    // close files
+    if (!out_file_.Close()) {
+        cerr << "Cannot write output file: " << out_file_name_ << endl;
+        return EXIT_FAILURE;
+    }
+
+    in_file_.Close();
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,252 @@
+#ifndef UNSCENTED_KALMAN_FILTER_MEASUREMENT_MODELS_HPP
+#define UNSCENTED_KALMAN_FILTER_MEASUREMENT_MODELS_HPP
+
+#include <cmath>
+#include "lib/Eigen/Dense"
+#include "fast_trig.hpp"
+#include "tools.hpp"
+
+/**
+ * Measurement models for UKF::Update and UKF::ProcessMeasurement.
+ *
+ * A model describes a sensor at compile time:
+ *   n_z              measurement dimension
+ *   is_linear        true if the measurement is H * x, the update is then a
+ *                    plain Kalman update with the member H
+ *   Vector, Matrix   fixed-size measurement vector and covariance types
+ *   R, sqrt_R        measurement noise covariance and its lower factor
+ *   Measure<Trig>(x) maps a state into measurement space (nonlinear models),
+ *                    Trig is trig::Exact or trig::Fast
+ *   Normalize(z)     wraps the angular components of a residual
+ *   Initialize(z, x, P)  first state estimate from a measurement
+ *
+ * All models are templated on the scalar type of the filter, the plain names
+ * (LidarModel, RadarModel) are the double versions. New sensors derive from
+ * MeasurementModel and provide the rest.
+ */
+namespace models {
+
+    ///* dimension of the CTRV state [pos1 pos2 vel_abs yaw_angle yaw_rate]
+    const int n_x = 5;
+
+    typedef Eigen::Matrix<double, n_x, 1> StateVector;
+    typedef Eigen::Matrix<double, n_x, n_x> StateMatrix;
+
+    template<int n_z_, typename Scalar_ = double>
+    struct MeasurementModel {
+        typedef Scalar_ Scalar;
+
+        static const int n_z = n_z_;
+
+        typedef Eigen::Matrix<Scalar, n_z, 1> Vector;
+        typedef Eigen::Matrix<Scalar, n_z, n_z> Matrix;
+        typedef Eigen::Matrix<Scalar, n_x, 1> StateVector;
+        typedef Eigen::Matrix<Scalar, n_x, n_x> StateMatrix;
+
+        ///* measurement noise covariance
+        Matrix R;
+
+        ///* lower Cholesky factor of R, used in square-root mode
+        Matrix sqrt_R;
+
+        MeasurementModel() {
+            SetNoise(Matrix::Identity());
+        }
+
+        explicit MeasurementModel(const Matrix &noise) {
+            SetNoise(noise);
+        }
+
+        void SetNoise(const Matrix &noise) {
+            R = noise;
+            sqrt_R = R.llt().matrixL();
+        }
+
+        /**
+         * No angular components by default
+         */
+        static void Normalize(Vector &) {}
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    /**
+     * Lidar: position px, py
+     */
+    template<typename Scalar_ = double>
+    struct LidarModelT : public MeasurementModel<2, Scalar_> {
+        typedef MeasurementModel<2, Scalar_> Base;
+        using typename Base::Scalar;
+        using typename Base::Vector;
+        using typename Base::Matrix;
+        using typename Base::StateVector;
+        using typename Base::StateMatrix;
+
+        static const bool is_linear = true;
+
+        Eigen::Matrix<Scalar, Base::n_z, n_x> H;
+
+        LidarModelT() {
+            H << 1, 0, 0, 0, 0,
+                    0, 1, 0, 0, 0;
+        }
+
+        explicit LidarModelT(const Matrix &noise) : LidarModelT() {
+            this->SetNoise(noise);
+        }
+
+        void Initialize(const Vector &z, StateVector &x, StateMatrix &) const {
+            x << z(0), z(1), 0, 0, 0;
+        }
+    };
+
+    typedef LidarModelT<double> LidarModel;
+
+    /**
+     * Radar: range rho, bearing phi and range rate rho_dot
+     */
+    template<typename Scalar_ = double>
+    struct RadarModelT : public MeasurementModel<3, Scalar_> {
+        typedef MeasurementModel<3, Scalar_> Base;
+        using typename Base::Scalar;
+        using typename Base::Vector;
+        using typename Base::Matrix;
+        using typename Base::StateVector;
+        using typename Base::StateMatrix;
+
+        static const bool is_linear = false;
+
+        RadarModelT() {}
+
+        explicit RadarModelT(const Matrix &noise) : Base(noise) {}
+
+        template<class Trig = trig::Exact>
+        Vector Measure(const StateVector &x) const {
+            // extract values for better readibility
+            Scalar p_x = x(0);
+            Scalar p_y = x(1);
+            Scalar v = x(2);
+            Scalar yaw = x(3);
+
+            Scalar sin_yaw, cos_yaw;
+            Trig::SinCos(yaw, sin_yaw, cos_yaw);
+            Scalar v_y = cos_yaw * v;
+            Scalar v_x = sin_yaw * v;
+
+            // measurement model
+            Scalar rho = std::sqrt(p_x * p_x + p_y * p_y);
+            Scalar phi = Trig::Atan2(p_y, p_x);
+            Scalar rho_dot = (p_x * v_y + p_y * v_x) / rho;
+
+            if (rho != rho) {
+                rho = 0;
+            }
+            if (phi != phi) {
+                phi = 0;
+            }
+            if (rho_dot != rho_dot) {
+                rho_dot = 0;
+            }
+
+            Vector z;
+            z << rho, phi, rho_dot;
+            return z;
+        }
+
+        static void Normalize(Vector &z_diff) {
+            z_diff(1) = tools::NormalizeAngle(z_diff(1));
+        }
+
+        void Initialize(const Vector &z, StateVector &x, StateMatrix &P) const {
+            Scalar rho = z(0);
+            Scalar phi = z(1);
+
+            Scalar px = rho * std::cos(phi);
+            Scalar py = rho * std::sin(phi);
+
+            // If initial values are zero they will set to an initial guess
+            // and the uncertainty will be increased.
+            // Initial zeros would cause the algorithm to fail when using only Radar data.
+            if (std::fabs(px) < 0.0001) {
+                px = 1;
+                P(0, 0) = 1000;
+            }
+            if (std::fabs(py) < 0.0001) {
+                py = 1;
+                P(1, 1) = 1000;
+            }
+
+            x << px, py, 0, 0, 0;
+        }
+    };
+
+    typedef RadarModelT<double> RadarModel;
+
+    /**
+     * Maps a state into the measurement space of a linear or nonlinear model
+     */
+    template<class Trig = trig::Exact, class Model>
+    typename Model::Vector Measure(const Model &model, const typename Model::StateVector &x) {
+        if constexpr (Model::is_linear) {
+            return model.H * x;
+        } else {
+            return model.template Measure<Trig>(x);
+        }
+    }
+
+    /**
+     * Two measurements taken at the same time, updated together. The noise of
+     * the sensors is independent, so R is block diagonal. Linear parts go
+     * through the sigma points as well, which is exact for them.
+     */
+    template<class A, class B>
+    struct StackedModel {
+        typedef typename A::Scalar Scalar;
+
+        static const int n_z = A::n_z + B::n_z;
+        static const bool is_linear = false;
+
+        typedef Eigen::Matrix<Scalar, n_z, 1> Vector;
+        typedef Eigen::Matrix<Scalar, n_z, n_z> Matrix;
+        typedef typename A::StateVector StateVector;
+        typedef typename A::StateMatrix StateMatrix;
+
+        const A &a;
+        const B &b;
+
+        Matrix R;
+        Matrix sqrt_R;
+
+        StackedModel(const A &a_, const B &b_) : a(a_), b(b_) {
+            R.setZero();
+            R.template topLeftCorner<A::n_z, A::n_z>() = a.R;
+            R.template bottomRightCorner<B::n_z, B::n_z>() = b.R;
+            sqrt_R.setZero();
+            sqrt_R.template topLeftCorner<A::n_z, A::n_z>() = a.sqrt_R;
+            sqrt_R.template bottomRightCorner<B::n_z, B::n_z>() = b.sqrt_R;
+        }
+
+        template<class Trig = trig::Exact>
+        Vector Measure(const StateVector &x) const {
+            Vector z;
+            z << models::Measure<Trig>(a, x), models::Measure<Trig>(b, x);
+            return z;
+        }
+
+        static void Normalize(Vector &z_diff) {
+            typename A::Vector z_a = z_diff.template head<A::n_z>();
+            typename B::Vector z_b = z_diff.template tail<B::n_z>();
+            A::Normalize(z_a);
+            B::Normalize(z_b);
+            z_diff << z_a, z_b;
+        }
+
+        void Initialize(const Vector &z, StateVector &x, StateMatrix &P) const {
+            a.Initialize(z.template head<A::n_z>(), x, P);
+        }
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_MEASUREMENT_MODELS_HPP
@@ -5,6 +5,9 @@
 
 class MeasurementPackage {
 public:
+    ///* measurement storage with a fixed capacity of 3 values, never allocates
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 3, 1> MeasurementVector;
+
     long timestamp_;
 
     enum SensorType {
@@ -12,7 +15,7 @@ public:
         RADAR
     } sensor_type_;
 
-    Eigen::VectorXd raw_measurements_;
+    MeasurementVector raw_measurements_;
 };
 
 #endif /* MEASUREMENT_PACKAGE_HPP */
@@ -0,0 +1,115 @@
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "output_writer.hpp"
+
+OutputWriter::OutputWriter(size_t buffer_size)
+        : fd_(-1), buffer_(buffer_size < 2 * kMaxField ? 2 * kMaxField : buffer_size),
+          used_(0), row_fields_(0), pending_rows_(0), failed_(false) {
+    policy_.rows = 0;
+    policy_.seconds = 0;
+}
+
+OutputWriter::~OutputWriter() {
+    Close();
+}
+
+bool OutputWriter::Open(const std::string &file_name) {
+    Close();
+    if (file_name == "-") {
+        fd_ = dup(STDOUT_FILENO);
+    } else {
+        fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    failed_ = fd_ < 0;
+    return fd_ >= 0;
+}
+
+bool OutputWriter::IsOpen() const {
+    return fd_ >= 0;
+}
+
+void OutputWriter::SetFlushPolicy(const FlushPolicy &policy) {
+    policy_ = policy;
+}
+
+void OutputWriter::FormatDouble(double value) {
+    std::to_chars_result result = std::to_chars(&buffer_[used_], &buffer_[0] + buffer_.size(), value);
+    used_ = result.ptr - &buffer_[0];
+}
+
+void OutputWriter::FormatInteger(long value) {
+    std::to_chars_result result = std::to_chars(&buffer_[used_], &buffer_[0] + buffer_.size(), value);
+    used_ = result.ptr - &buffer_[0];
+}
+
+void OutputWriter::WriteText(const char *text) {
+    size_t length = strnlen(text, kMaxField - 1);
+    if (buffer_.size() - used_ < kMaxField) {
+        Flush();
+    }
+    if (row_fields_++ > 0) {
+        buffer_[used_++] = '\t';
+    }
+    memcpy(&buffer_[used_], text, length);
+    used_ += length;
+}
+
+void OutputWriter::EndRow() {
+    if (buffer_.size() == used_) {
+        Flush();
+    }
+    buffer_[used_++] = '\n';
+    row_fields_ = 0;
+
+    if (pending_rows_++ == 0 && policy_.seconds > 0) {
+        first_pending_ = std::chrono::steady_clock::now();
+    }
+
+    if (policy_.rows > 0 && pending_rows_ >= policy_.rows) {
+        Flush();
+    } else if (policy_.seconds > 0) {
+        std::chrono::duration<double> age = std::chrono::steady_clock::now() - first_pending_;
+        if (age.count() >= policy_.seconds) {
+            Flush();
+        }
+    }
+}
+
+void OutputWriter::Idle() {
+    if (policy_.seconds > 0 && pending_rows_ > 0) {
+        Flush();
+    }
+}
+
+bool OutputWriter::Flush() {
+    const char *p = &buffer_[0];
+    size_t remaining = used_;
+    while (remaining > 0 && fd_ >= 0) {
+        ssize_t written = write(fd_, p, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed_ = true;
+            break;
+        }
+        p += written;
+        remaining -= written;
+    }
+    used_ = 0;
+    pending_rows_ = 0;
+    return !failed_;
+}
+
+bool OutputWriter::Close() {
+    if (fd_ < 0) {
+        return !failed_;
+    }
+    bool ok = Flush();
+    ok = close(fd_) == 0 && ok;
+    fd_ = -1;
+    return ok;
+}
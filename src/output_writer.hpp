@@ -0,0 +1,120 @@
+#ifndef UNSCENTED_KALMAN_FILTER_OUTPUT_WRITER_HPP
+#define UNSCENTED_KALMAN_FILTER_OUTPUT_WRITER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Writes tab separated rows of numbers. Rows are formatted into a reusable
+ * buffer with the shortest representation that reads back to the same
+ * double and written to the file in large blocks.
+ */
+class OutputWriter {
+public:
+    /**
+     * When the buffer is written out in addition to when it is full and on Close.
+     */
+    struct FlushPolicy {
+        ///* flush after this many rows, 0 disables
+        int rows;
+        ///* flush once the oldest buffered row is older than this, 0 disables.
+        ///* The age is checked by EndRow and Idle.
+        double seconds;
+    };
+
+    explicit OutputWriter(size_t buffer_size = 1 << 20);
+
+    /**
+     * Flushes the remaining rows
+     */
+    virtual ~OutputWriter();
+
+    /**
+     * Creates or truncates the file, "-" writes to standard output
+     */
+    bool Open(const std::string &file_name);
+
+    bool IsOpen() const;
+
+    void SetFlushPolicy(const FlushPolicy &policy);
+
+    /**
+     * Appends a field, separated from the previous field of the row by a tab
+     */
+    inline void Write(double value) {
+        if (buffer_.size() - used_ < kMaxField) {
+            Flush();
+        }
+        if (row_fields_++ > 0) {
+            buffer_[used_++] = '\t';
+        }
+        FormatDouble(value);
+    }
+
+    /**
+     * Appends an integer field, like a timestamp
+     */
+    inline void WriteInteger(long value) {
+        if (buffer_.size() - used_ < kMaxField) {
+            Flush();
+        }
+        if (row_fields_++ > 0) {
+            buffer_[used_++] = '\t';
+        }
+        FormatInteger(value);
+    }
+
+    /**
+     * Appends a text field of less than kMaxField characters, like the sensor
+     * type of a log line
+     */
+    void WriteText(const char *text);
+
+    /**
+     * Terminates the row and applies the flush policy
+     */
+    void EndRow();
+
+    /**
+     * Tells the writer that no row will come for a while, like before a
+     * blocking read of the input. Flushes the buffered rows if the flush
+     * policy has seconds, their age would not be checked until the next row.
+     */
+    void Idle();
+
+    /**
+     * Writes all buffered rows to the file
+     * @return false if the write failed
+     */
+    bool Flush();
+
+    /**
+     * Flushes and closes the file
+     * @return false if any write failed
+     */
+    bool Close();
+
+private:
+    ///* upper bound for a formatted double plus separator
+    static const size_t kMaxField = 32;
+
+    int fd_;
+    std::vector<char> buffer_;
+    size_t used_;
+    int row_fields_;
+    int pending_rows_;
+    bool failed_;
+    FlushPolicy policy_;
+    std::chrono::steady_clock::time_point first_pending_;
+
+    void FormatDouble(double value);
+
+    void FormatInteger(long value);
+
+    OutputWriter(const OutputWriter &);
+    OutputWriter &operator=(const OutputWriter &);
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_OUTPUT_WRITER_HPP
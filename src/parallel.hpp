@@ -0,0 +1,46 @@
+#ifndef UNSCENTED_KALMAN_FILTER_PARALLEL_HPP
+#define UNSCENTED_KALMAN_FILTER_PARALLEL_HPP
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    /**
+     * @return The number of hardware threads, at least 1
+     */
+    inline int DefaultThreads() {
+        unsigned int n = std::thread::hardware_concurrency();
+        return n > 0 ? (int) n : 1;
+    }
+
+    /**
+     * Calls fn(i) for every i in [0, n) on up to n_threads threads. Indices
+     * are handed out one at a time, so uneven work items balance themselves.
+     * The calling thread takes part and the call returns when all are done.
+     */
+    template<typename F>
+    void For(int n, int n_threads, F fn) {
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            for (int i = next++; i < n; i = next++) {
+                fn(i);
+            }
+        };
+
+        if (n_threads > n) {
+            n_threads = n;
+        }
+        std::vector<std::thread> threads;
+        for (int t = 1; t < n_threads; t++) {
+            threads.push_back(std::thread(worker));
+        }
+        worker();
+        for (size_t t = 0; t < threads.size(); t++) {
+            threads[t].join();
+        }
+    }
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_PARALLEL_HPP
@@ -0,0 +1,444 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <vector>
+#include "binary_log.hpp"
+#include "filter_history.hpp"
+#include "replay.hpp"
+#include "smoother.hpp"
+#include "tools.hpp"
+
+using namespace std;
+
+ReplayResult::ReplayResult()
+        : rmse(2), lidar_nis(MeasurementPackage::LASER), radar_nis(MeasurementPackage::RADAR),
+          late_count(0), dropped_count(0), latency_sum(0), latency_max(0), resume_failed(false) {}
+
+namespace {
+    ///* reads the next measurement of a sensor that is not filtered out
+    bool nextMeasurement(LogReader &in_file_, const ReplayOptions &options,
+                         MeasurementPackage &meas_package, GroundTruthPackage &gt_package) {
+        while (in_file_.Next(meas_package, gt_package)) {
+            auto sensorType = meas_package.sensor_type_;
+            if (options.use_only_radar && sensorType == MeasurementPackage::LASER) {
+                continue;
+            } else if (options.use_only_lidar && sensorType == MeasurementPackage::RADAR) {
+                continue;
+            }
+            return true;
+        }
+        return false;
+    }
+}
+
+void ReplayResult::Merge(const ReplayResult &other) {
+    rmse.Merge(other.rmse);
+    lidar_nis.Merge(other.lidar_nis);
+    radar_nis.Merge(other.radar_nis);
+    nees.Merge(other.nees);
+    late_count += other.late_count;
+    dropped_count += other.dropped_count;
+    latency_sum += other.latency_sum;
+    latency_max = max(latency_max, other.latency_max);
+    stage_stats.Merge(other.stage_stats);
+    resume_failed = resume_failed || other.resume_failed;
+}
+
+template<class Filter>
+void writeLine(OutputWriter &out_file_, const Filter &ukf,
+               const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package,
+               const double *latency) {
+    // output the estimation
+    out_file_.Write(ukf.x_(0)); // pos1 - est
+    out_file_.Write(ukf.x_(1)); // pos2 - est
+    out_file_.Write(ukf.x_(2)); // vel_abs - est
+    out_file_.Write(ukf.x_(3)); // yaw_angle - est
+    out_file_.Write(ukf.x_(4)); // yaw_rate - est
+
+    // output the measurements
+    if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
+        // output the measurements
+        out_file_.Write(meas_package.raw_measurements_(0));
+        out_file_.Write(meas_package.raw_measurements_(1));
+    } else if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
+        // output the measurements in the cartesian coordinates
+        double rho = meas_package.raw_measurements_(0);
+        double phi = meas_package.raw_measurements_(1);
+        out_file_.Write(rho * cos(phi));
+        out_file_.Write(rho * sin(phi));
+    }
+
+    // output the ground truth packages
+    double x_gt;
+    double y_gt;
+    double vx_gt;
+    double vy_gt;
+    double v_gt;
+    double yaw_gt;
+    double yaw_rate_gt;
+
+    x_gt = gt_package.gt_values_(0);
+    y_gt = gt_package.gt_values_(1);
+    vx_gt = gt_package.gt_values_(2);
+    vy_gt = gt_package.gt_values_(3);
+    v_gt = sqrt(vx_gt * vx_gt + vy_gt * vy_gt);
+    yaw_gt = fabs(vx_gt) > 0.0001 ? atan(vy_gt / vx_gt) : 0;
+    yaw_rate_gt = 0;
+
+    out_file_.Write(x_gt);
+    out_file_.Write(y_gt);
+    out_file_.Write(v_gt);
+    out_file_.Write(yaw_gt);
+    out_file_.Write(yaw_rate_gt);
+    out_file_.Write(vx_gt);
+    out_file_.Write(vy_gt);
+
+    // output nis
+    out_file_.Write(ukf.NIS_laser_);
+    out_file_.Write(ukf.NIS_radar_);
+
+    if (latency != NULL) {
+        out_file_.Write(*latency);
+    }
+    out_file_.EndRow();
+}
+
+template void writeLine(OutputWriter &out_file_, const UKF &ukf,
+                        const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package,
+                        const double *latency);
+
+template void writeLine(OutputWriter &out_file_, const UKFT<float> &ukf,
+                        const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package,
+                        const double *latency);
+
+template void writeLine(OutputWriter &out_file_, const IMM &ukf,
+                        const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package,
+                        const double *latency);
+
+namespace {
+    template<class Filter>
+    void configure(Filter &ukf, const ReplayOptions &options) {
+        ukf.use_sqrt_ = options.use_sqrt;
+        ukf.use_fast_trig_ = options.fast_trig;
+        if (options.noise != NULL) {
+            ukf.SetNoise(*options.noise);
+        }
+    }
+
+    void configure(IMM &imm, const ReplayOptions &options) {
+        if (options.noise != NULL) {
+            UKF prototype;
+            prototype.SetNoise(*options.noise);
+            imm = IMM(prototype);
+        }
+        imm.use_fast_trig_ = options.fast_trig;
+    }
+
+    ///* processStream with the filter of the chosen precision
+    template<class Filter>
+    ReplayResult processWith(LogReader &in_file_, OutputWriter &out_file_, const ReplayOptions &options) {
+        typedef chrono::steady_clock Clock;
+
+        Filter ukf;
+        configure(ukf, options);
+        ReplayResult result;
+        MeasurementPackage meas_package, next_package;
+        GroundTruthPackage gt_package, next_gt_package;
+        Clock::time_point received, next_received;
+        int cnt = 0;
+        long late_base = 0;
+        long dropped_base = 0;
+
+        if (options.resume != NULL) {
+            // the filter and the statistics of all measurements before the snapshot
+            const checkpoint::Header &header = options.resume->header;
+            if (!checkpoint::LoadFilter(options.resume->filter, ukf)) {
+                result.resume_failed = true;
+                return result;
+            }
+            checkpoint::RestoreStatistics(header, result);
+            late_base = result.late_count;
+            dropped_base = result.dropped_count;
+            cnt = result.rmse.count;
+        }
+        long next_checkpoint = result.rmse.count + options.checkpoint_every;
+        long next_offset = 0;
+        checkpoint::Snapshot snapshot;
+
+        timing::StageStats *stats = options.time_stages ? &result.stage_stats : NULL;
+        ukf.stats_ = stats;
+        in_file_.SetStats(stats);
+        uint64_t start = timing::Now();
+
+        // late measurements need the history, otherwise it stays a single entry
+        bool use_history = options.max_lag > 0;
+        FilterHistoryT<Filter> history(ukf, options.max_lag, use_history ? options.history_size : 1);
+
+        auto next = [&]() {
+            next_offset = in_file_.Offset();
+            bool has_next = nextMeasurement(in_file_, options, next_package, next_gt_package);
+            if (options.report_latency) {
+                next_received = Clock::now();
+            }
+            return has_next;
+        };
+
+        // writes the row of a processed measurement and collects its statistics
+        auto record = [&](const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package) {
+            auto sensorType = meas_package.sensor_type_;
+            // a late measurement shows the state right after it, not the
+            // newest state after the measurements processed again
+            const Filter &estimate = history.Applied();
+
+            if (out_file_.IsOpen()) {
+                timing::ScopedTimer timer(stats, timing::WRITE);
+                if (options.report_latency) {
+                    double latency = chrono::duration<double, micro>(Clock::now() - received).count();
+                    result.latency_sum += latency;
+                    result.latency_max = max(result.latency_max, latency);
+                    writeLine(out_file_, estimate, meas_package, gt_package, &latency);
+                } else {
+                    writeLine(out_file_, estimate, meas_package, gt_package);
+                }
+            }
+
+            Eigen::Vector2d position = estimate.x_.template head<2>().template cast<double>();
+            result.rmse.Add(position, gt_package.gt_values_.head<2>());
+            result.nees.Add(position - gt_package.gt_values_.head<2>(),
+                            estimate.P_.template topLeftCorner<2, 2>().template cast<double>());
+            if (sensorType == MeasurementPackage::LASER) {
+                result.lidar_nis.Add(estimate.NIS_laser_);
+            } else if (sensorType == MeasurementPackage::RADAR) {
+                result.radar_nis.Add(estimate.NIS_radar_);
+            }
+
+            if (options.verbose) {
+                cout << "***** Entry: " << cnt++ << " *****" << endl << endl;
+                cout << "SensorType = " << (sensorType == MeasurementPackage::LASER ? "Laser" : "Radar") << endl << endl;
+                cout << "x_ = " << estimate.x_ << endl << endl;
+                cout << "P_ = " << estimate.P_ << endl << endl;
+
+                if (sensorType == MeasurementPackage::LASER) {
+                    cout << "NIS Laser = " << estimate.NIS_laser_ << endl << endl;
+                } else if (sensorType == MeasurementPackage::RADAR) {
+                    cout << "NIS Radar = " << estimate.NIS_radar_ << endl << endl;
+                }
+            }
+        };
+
+        // with joint updates one measurement of look-ahead finds laser and radar
+        // pairs of the same time, otherwise a measurement is read after the last
+        // one was written
+        bool has_next = next();
+        while (has_next) {
+            // all measurements before next_package are processed
+            if (options.checkpoints != NULL && result.rmse.count >= next_checkpoint) {
+                checkpoint::Header &header = snapshot.header;
+                memset(&header, 0, sizeof(checkpoint::Header));
+                result.late_count = late_base + history.late_count_;
+                result.dropped_count = dropped_base + history.dropped_count_;
+                checkpoint::SaveStatistics(result, header);
+                header.filter_kind = checkpoint::KindOf(ukf);
+                header.log_offset = next_offset;
+                header.timestamp = ukf.previous_timestamp_;
+                checkpoint::SaveFilter(ukf, snapshot.filter);
+                options.checkpoints->Write(snapshot);
+                next_checkpoint = result.rmse.count + options.checkpoint_every;
+            }
+
+            swap(meas_package, next_package);
+            swap(gt_package, next_gt_package);
+            received = next_received;
+            bool joint = false;
+            if (options.joint_updates) {
+                has_next = next();
+                joint = has_next
+                        && next_package.timestamp_ == meas_package.timestamp_
+                        && next_package.sensor_type_ != meas_package.sensor_type_;
+            }
+
+            if (joint) {
+                // the pair is complete with the second measurement
+                received = next_received;
+                const MeasurementPackage &laser_pack =
+                        meas_package.sensor_type_ == MeasurementPackage::LASER ? meas_package : next_package;
+                const MeasurementPackage &radar_pack =
+                        meas_package.sensor_type_ == MeasurementPackage::LASER ? next_package : meas_package;
+                bool accepted = true;
+                if (use_history) {
+                    accepted = history.ProcessJoint(laser_pack, radar_pack);
+                } else {
+                    ukf.ProcessJointMeasurement(laser_pack, radar_pack);
+                }
+                if (accepted) {
+                    record(meas_package, gt_package);
+                    record(next_package, next_gt_package);
+                }
+                has_next = next();
+            } else {
+                bool accepted = true;
+                if (use_history) {
+                    accepted = history.Process(meas_package);
+                } else {
+                    ukf.ProcessMeasurement(meas_package);
+                }
+                if (accepted) {
+                    record(meas_package, gt_package);
+                }
+                if (!options.joint_updates) {
+                    has_next = next();
+                }
+            }
+        }
+
+        result.late_count = late_base + history.late_count_;
+        result.dropped_count = dropped_base + history.dropped_count_;
+        if (stats != NULL) {
+            result.stage_stats.elapsed = (timing::Now() - start) * 1e-9;
+        }
+        in_file_.SetStats(NULL);
+        return result;
+    }
+
+    ///* the estimate writeLine writes for a smoothed row
+    struct SmoothedEstimate {
+        UKF::StateVector x_;
+        double NIS_laser_;
+        double NIS_radar_;
+    };
+
+    ///* a processed measurement waiting for its node to be smoothed
+    struct HeldRow {
+        binary_log::Record record;
+        long node;
+        ///* NIS values of the filter after the measurement
+        double nis_laser;
+        double nis_radar;
+    };
+
+    /**
+     * processStream with the RTS smoother: the rows are held back as binary
+     * records until the node of their measurement is smoothed
+     */
+    ReplayResult processSmoothed(LogReader &in_file_, OutputWriter &out_file_, const ReplayOptions &options) {
+        UKF ukf;
+        configure(ukf, options);
+        Smoother smoother(ukf);
+        ReplayResult result;
+        MeasurementPackage meas_package, next_package;
+        GroundTruthPackage gt_package, next_gt_package;
+        deque<HeldRow> rows;
+
+        timing::StageStats *stats = options.time_stages ? &result.stage_stats : NULL;
+        ukf.stats_ = stats;
+        in_file_.SetStats(stats);
+        uint64_t start = timing::Now();
+
+        auto hold = [&](const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package, long node) {
+            HeldRow row;
+            binary_log::FromPackages(meas_package, gt_package, row.record);
+            row.node = node;
+            row.nis_laser = ukf.NIS_laser_;
+            row.nis_radar = ukf.NIS_radar_;
+            rows.push_back(row);
+        };
+
+        // writes the rows of the smoothed nodes before end and collects their statistics
+        auto release = [&](long end) {
+            MeasurementPackage meas_package;
+            GroundTruthPackage gt_package;
+            SmoothedEstimate estimate;
+            while (!rows.empty() && rows.front().node < end) {
+                const HeldRow &row = rows.front();
+                binary_log::ToPackages(row.record, meas_package, gt_package);
+                estimate.x_ = smoother.State(row.node);
+                estimate.NIS_laser_ = row.nis_laser;
+                estimate.NIS_radar_ = row.nis_radar;
+                if (out_file_.IsOpen()) {
+                    timing::ScopedTimer timer(stats, timing::WRITE);
+                    writeLine(out_file_, estimate, meas_package, gt_package);
+                }
+
+                Eigen::Vector2d position = estimate.x_.head<2>();
+                result.rmse.Add(position, gt_package.gt_values_.head<2>());
+                result.nees.Add(position - gt_package.gt_values_.head<2>(),
+                                smoother.Covariance(row.node).topLeftCorner<2, 2>());
+                if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
+                    result.lidar_nis.Add(row.nis_laser);
+                } else if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
+                    result.radar_nis.Add(row.nis_radar);
+                }
+                rows.pop_front();
+            }
+            smoother.Drop(end);
+        };
+
+        bool has_next = nextMeasurement(in_file_, options, next_package, next_gt_package);
+        while (has_next) {
+            swap(meas_package, next_package);
+            swap(gt_package, next_gt_package);
+            bool joint = false;
+            if (options.joint_updates) {
+                has_next = nextMeasurement(in_file_, options, next_package, next_gt_package);
+                joint = has_next
+                        && next_package.timestamp_ == meas_package.timestamp_
+                        && next_package.sensor_type_ != meas_package.sensor_type_;
+            }
+
+            if (joint) {
+                const MeasurementPackage &laser_pack =
+                        meas_package.sensor_type_ == MeasurementPackage::LASER ? meas_package : next_package;
+                const MeasurementPackage &radar_pack =
+                        meas_package.sensor_type_ == MeasurementPackage::LASER ? next_package : meas_package;
+                ukf.ProcessJointMeasurement(laser_pack, radar_pack);
+                long node = smoother.Commit();
+                hold(meas_package, gt_package, node);
+                hold(next_package, next_gt_package, node);
+                has_next = nextMeasurement(in_file_, options, next_package, next_gt_package);
+            } else {
+                ukf.ProcessMeasurement(meas_package);
+                hold(meas_package, gt_package, smoother.Commit());
+                if (!options.joint_updates) {
+                    has_next = nextMeasurement(in_file_, options, next_package, next_gt_package);
+                }
+            }
+
+            // smoothing twice the lag at once releases every row with at
+            // least smooth_lag later measurements, for about two backward
+            // steps per node
+            if (options.smooth_lag > 0 && rows.size() >= 2 * (size_t) options.smooth_lag) {
+                long end = rows[rows.size() - options.smooth_lag].node;
+                smoother.Smooth(end);
+                release(end);
+            }
+        }
+
+        if (options.smooth_lag > 0) {
+            smoother.Smooth(smoother.End());
+        } else {
+            smoother.SmoothAll(options.smooth_threads);
+        }
+        release(smoother.End());
+
+        if (stats != NULL) {
+            result.stage_stats.elapsed = (timing::Now() - start) * 1e-9;
+        }
+        in_file_.SetStats(NULL);
+        return result;
+    }
+}
+
+ReplayResult processStream(LogReader &in_file_, OutputWriter &out_file_, const ReplayOptions &options) {
+    if (options.smooth) {
+        return processSmoothed(in_file_, out_file_, options);
+    }
+    if (options.use_imm) {
+        return processWith<IMM>(in_file_, out_file_, options);
+    }
+    if (options.use_float) {
+        return processWith<UKFT<float> >(in_file_, out_file_, options);
+    }
+    return processWith<UKF>(in_file_, out_file_, options);
+}
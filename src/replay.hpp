@@ -0,0 +1,101 @@
+#ifndef UNSCENTED_KALMAN_FILTER_REPLAY_HPP
+#define UNSCENTED_KALMAN_FILTER_REPLAY_HPP
+
+#include "lib/Eigen/Dense"
+#include "checkpoint.hpp"
+#include "ground_truth_package.hpp"
+#include "log_reader.hpp"
+#include "measurement_package.hpp"
+#include "output_writer.hpp"
+#include "imm.hpp"
+#include "timing.hpp"
+#include "tools.hpp"
+#include "ukf.hpp"
+
+struct ReplayOptions {
+    bool use_only_radar = false;
+    bool use_only_lidar = false;
+    bool use_sqrt = false;
+    ///* polynomial sin, cos and atan2 in the process and radar models
+    bool fast_trig = false;
+    ///* run the single precision filter UKFT<float>
+    bool use_float = false;
+    ///* run the CV/CTRV/CTRA multiple model estimator IMM, use_sqrt and use_float do not apply
+    bool use_imm = false;
+    ///* laser and radar measurements of the same time share one stacked update
+    bool joint_updates = false;
+    ///* print state and covariance after every measurement
+    bool verbose = false;
+    ///* measurements up to this many us late are processed at their time, 0 disables
+    long max_lag = 0;
+    ///* number of measurements kept for late arrivals
+    int history_size = 64;
+    ///* append the processing latency in us to every row
+    bool report_latency = false;
+    ///* collect per-stage latency histograms
+    bool time_stages = false;
+    ///* process and measurement noise, NULL keeps the defaults of the filter
+    const NoiseParameters *noise = NULL;
+    ///* receives a snapshot every checkpoint_every measurements, NULL disables.
+    ///* The history of max_lag is not part of the snapshots.
+    checkpoint::Writer *checkpoints = NULL;
+    long checkpoint_every = 0;
+    ///* continues the replay of a snapshot of the same filter, the reader has
+    ///* to be at its log offset. NULL starts from the beginning.
+    const checkpoint::Snapshot *resume = NULL;
+    ///* write the estimates of an unscented RTS smoother instead of the filtered ones,
+    ///* for UKF only. max_lag, verbose, report_latency and checkpoints do not apply.
+    bool smooth = false;
+    ///* rows are smoothed with at least this many later measurements and held back
+    ///* at most twice as long, 0 smooths the whole log at its end
+    int smooth_lag = 0;
+    ///* threads of the backward pass over the whole log
+    int smooth_threads = 1;
+};
+
+/**
+ * Accuracy and consistency of one or more replayed logs
+ */
+struct ReplayResult {
+    ///* position RMSE, its count is the number of estimations
+    tools::RMSEAccumulator rmse;
+    ///* share of NIS values above the 95% limit
+    tools::NISAccumulator lidar_nis;
+    tools::NISAccumulator radar_nis;
+    ///* position NEES against the ground truth
+    tools::NEESAccumulator nees;
+    ///* measurements processed out of sequence and dropped as too late
+    long late_count;
+    long dropped_count;
+    ///* processing latency per measurement in us, with report_latency
+    double latency_sum;
+    double latency_max;
+    ///* per-stage latency histograms, with time_stages
+    timing::StageStats stage_stats;
+    ///* the filter state of options.resume did not load, nothing was replayed
+    bool resume_failed;
+
+    ReplayResult();
+
+    void Merge(const ReplayResult &other);
+};
+
+/**
+ * Writes one output row: estimated state, measurement in cartesian
+ * coordinates, ground truth and the NIS values, and the latency if given.
+ * Instantiated for UKF, UKFT<float> and IMM.
+ */
+template<class Filter>
+void writeLine(OutputWriter &out_file_, const Filter &ukf,
+               const MeasurementPackage &meas_package, const GroundTruthPackage &gt_package,
+               const double *latency = NULL);
+
+/**
+ * Runs a new UKF over all measurements of in_file_ and writes a row per
+ * measurement, none if out_file_ is not open. Without joint updates every
+ * row is written before the next measurement is read. With smoothing the
+ * rows follow smooth_lag measurements late, or all at the end of the log.
+ */
+ReplayResult processStream(LogReader &in_file_, OutputWriter &out_file_, const ReplayOptions &options);
+
+#endif //UNSCENTED_KALMAN_FILTER_REPLAY_HPP
@@ -0,0 +1,201 @@
+#include <climits>
+#include <cmath>
+#include "scenario.hpp"
+#include "tools.hpp"
+#include "ukf.hpp"
+
+namespace {
+    /**
+     * Output function of splitmix64, a bijective mix of all bits
+     */
+    uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * splitmix64, one word of state
+     */
+    uint64_t nextRandom(uint64_t &state) {
+        state += 0x9E3779B97F4A7C15ULL;
+        return mix(state);
+    }
+
+    /**
+     * @return Uniform in [0, 1)
+     */
+    double uniform(uint64_t &state) {
+        return (nextRandom(state) >> 11) * 0x1.0p-53;
+    }
+
+    /**
+     * @return Standard normal, by Box-Muller
+     */
+    double normal(uint64_t &state) {
+        double u1 = 1 - uniform(state);
+        double u2 = uniform(state);
+        return std::sqrt(-2 * std::log(u1)) * std::cos(2 * M_PI * u2);
+    }
+}
+
+ScenarioOptions::ScenarioOptions() {
+    UKF ukf;
+    targets = 1;
+    first_target = 0;
+    duration = 25;
+    lidar_rate = 10;
+    radar_rate = 10;
+    start_timestamp = 1477010443000000;
+    seed = 1;
+    area = 100;
+    std_a = ukf.std_a_;
+    std_yawdd = ukf.std_yawdd_;
+    std_laspx = ukf.std_laspx_;
+    std_laspy = ukf.std_laspy_;
+    std_radr = ukf.std_radr_;
+    std_radphi = ukf.std_radphi_;
+    std_radrd = ukf.std_radrd_;
+}
+
+/**
+ * Draws the initial state of every target: a position in the area at least
+ * 1 m from the radar, a speed of 2 to 10 m/s, any heading and a small yaw rate.
+ */
+ScenarioGenerator::ScenarioGenerator(const ScenarioOptions &options)
+        : options_(options), targets_(options.targets > 0 ? options.targets : 0) {
+    for (size_t i = 0; i < targets_.size(); i++) {
+        Target &target = targets_[i];
+        target.random = mix(mix(options.seed) + options.first_target + i);
+        do {
+            target.p_x = options.area * (uniform(target.random) - 0.5);
+            target.p_y = options.area * (uniform(target.random) - 0.5);
+        } while (target.p_x * target.p_x + target.p_y * target.p_y < 1);
+        target.v = 2 + 8 * uniform(target.random);
+        target.yaw = 2 * M_PI * uniform(target.random) - M_PI;
+        target.yawd = 0.1 * normal(target.random);
+    }
+
+    time_ = options.start_timestamp;
+    lidar_ = false;
+    radar_ = false;
+    lidar_count_ = 0;
+    radar_count_ = 0;
+    next_target_ = targets_.size();
+    radar_pending_ = false;
+}
+
+ScenarioGenerator::~ScenarioGenerator() {}
+
+long ScenarioGenerator::SensorTime(double rate, double phase, long count) const {
+    if (!(rate > 0)) {
+        return LONG_MAX;
+    }
+    return options_.start_timestamp + std::llround((count + phase) * 1e6 / rate);
+}
+
+/**
+ * The radar measures first, the lidar half a period later like in the
+ * sample logs
+ */
+bool ScenarioGenerator::NextTime() {
+    double lidar_phase = options_.radar_rate > 0 ? 0.5 : 0;
+    long lidar_time = SensorTime(options_.lidar_rate, lidar_phase, lidar_count_);
+    long radar_time = SensorTime(options_.radar_rate, 0, radar_count_);
+    long time = lidar_time < radar_time ? lidar_time : radar_time;
+    long end = options_.start_timestamp + std::llround(options_.duration * 1e6);
+    if (time >= end) {
+        return false;
+    }
+
+    if (lidar_count_ + radar_count_ > 0) {
+        double delta_t = (time - time_) / 1000000.0;
+        for (size_t i = 0; i < targets_.size(); i++) {
+            Move(targets_[i], delta_t);
+        }
+    }
+
+    time_ = time;
+    lidar_ = lidar_time == time;
+    radar_ = radar_time == time;
+    lidar_count_ += lidar_;
+    radar_count_ += radar_;
+    return true;
+}
+
+/**
+ * The process model of UKF::Prediction with the noise drawn instead of
+ * sampled by sigma points
+ */
+void ScenarioGenerator::Move(Target &target, double delta_t) {
+    double nu_a = options_.std_a * normal(target.random);
+    double nu_yawdd = options_.std_yawdd * normal(target.random);
+
+    if (std::fabs(target.yawd) > 0.001) {
+        target.p_x += target.v / target.yawd * (std::sin(target.yaw + target.yawd * delta_t) - std::sin(target.yaw));
+        target.p_y += target.v / target.yawd * (std::cos(target.yaw) - std::cos(target.yaw + target.yawd * delta_t));
+    } else {
+        target.p_x += target.v * delta_t * std::cos(target.yaw);
+        target.p_y += target.v * delta_t * std::sin(target.yaw);
+    }
+
+    double dt2 = 0.5 * delta_t * delta_t;
+    target.p_x += nu_a * dt2 * std::cos(target.yaw);
+    target.p_y += nu_a * dt2 * std::sin(target.yaw);
+    target.v += nu_a * delta_t;
+    target.yaw = tools::NormalizeAngle(target.yaw + target.yawd * delta_t + nu_yawdd * dt2);
+    target.yawd += nu_yawdd * delta_t;
+}
+
+void ScenarioGenerator::MeasureLidar(Target &target, MeasurementPackage &meas_package) {
+    meas_package.sensor_type_ = MeasurementPackage::LASER;
+    meas_package.raw_measurements_.resize(2);
+    meas_package.raw_measurements_ << target.p_x + std::sqrt(options_.std_laspx) * normal(target.random),
+            target.p_y + std::sqrt(options_.std_laspy) * normal(target.random);
+}
+
+void ScenarioGenerator::MeasureRadar(Target &target, MeasurementPackage &meas_package) {
+    double rho = std::sqrt(target.p_x * target.p_x + target.p_y * target.p_y);
+    double phi = std::atan2(target.p_y, target.p_x);
+    double rho_dot = rho > 0.0001
+                     ? (target.p_x * std::cos(target.yaw) + target.p_y * std::sin(target.yaw)) * target.v / rho : 0;
+
+    meas_package.sensor_type_ = MeasurementPackage::RADAR;
+    meas_package.raw_measurements_.resize(3);
+    meas_package.raw_measurements_ << rho + options_.std_radr * normal(target.random),
+            phi + options_.std_radphi * normal(target.random),
+            rho_dot + options_.std_radrd * normal(target.random);
+}
+
+bool ScenarioGenerator::Next(MeasurementPackage &meas_package, GroundTruthPackage &gt_package, int *target) {
+    while (next_target_ >= (int) targets_.size()) {
+        if (targets_.empty() || !NextTime()) {
+            return false;
+        }
+        next_target_ = 0;
+        radar_pending_ = false;
+    }
+
+    int i = next_target_;
+    Target &t = targets_[i];
+    if (lidar_ && !radar_pending_) {
+        MeasureLidar(t, meas_package);
+        gt_package.sensor_type_ = GroundTruthPackage::LASER;
+        radar_pending_ = radar_;
+    } else {
+        MeasureRadar(t, meas_package);
+        gt_package.sensor_type_ = GroundTruthPackage::RADAR;
+        radar_pending_ = false;
+    }
+    if (!radar_pending_) {
+        next_target_++;
+    }
+
+    meas_package.timestamp_ = time_;
+    gt_package.timestamp_ = time_;
+    gt_package.gt_values_ << t.p_x, t.p_y, t.v * std::cos(t.yaw), t.v * std::sin(t.yaw);
+    if (target != NULL) {
+        *target = options_.first_target + i;
+    }
+    return true;
+}
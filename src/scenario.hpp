@@ -0,0 +1,115 @@
+#ifndef UNSCENTED_KALMAN_FILTER_SCENARIO_HPP
+#define UNSCENTED_KALMAN_FILTER_SCENARIO_HPP
+
+#include <cstdint>
+#include <vector>
+#include "ground_truth_package.hpp"
+#include "measurement_package.hpp"
+
+struct ScenarioOptions {
+    ///* number of targets, measured at the same times
+    int targets;
+    ///* index of the first target, the targets of a scenario are the same
+    ///* whichever range of them is generated
+    int first_target;
+    ///* length of the scenario in s
+    double duration;
+    ///* measurements per second and target, 0 disables the sensor
+    double lidar_rate;
+    double radar_rate;
+    ///* time of the first measurement in us
+    long start_timestamp;
+    ///* the same seed gives the same scenario
+    uint64_t seed;
+    ///* the targets start in a square of this edge length in m around the radar
+    double area;
+    ///* process noise, as in UKF
+    double std_a;
+    double std_yawdd;
+    ///* measurement noise, as in UKF. std_laspx and std_laspy are variances
+    ///* like UKF::std_laspx_ and UKF::std_laspy_, which enter R directly
+    double std_laspx;
+    double std_laspy;
+    double std_radr;
+    double std_radphi;
+    double std_radrd;
+
+    /**
+     * One target for 25 s at 10 Hz per sensor with the noise of a default UKF
+     */
+    ScenarioOptions();
+};
+
+/**
+ * Generates a measurement log of targets moving with constant turn rate and
+ * velocity (CTRV). Between two measurement times each target gets a random
+ * longitudinal and yaw acceleration with the process noise of the UKF, so the
+ * ground truth follows the process model of the filter exactly. The lidar and
+ * the radar measure with the noise the filter assumes, the radar sits at the
+ * origin.
+ *
+ * Every target draws from its own small random generator seeded from the seed
+ * and its index, so the memory is a few words per target and the output does
+ * not depend on how many targets are generated together. Measurements come
+ * out in time order, at each time all targets in order, lidar before radar.
+ */
+class ScenarioGenerator {
+public:
+    explicit ScenarioGenerator(const ScenarioOptions &options);
+
+    virtual ~ScenarioGenerator();
+
+    /**
+     * Generates the next measurement and the ground truth at its time
+     * @param target If given, receives the index of the target
+     * @return false at the end of the scenario
+     */
+    bool Next(MeasurementPackage &meas_package, GroundTruthPackage &gt_package, int *target = NULL);
+
+private:
+    ///* CTRV state and random generator of a target
+    struct Target {
+        double p_x, p_y, v, yaw, yawd;
+        uint64_t random;
+    };
+
+    ScenarioOptions options_;
+    std::vector<Target> targets_;
+
+    ///* the current measurement time and the sensors measuring at it
+    long time_;
+    bool lidar_;
+    bool radar_;
+
+    ///* the number of measurement times of each sensor so far
+    long lidar_count_;
+    long radar_count_;
+
+    ///* next target to measure at the current time, and whether its radar
+    ///* measurement is still due after the lidar one
+    int next_target_;
+    bool radar_pending_;
+
+    /**
+     * Advances to the next measurement time and moves all targets to it
+     * @return false if it is past the duration
+     */
+    bool NextTime();
+
+    /**
+     * @return The time of the count-th measurement of a sensor, or
+     * LONG_MAX if it is disabled
+     */
+    long SensorTime(double rate, double phase, long count) const;
+
+    /**
+     * Moves a target by delta_t s with random accelerations
+     */
+    void Move(Target &target, double delta_t);
+
+    void MeasureLidar(Target &target, MeasurementPackage &meas_package);
+
+    void MeasureRadar(Target &target, MeasurementPackage &meas_package);
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_SCENARIO_HPP
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "parallel.hpp"
+#include "smoother.hpp"
+#include "tools.hpp"
+
+namespace {
+    ///* chunks per thread of the parallel backward pass, balances uneven chunks
+    const int kChunksPerThread = 4;
+
+    ///* fewer nodes per chunk do not pay for composing the maps
+    const long kMinChunkSize = 1024;
+
+    /**
+     * @return The angle plus a multiple of 2 pi closest to reference
+     */
+    double unwrap(double angle, double reference) {
+        return reference + tools::NormalizeAngle(angle - reference);
+    }
+}
+
+Smoother::Smoother(UKF &ukf) : ukf_(ukf), begin_(0), restart_(false) {
+    ukf_.observer_ = this;
+}
+
+Smoother::~Smoother() {
+    if (ukf_.observer_ == this) {
+        ukf_.observer_ = NULL;
+    }
+}
+
+long Smoother::Commit() {
+    StoreFiltered();
+    return End() - 1;
+}
+
+long Smoother::Begin() const {
+    return begin_;
+}
+
+long Smoother::End() const {
+    return begin_ + (long) nodes_.size();
+}
+
+void Smoother::StoreFiltered() {
+    if (nodes_.empty() || restart_) {
+        // G = 0 of the newest node ends the smoothing of the nodes before
+        nodes_.push_back(Node());
+        nodes_.back().a = ukf_.x_;
+        nodes_.back().G.setZero();
+        restart_ = false;
+    } else {
+        Node &newest = nodes_.back();
+        double yaw = unwrap(ukf_.x_(3), newest.a(3));
+        newest.a = ukf_.x_;
+        newest.a(3) = yaw;
+    }
+    nodes_.back().B = ukf_.P_;
+}
+
+void Smoother::AfterInitialize(const UKF &) {
+    restart_ = true;
+}
+
+void Smoother::BeforePrediction(const UKF &) {
+    StoreFiltered();
+}
+
+void Smoother::AfterPrediction(const UKF &ukf) {
+    Node &previous = nodes_.back();
+    UKF::StateVector x_pred = ukf.x_;
+    x_pred(3) = unwrap(x_pred(3), previous.a(3));
+
+    //P_pred holds the deviations of the sigma points from the predicted yaw
+    //normalized, no smoothing across a step that wrapped one of them
+    bool wrapped = ((ukf.Xsig_pred_.row(3).array() - ukf.x_(3)).abs() > M_PI).any();
+
+    //cross-covariance of the sigma points before and after the step. The
+    //state rows of the sigma points are x -/+ the first n_x_ columns of the
+    //factor, the noise columns leave them at x, so with the equal weights
+    //C = w sum_j d_j (X_pred,j - X_pred,j+n_aug)^T over the n_x_ pairs. The
+    //yaw of a pair can be up to 2 pi apart without a wrapped deviation, its
+    //difference is not normalized.
+    UKF::StateMatrix C;
+    C.fill(0.0);
+    for (int j = 1; j <= UKF::n_x_; j++) {
+        UKF::StateVector x_diff = ukf.Xsig_.topRows<UKF::n_x_>().col(j) - ukf.Xsig_.topRows<UKF::n_x_>().col(0);
+        UKF::StateVector pred_diff = ukf.Xsig_pred_.col(j) - ukf.Xsig_pred_.col(j + UKF::n_aug_);
+        C = C + x_diff * pred_diff.transpose();
+    }
+    C *= ukf.weights_(1);
+
+    //G = C P_pred^-1, no smoothing across a step with an indefinite or a
+    //wrapped prediction
+    Eigen::LLT<UKF::StateMatrix> llt(ukf.P_);
+    if (llt.info() == Eigen::Success && !wrapped) {
+        previous.G = llt.solve(C.transpose()).transpose();
+    } else {
+        previous.G.setZero();
+    }
+    previous.a = previous.a - previous.G * x_pred;
+    //G P_pred G^T = C G^T
+    previous.B = previous.B - C * previous.G.transpose();
+
+    nodes_.push_back(Node());
+    Node &newest = nodes_.back();
+    newest.a = x_pred;
+    newest.B = ukf.P_;
+    newest.G.setZero();
+}
+
+void Smoother::Smooth(long end) {
+    UKF::StateVector x_s = UKF::StateVector::Zero();
+    UKF::StateMatrix P_s = UKF::StateMatrix::Zero();
+    for (long k = End() - 1; k >= begin_; k--) {
+        const Node &node = nodes_[k - begin_];
+        UKF::StateVector x = node.a + node.G * x_s;
+        UKF::StateMatrix P = node.B + node.G * P_s * node.G.transpose();
+        if (k < end) {
+            nodes_[k - begin_].a = x;
+            nodes_[k - begin_].B = P;
+        }
+        x_s = x;
+        P_s = P;
+    }
+}
+
+void Smoother::SmoothAll(int threads) {
+    long n = (long) nodes_.size();
+    long chunks = std::min((long) threads * kChunksPerThread, n / kMinChunkSize);
+    if (threads <= 1 || chunks <= 1) {
+        Smooth(End());
+        return;
+    }
+
+    //the maps x_b|n = a + A x_e|n and P_b|n = B + A P_e|n A^T of every chunk [b, e)
+    std::vector<UKF::StateVector> a(chunks + 1, UKF::StateVector::Zero());
+    std::vector<UKF::StateMatrix> A(chunks + 1), B(chunks + 1, UKF::StateMatrix::Zero());
+    auto first = [&](long c) {
+        return c * n / chunks;
+    };
+    parallel::For((int) chunks, threads, [&](int c) {
+        UKF::StateVector a_c = UKF::StateVector::Zero();
+        UKF::StateMatrix A_c = UKF::StateMatrix::Identity();
+        UKF::StateMatrix B_c = UKF::StateMatrix::Zero();
+        for (long k = first(c + 1) - 1; k >= first(c); k--) {
+            const Node &node = nodes_[k];
+            a_c = node.a + node.G * a_c;
+            A_c = node.G * A_c;
+            B_c = node.B + node.G * B_c * node.G.transpose();
+        }
+        a[c] = a_c;
+        A[c] = A_c;
+        B[c] = B_c;
+    });
+
+    //the smoothed state at the first node of every chunk, the newest chunk
+    //ends with G = 0 and does not depend on its successor
+    for (long c = chunks - 1; c >= 0; c--) {
+        a[c] = a[c] + A[c] * a[c + 1];
+        B[c] = B[c] + A[c] * B[c + 1] * A[c].transpose();
+    }
+
+    parallel::For((int) chunks, threads, [&](int c) {
+        UKF::StateVector x_s = a[c + 1];
+        UKF::StateMatrix P_s = B[c + 1];
+        for (long k = first(c + 1) - 1; k >= first(c); k--) {
+            Node &node = nodes_[k];
+            node.a = node.a + node.G * x_s;
+            node.B = node.B + node.G * P_s * node.G.transpose();
+            x_s = node.a;
+            P_s = node.B;
+        }
+    });
+}
+
+void Smoother::Drop(long end) {
+    while (begin_ < end && !nodes_.empty()) {
+        nodes_.pop_front();
+        begin_++;
+    }
+}
+
+UKF::StateVector Smoother::State(long node) const {
+    UKF::StateVector x = nodes_[node - begin_].a;
+    x(3) = tools::NormalizeAngle(x(3));
+    return x;
+}
+
+const UKF::StateMatrix &Smoother::Covariance(long node) const {
+    return nodes_[node - begin_].B;
+}
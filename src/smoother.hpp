@@ -0,0 +1,119 @@
+#ifndef UNSCENTED_KALMAN_FILTER_SMOOTHER_HPP
+#define UNSCENTED_KALMAN_FILTER_SMOOTHER_HPP
+
+#include <deque>
+#include "ukf.hpp"
+
+/**
+ * Unscented Rauch-Tung-Striebel smoother for a UKF.
+ *
+ * Attached to a filter it records the forward pass, one node per prediction
+ * step: the state x_k and covariance P_k the step starts from, the prediction
+ * x_k+1|k, P_k+1|k and the cross-covariance C_k+1 of the sigma points before
+ * and after the step. The backward pass
+ *
+ *     G_k = C_k+1 P_k+1|k^-1
+ *     x_k|n = x_k + G_k (x_k+1|n - x_k+1|k)
+ *     P_k|n = P_k + G_k (P_k+1|n - P_k+1|k) G_k^T
+ *
+ * is affine in the smoothed successor: x_k|n = a_k + G_k x_k+1|n and
+ * P_k|n = B_k + G_k P_k+1|n G_k^T. A node only keeps a_k, B_k and G_k, 440
+ * bytes, and is smoothed in place. The newest node is the filtered state
+ * with G = 0.
+ *
+ * Affine maps compose, so the backward pass over a whole log runs in chunks:
+ * the maps of every chunk are composed in parallel, the boundaries are
+ * chained from the newest chunk to the oldest, and then every chunk is
+ * smoothed from its boundary in parallel. Yaw angles are unwrapped along the
+ * nodes, so the differences need no normalization and the recursion stays
+ * affine.
+ */
+class Smoother : private PredictionObserverT<double> {
+public:
+    /**
+     * Attaches to the filter as its observer_ until destruction
+     */
+    explicit Smoother(UKF &ukf);
+
+    virtual ~Smoother();
+
+    /**
+     * Ends a measurement: stores the updated state of the filter in the
+     * newest node
+     * @return The index of the node, the one the measurement is smoothed at
+     */
+    long Commit();
+
+    /**
+     * @return The index of the oldest node kept
+     */
+    long Begin() const;
+
+    /**
+     * @return One past the index of the newest node
+     */
+    long End() const;
+
+    /**
+     * Smooths the nodes before end given all recorded nodes, the nodes from
+     * end on stay as recorded. Bounds the memory of fixed-lag smoothing
+     * together with Drop.
+     */
+    void Smooth(long end);
+
+    /**
+     * Smooths all nodes on up to threads threads. Ends the recording, the
+     * filter must not predict afterwards.
+     */
+    void SmoothAll(int threads);
+
+    /**
+     * Removes the nodes before end
+     */
+    void Drop(long end);
+
+    /**
+     * @return The state of a smoothed node, the yaw angle normalized
+     */
+    UKF::StateVector State(long node) const;
+
+    /**
+     * @return The covariance of a smoothed node
+     */
+    const UKF::StateMatrix &Covariance(long node) const;
+
+private:
+    struct Node {
+        ///* a_k, the smoothed state once smoothed
+        UKF::StateVector a;
+        ///* B_k, the smoothed covariance once smoothed
+        UKF::StateMatrix B;
+        ///* smoother gain G_k, 0 for the newest node
+        UKF::StateMatrix G;
+    };
+
+    UKF &ukf_;
+    std::deque<Node> nodes_;
+    ///* index of nodes_.front()
+    long begin_;
+    ///* the filter was initialized again, the next state starts a new node
+    ///* that does not follow from the newest one
+    bool restart_;
+
+    /**
+     * Stores the state of the filter in the newest node, with the yaw angle
+     * unwrapped against the node
+     */
+    void StoreFiltered();
+
+    void AfterInitialize(const UKF &ukf);
+
+    void BeforePrediction(const UKF &ukf);
+
+    void AfterPrediction(const UKF &ukf);
+
+    Smoother(const Smoother &);
+    Smoother &operator=(const Smoother &);
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_SMOOTHER_HPP
@@ -0,0 +1,90 @@
+#include <cmath>
+#include <cstring>
+#include "timing.hpp"
+
+namespace timing {
+
+    const char *StageName(Stage stage) {
+        switch (stage) {
+            case PARSE:
+                return "parse";
+            case PREDICT:
+                return "predict";
+            case LIDAR_UPDATE:
+                return "lidar update";
+            case RADAR_UPDATE:
+                return "radar update";
+            case JOINT_UPDATE:
+                return "joint update";
+            case WRITE:
+                return "write";
+            default:
+                return "?";
+        }
+    }
+
+    Histogram::Histogram() : count_(0), sum_(0), max_(0) {
+        memset(buckets_, 0, sizeof(buckets_));
+    }
+
+    uint64_t Histogram::Count() const {
+        return count_;
+    }
+
+    double Histogram::Mean() const {
+        return count_ > 0 ? (double) sum_ / count_ : 0;
+    }
+
+    uint64_t Histogram::Max() const {
+        return max_;
+    }
+
+    uint64_t Histogram::BucketMax(int index) {
+        if (index < kSub) {
+            return (uint64_t) index;
+        }
+        int shift = (index >> kSubBits) - 1;
+        uint64_t low = (uint64_t) (kSub + (index & (kSub - 1))) << shift;
+        return low + ((uint64_t) 1 << shift) - 1;
+    }
+
+    uint64_t Histogram::Percentile(double q) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        // rank of the quantile, 1 based
+        uint64_t rank = (uint64_t) std::ceil(q * count_);
+        if (rank < 1) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                uint64_t value = BucketMax(i);
+                return value < max_ ? value : max_;
+            }
+        }
+        return max_;
+    }
+
+    void Histogram::Merge(const Histogram &other) {
+        for (int i = 0; i < kBuckets; i++) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        if (other.max_ > max_) {
+            max_ = other.max_;
+        }
+    }
+
+    StageStats::StageStats() : elapsed(0) {}
+
+    void StageStats::Merge(const StageStats &other) {
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            stages[i].Merge(other.stages[i]);
+        }
+        elapsed += other.elapsed;
+    }
+}
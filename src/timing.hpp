@@ -0,0 +1,141 @@
+#ifndef UNSCENTED_KALMAN_FILTER_TIMING_HPP
+#define UNSCENTED_KALMAN_FILTER_TIMING_HPP
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Per-stage latency instrumentation.
+ *
+ * Stages are timed with ScopedTimer into the histograms of a StageStats. The
+ * timers do nothing when their StageStats pointer is NULL, and compile to
+ * nothing without UKF_TIMING (CMake option, on by default).
+ */
+namespace timing {
+
+    enum Stage {
+        PARSE,
+        PREDICT,
+        LIDAR_UPDATE,
+        RADAR_UPDATE,
+        ///* laser and radar of the same time in one stacked update
+        JOINT_UPDATE,
+        WRITE,
+        STAGE_COUNT
+    };
+
+    const char *StageName(Stage stage);
+
+    /**
+     * Latency histogram in ns with log-linear buckets: values below 16 have
+     * their own bucket, above that every power of two is split into 16
+     * buckets. Percentiles are exact to 1/16 (6%) of the value, with a fixed
+     * 8 kB of memory and constant time Add.
+     */
+    class Histogram {
+    public:
+        Histogram();
+
+        inline void Add(uint64_t ns) {
+            buckets_[BucketIndex(ns)]++;
+            count_++;
+            sum_ += ns;
+            if (ns > max_) {
+                max_ = ns;
+            }
+        }
+
+        uint64_t Count() const;
+
+        double Mean() const;
+
+        uint64_t Max() const;
+
+        /**
+         * @param q Quantile in [0, 1]
+         * @return The largest value of the bucket holding the quantile, at most Max
+         */
+        uint64_t Percentile(double q) const;
+
+        void Merge(const Histogram &other);
+
+    private:
+        static const int kSubBits = 4;
+        static const int kSub = 1 << kSubBits;
+        static const int kBuckets = (64 - kSubBits + 1) * kSub;
+
+        uint64_t buckets_[kBuckets];
+        uint64_t count_;
+        uint64_t sum_;
+        uint64_t max_;
+
+        static inline int BucketIndex(uint64_t ns) {
+            if (ns < kSub) {
+                return (int) ns;
+            }
+            int shift = 63 - __builtin_clzll(ns) - kSubBits;
+            return ((shift + 1) << kSubBits) + (int) ((ns >> shift) & (kSub - 1));
+        }
+
+        static uint64_t BucketMax(int index);
+    };
+
+    /**
+     * Histograms of all stages plus the wall time of the run
+     */
+    struct StageStats {
+        Histogram stages[STAGE_COUNT];
+
+        ///* wall time of the instrumented run in s
+        double elapsed;
+
+        StageStats();
+
+        void Merge(const StageStats &other);
+    };
+
+    inline uint64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+#ifdef UKF_TIMING
+
+    /**
+     * Adds the time from construction to destruction to a stage, if stats is not NULL
+     */
+    class ScopedTimer {
+    public:
+        ScopedTimer(StageStats *stats, Stage stage) : stats_(stats), stage_(stage), start_(0) {
+            if (stats_ != NULL) {
+                start_ = Now();
+            }
+        }
+
+        ~ScopedTimer() {
+            if (stats_ != NULL) {
+                stats_->stages[stage_].Add(Now() - start_);
+            }
+        }
+
+    private:
+        StageStats *stats_;
+        Stage stage_;
+        uint64_t start_;
+
+        ScopedTimer(const ScopedTimer &);
+        ScopedTimer &operator=(const ScopedTimer &);
+    };
+
+#else
+
+    class ScopedTimer {
+    public:
+        ScopedTimer(StageStats *, Stage) {}
+    };
+
+#endif
+
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_TIMING_HPP
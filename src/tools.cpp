@@ -11,36 +11,90 @@ namespace tools {
             throw std::invalid_argument( "CalculateRMSE () - Error: Invalid input values." );
         }
 
-        Eigen::VectorXd rmse(estimations[0].array().size());
-        rmse.fill(0.0d);
-
+        RMSEAccumulator rmse(estimations[0].size());
         for (int i = 0; i < estimations.size(); ++i) {
-            Eigen::VectorXd res = estimations[i] - groundTruth[i];
-            res = res.array() * res.array();
-            rmse += res;
+            rmse.Add(estimations[i], groundTruth[i]);
         }
-
-        rmse /= estimations.size();
-        rmse = rmse.array().sqrt();
-
-        return rmse;
+        return rmse.RMSE();
     }
 
-    float CalculateNISPerformance(const std::vector<float> &nis_values, MeasurementPackage::SensorType sensorType) {
+    float NISLimit95(MeasurementPackage::SensorType sensorType) {
         const float nis_radar_95 = 7.815;
         const float nis_lidar_95 = 5.991;
 
-        float limit_95 = sensorType == MeasurementPackage::RADAR ? nis_radar_95 : nis_lidar_95;
+        return sensorType == MeasurementPackage::RADAR ? nis_radar_95 : nis_lidar_95;
+    }
 
-        int nis_over_95 = 0;
+    float CalculateNISPerformance(const std::vector<float> &nis_values, MeasurementPackage::SensorType sensorType) {
+        NISAccumulator nis(sensorType);
         for(int i = 0; i < nis_values.size(); i++){
-            if(nis_values[i] > limit_95){
-                nis_over_95++;
-            }
+            nis.Add(nis_values[i]);
         }
+        return nis.Share();
+    }
+
+    RMSEAccumulator::RMSEAccumulator(int size) : squared_error(Eigen::VectorXd::Zero(size)), count(0) {}
 
-        return (nis_over_95/(float)nis_values.size());
+    void RMSEAccumulator::Merge(const RMSEAccumulator &other) {
+        squared_error += other.squared_error;
+        count += other.count;
+    }
+
+    Eigen::VectorXd RMSEAccumulator::RMSE() const {
+        if (count == 0) {
+            return Eigen::VectorXd::Zero(squared_error.size());
+        }
+        return (squared_error / count).array().sqrt();
+    }
+
+    NISAccumulator::NISAccumulator(MeasurementPackage::SensorType sensorType)
+            : limit(NISLimit95(sensorType)), count(0), over(0) {}
+
+    void NISAccumulator::Merge(const NISAccumulator &other) {
+        count += other.count;
+        over += other.over;
     }
-}
 
+    float NISAccumulator::Share() const {
+        if (count == 0) {
+            return 0;
+        }
+        return over / (float) count;
+    }
+
+    NEESAccumulator::NEESAccumulator() : sum(0), count(0), over(0) {}
+
+    void NEESAccumulator::Add(const Eigen::Vector2d &error, const Eigen::Matrix2d &covariance) {
+        // the 95% limit of the chi-squared distribution with 2 degrees of freedom
+        const double nees_95 = 5.991;
 
+        Eigen::LLT<Eigen::Matrix2d> llt(covariance);
+        if (llt.info() != Eigen::Success) {
+            return;
+        }
+        double nees = error.dot(llt.solve(error));
+        sum += nees;
+        over += nees > nees_95;
+        count++;
+    }
+
+    void NEESAccumulator::Merge(const NEESAccumulator &other) {
+        sum += other.sum;
+        count += other.count;
+        over += other.over;
+    }
+
+    double NEESAccumulator::Mean() const {
+        if (count == 0) {
+            return 0;
+        }
+        return sum / count;
+    }
+
+    float NEESAccumulator::Share() const {
+        if (count == 0) {
+            return 0;
+        }
+        return over / (float) count;
+    }
+}
@@ -1,6 +1,7 @@
 #ifndef TOOLS_HPP
 #define TOOLS_HPP
 
+#include <cmath>
 #include <vector>
 #include "lib/Eigen/Dense"
 #include "measurement_package.hpp"
@@ -15,6 +16,106 @@ namespace tools {
 
     float CalculateNISPerformance(const std::vector<float> &nis_values, MeasurementPackage::SensorType sensorType);
 
+    /**
+    * 95% limit of the chi-squared distribution with the degrees of freedom of the sensor.
+    */
+    float NISLimit95(MeasurementPackage::SensorType sensorType);
+
+    /**
+    * Running form of CalculateRMSE for streams: constant memory, queryable at
+    * any time, and accumulators of different threads or logs merge exactly
+    * by adding their sums.
+    */
+    struct RMSEAccumulator {
+        ///* sum of the squared residuals per component
+        Eigen::VectorXd squared_error;
+        long count;
+
+        explicit RMSEAccumulator(int size = 2);
+
+        template<typename Estimation, typename GroundTruth>
+        void Add(const Eigen::MatrixBase<Estimation> &estimation, const Eigen::MatrixBase<GroundTruth> &ground_truth) {
+            squared_error += (estimation - ground_truth).array().square().matrix();
+            count++;
+        }
+
+        void Merge(const RMSEAccumulator &other);
+
+        /**
+        * @return The RMSE so far, zero without values
+        */
+        Eigen::VectorXd RMSE() const;
+    };
+
+    /**
+    * Running form of CalculateNISPerformance, mergeable like RMSEAccumulator.
+    */
+    struct NISAccumulator {
+        ///* 95% limit of the sensor
+        float limit;
+        long count;
+        ///* values above the limit
+        long over;
+
+        explicit NISAccumulator(MeasurementPackage::SensorType sensorType = MeasurementPackage::LASER);
+
+        inline void Add(float nis) {
+            over += nis > limit;
+            count++;
+        }
+
+        void Merge(const NISAccumulator &other);
+
+        /**
+        * @return The share of values above the limit, zero without values
+        */
+        float Share() const;
+    };
+
+    /**
+    * Running normalized estimation error squared of the position: the error
+    * against the ground truth weighted by the inverse of the position block of
+    * P. A consistent filter has a mean NEES of 2, the degrees of freedom, and
+    * 5% of the values above the 95% limit. Mergeable like RMSEAccumulator.
+    */
+    struct NEESAccumulator {
+        double sum;
+        long count;
+        ///* values above the 95% limit of 2 degrees of freedom
+        long over;
+
+        NEESAccumulator();
+
+        /**
+        * Adds the NEES of a position error, nothing if the covariance is not
+        * positive definite
+        */
+        void Add(const Eigen::Vector2d &error, const Eigen::Matrix2d &covariance);
+
+        void Merge(const NEESAccumulator &other);
+
+        /**
+        * @return The mean NEES, zero without values
+        */
+        double Mean() const;
+
+        /**
+        * @return The share of values above the 95% limit, zero without values
+        */
+        float Share() const;
+    };
+
+    /**
+    * Wraps an angle into [-pi, pi]. Uses a single remainder instead of a
+    * subtraction loop, so a diverged filter with huge angles cannot stall.
+    */
+    inline double NormalizeAngle(double angle) {
+        if (angle > M_PI || angle < -M_PI) {
+            angle = std::remainder(angle, 2. * M_PI);
+        }
+        return angle;
+    }
+
 };
 
 #endif /* TOOLS_HPP */
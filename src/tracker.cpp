@@ -0,0 +1,434 @@
+#include <algorithm>
+#include <cmath>
+#include "tracker.hpp"
+
+namespace {
+    ///* tracks whose gate box has more cells are not entered in the grid
+    const int kMaxTrackCells = 256;
+
+    ///* minimum number of hash buckets
+    const int kMinBuckets = 1024;
+}
+
+/**
+ * Initializes the tracker without tracks
+ */
+Tracker::Tracker(const UKF &prototype) : prototype_(prototype), filters_(0, prototype) {
+    // chi-square 99% quantiles for 2 and 3 degrees of freedom
+    lidar_gate_ = 9.21;
+    radar_gate_ = 11.345;
+
+    max_misses_ = 3;
+    cell_size_ = 2.0;
+    use_grid_ = true;
+    gate_tests_ = 0;
+    next_id_ = 0;
+}
+
+Tracker::~Tracker() {}
+
+bool Tracker::Candidate::operator<(const Candidate &other) const {
+    if (nis_ != other.nis_) {
+        return nis_ < other.nis_;
+    }
+    if (detection_ != other.detection_) {
+        return detection_ < other.detection_;
+    }
+    return track_ < other.track_;
+}
+
+bool Tracker::Cells(double x, double y, double half_x, double half_y, double max_cells, CellRange &range) const {
+    double x0 = std::floor((x - half_x) / cell_size_);
+    double x1 = std::floor((x + half_x) / cell_size_);
+    double y0 = std::floor((y - half_y) / cell_size_);
+    double y1 = std::floor((y + half_y) / cell_size_);
+
+    // also false for NaN and for coordinates a long cannot hold
+    if (!((x1 - x0 + 1) * (y1 - y0 + 1) <= max_cells && std::fabs(x0) < 1e15 && std::fabs(y0) < 1e15)) {
+        return false;
+    }
+    range.x0_ = (long) x0;
+    range.x1_ = (long) x1;
+    range.y0_ = (long) y0;
+    range.y1_ = (long) y1;
+    return true;
+}
+
+int Tracker::Bucket(long cell_x, long cell_y) const {
+    unsigned long h = (unsigned long) cell_x * 73856093UL ^ (unsigned long) cell_y * 19349663UL;
+    return (int) (h & (unsigned long) (bucket_start_.size() - 2));
+}
+
+/**
+ * Counting sort of the (cell, track) entries into the buckets, bucket b
+ * holds bucket_tracks_[bucket_start_[b]] to bucket_tracks_[bucket_start_[b + 1] - 1].
+ */
+void Tracker::BuildGrid(double gate) {
+    const int n_tracks = tracks_.size();
+    track_cells_.resize(n_tracks);
+    oversized_.clear();
+
+    long entries = 0;
+    for (int t = 0; t < n_tracks; t++) {
+        // P_ holds entry (r, c) in column r + c * n_x
+        double var_x = filters_.P_(t, 0);
+        double var_y = filters_.P_(t, 1 + UKF::n_x_);
+        CellRange &range = track_cells_[t];
+        if (Cells(filters_.x_(t, 0), filters_.x_(t, 1), std::sqrt(gate * var_x), std::sqrt(gate * var_y),
+                  kMaxTrackCells, range)) {
+            entries += (range.x1_ - range.x0_ + 1) * (range.y1_ - range.y0_ + 1);
+        } else {
+            // tested against every detection instead
+            oversized_.push_back(t);
+            range.x0_ = range.y0_ = 0;
+            range.x1_ = range.y1_ = -1;
+        }
+    }
+
+    int n_buckets = kMinBuckets;
+    while (n_buckets < 2 * entries) {
+        n_buckets *= 2;
+    }
+    bucket_start_.assign(n_buckets + 1, 0);
+    bucket_tracks_.resize(entries);
+
+    //count into bucket_start_[b], then the running sum is the end of every bucket
+    for (int t = 0; t < n_tracks; t++) {
+        const CellRange &range = track_cells_[t];
+        for (long cx = range.x0_; cx <= range.x1_; cx++) {
+            for (long cy = range.y0_; cy <= range.y1_; cy++) {
+                bucket_start_[Bucket(cx, cy)]++;
+            }
+        }
+    }
+    for (int b = 1; b <= n_buckets; b++) {
+        bucket_start_[b] += bucket_start_[b - 1];
+    }
+
+    //fill every bucket from its end, which leaves bucket_start_ at the starts
+    for (int t = n_tracks - 1; t >= 0; t--) {
+        const CellRange &range = track_cells_[t];
+        for (long cx = range.x0_; cx <= range.x1_; cx++) {
+            for (long cy = range.y0_; cy <= range.y1_; cy++) {
+                bucket_tracks_[--bucket_start_[Bucket(cx, cy)]] = t;
+            }
+        }
+    }
+}
+
+void Tracker::Test(const MeasurementPackage &detection, int d, int t) {
+    // a track can be in several cells of the box and in a bucket twice
+    if (last_tested_[t] == d) {
+        return;
+    }
+    last_tested_[t] = d;
+    gate_tests_++;
+
+    const Gate &gate = gates_[t];
+    double nis;
+    bool passed;
+    if (detection.sensor_type_ == MeasurementPackage::RADAR) {
+        if (!gate.radar_valid_) {
+            return;
+        }
+        models::RadarModel::Vector z_diff = detection.raw_measurements_.head<models::RadarModel::n_z>() - gate.z_radar_;
+        models::RadarModel::Normalize(z_diff);
+        nis = z_diff.dot(gate.Si_radar_ * z_diff);
+        passed = nis <= radar_gate_;
+    } else {
+        if (!gate.lidar_valid_) {
+            return;
+        }
+        models::LidarModel::Vector z_diff = detection.raw_measurements_.head<models::LidarModel::n_z>() - gate.z_lidar_;
+        nis = z_diff.dot(gate.Si_lidar_ * z_diff);
+        passed = nis <= lidar_gate_;
+    }
+    if (passed) {
+        Candidate candidate = {nis, d, t};
+        candidates_.push_back(candidate);
+        detection_gated_[d] = 1;
+    }
+}
+
+bool Tracker::InGate(UKF &ukf, const MeasurementPackage &detection) const {
+    // the sigma points of the state at the frame time
+    ukf.PredictTo(ukf.previous_timestamp_);
+    if (detection.sensor_type_ == MeasurementPackage::RADAR) {
+        models::RadarModel::Vector z_pred;
+        models::RadarModel::Matrix S, Si;
+        ukf.PredictMeasurement(ukf.radar_model_, z_pred, S);
+        models::RadarModel::Vector z_diff = detection.raw_measurements_.head<models::RadarModel::n_z>() - z_pred;
+        models::RadarModel::Normalize(z_diff);
+        return Invert(S, Si) && z_diff.dot(Si * z_diff) <= radar_gate_;
+    }
+    models::LidarModel::Vector z_pred;
+    models::LidarModel::Matrix S, Si;
+    ukf.PredictMeasurement(ukf.lidar_model_, z_pred, S);
+    models::LidarModel::Vector z_diff = detection.raw_measurements_.head<models::LidarModel::n_z>() - z_pred;
+    return Invert(S, Si) && z_diff.dot(Si * z_diff) <= lidar_gate_;
+}
+
+int Tracker::ProcessFrame(long timestamp, const std::vector<MeasurementPackage> &detections,
+                          std::vector<long> *track_ids) {
+    const int n_tracks = tracks_.size();
+    const int n_detections = detections.size();
+
+    bool has_lidar = false;
+    bool has_radar = false;
+    for (int d = 0; d < n_detections; d++) {
+        if (detections[d].sensor_type_ == MeasurementPackage::RADAR) {
+            has_radar = true;
+        } else {
+            has_lidar = true;
+        }
+    }
+
+    /*****************************************************************************
+     *  Prediction
+     ****************************************************************************/
+
+    filters_.Configure(prototype_);
+    delta_t_.resize(n_tracks);
+    for (int t = 0; t < n_tracks; t++) {
+        delta_t_(t) = (timestamp - tracks_[t].timestamp_) / 1000000.0;
+        tracks_[t].timestamp_ = timestamp;
+    }
+    filters_.Prediction(delta_t_);
+
+    gates_.resize(n_tracks);
+    if (has_lidar) {
+        const int n_z = models::LidarModel::n_z;
+        filters_.PredictLidar(z_pred_, S_);
+        for (int t = 0; t < n_tracks; t++) {
+            Gate &gate = gates_[t];
+            models::LidarModel::Matrix S;
+            for (int a = 0; a < n_z; a++) {
+                gate.z_lidar_(a) = z_pred_(t, a);
+                for (int b = 0; b < n_z; b++) {
+                    S(a, b) = S_(t, a + b * n_z);
+                }
+            }
+            gate.lidar_valid_ = Invert(S, gate.Si_lidar_);
+        }
+    }
+    if (has_radar) {
+        const int n_z = models::RadarModel::n_z;
+        filters_.PredictRadar(z_pred_, S_);
+        for (int t = 0; t < n_tracks; t++) {
+            Gate &gate = gates_[t];
+            models::RadarModel::Matrix S;
+            for (int a = 0; a < n_z; a++) {
+                gate.z_radar_(a) = z_pred_(t, a);
+                for (int b = 0; b < n_z; b++) {
+                    S(a, b) = S_(t, a + b * n_z);
+                }
+            }
+            gate.radar_valid_ = Invert(S, gate.Si_radar_);
+        }
+    }
+
+    /*****************************************************************************
+     *  Gating
+     ****************************************************************************/
+
+    gate_tests_ = 0;
+    candidates_.clear();
+    last_tested_.assign(n_tracks, -1);
+    detection_gated_.assign(n_detections, 0);
+
+    double gate = std::max(has_lidar ? lidar_gate_ : 0.0, has_radar ? radar_gate_ : 0.0);
+    if (use_grid_) {
+        BuildGrid(gate);
+    }
+
+    const models::LidarModel::Matrix &R_lidar = prototype_.lidar_model_.R;
+    const models::RadarModel::Matrix &R_radar = prototype_.radar_model_.R;
+    for (int d = 0; d < n_detections; d++) {
+        const MeasurementPackage &detection = detections[d];
+
+        // position and the box its noise spans within the gate
+        double x, y, half_x, half_y;
+        if (detection.sensor_type_ == MeasurementPackage::RADAR) {
+            double rho = detection.raw_measurements_(0);
+            double phi = detection.raw_measurements_(1);
+            x = rho * std::cos(phi);
+            y = rho * std::sin(phi);
+            half_x = half_y = std::sqrt(gate) * (std::sqrt(R_radar(0, 0)) + std::fabs(rho) * std::sqrt(R_radar(1, 1)));
+        } else {
+            x = detection.raw_measurements_(0);
+            y = detection.raw_measurements_(1);
+            half_x = std::sqrt(gate * R_lidar(0, 0));
+            half_y = std::sqrt(gate * R_lidar(1, 1));
+        }
+
+        // boxes with more cells than tracks are cheaper to test against all tracks
+        CellRange range;
+        if (!use_grid_ || !Cells(x, y, half_x, half_y, n_tracks, range)) {
+            for (int t = 0; t < n_tracks; t++) {
+                Test(detection, d, t);
+            }
+            continue;
+        }
+
+        for (long cx = range.x0_; cx <= range.x1_; cx++) {
+            for (long cy = range.y0_; cy <= range.y1_; cy++) {
+                int b = Bucket(cx, cy);
+                for (int i = bucket_start_[b]; i < bucket_start_[b + 1]; i++) {
+                    Test(detection, d, bucket_tracks_[i]);
+                }
+            }
+        }
+        for (size_t i = 0; i < oversized_.size(); i++) {
+            Test(detection, d, oversized_[i]);
+        }
+    }
+
+    /*****************************************************************************
+     *  Association and update
+     ****************************************************************************/
+
+    std::sort(candidates_.begin(), candidates_.end());
+    detection_track_.assign(n_detections, -1);
+    track_taken_.assign(2 * n_tracks, 0);
+    int associated = 0;
+    for (size_t i = 0; i < candidates_.size(); i++) {
+        const Candidate &candidate = candidates_[i];
+        bool radar = detections[candidate.detection_].sensor_type_ == MeasurementPackage::RADAR;
+        char &taken = track_taken_[2 * candidate.track_ + radar];
+        if (detection_track_[candidate.detection_] < 0 && !taken) {
+            detection_track_[candidate.detection_] = candidate.track_;
+            taken = 1;
+            associated++;
+        }
+    }
+
+    //every track has at most one detection per sensor, the lidar and the
+    //radar updates run over all tracks with the others inactive
+    lidar_active_.setZero(n_tracks);
+    radar_active_.setZero(n_tracks);
+    z_lidar_.setZero(n_tracks, models::LidarModel::n_z);
+    z_radar_.setZero(n_tracks, models::RadarModel::n_z);
+    bool lidar_update = false;
+    bool radar_update = false;
+    for (int d = 0; d < n_detections; d++) {
+        int t = detection_track_[d];
+        if (t < 0) {
+            continue;
+        }
+        const MeasurementPackage &detection = detections[d];
+        if (detection.sensor_type_ == MeasurementPackage::RADAR) {
+            z_radar_.row(t) = detection.raw_measurements_.head<models::RadarModel::n_z>().transpose();
+            radar_active_(t) = 1;
+            radar_update = true;
+        } else {
+            z_lidar_.row(t) = detection.raw_measurements_.head<models::LidarModel::n_z>().transpose();
+            lidar_active_(t) = 1;
+            lidar_update = true;
+        }
+        tracks_[t].hits_++;
+        tracks_[t].misses_ = 0;
+    }
+    if (lidar_update) {
+        filters_.UpdateLidar(z_lidar_, lidar_active_);
+    }
+    if (radar_update) {
+        if (lidar_update && (lidar_active_ * radar_active_ > 0).any()) {
+            //the radar update of a track that also took a lidar detection
+            //starts from the sigma points of the updated state, like a UKF
+            //with two measurements of the same time
+            delta_t_.setZero(n_tracks);
+            filters_.Prediction(delta_t_);
+        }
+        filters_.UpdateRadar(z_radar_, radar_active_);
+    }
+    for (int t = 0; t < n_tracks; t++) {
+        if (!track_taken_[2 * t] && !track_taken_[2 * t + 1]) {
+            tracks_[t].misses_++;
+        }
+    }
+
+    if (track_ids != NULL) {
+        track_ids->assign(n_detections, -1);
+        for (int d = 0; d < n_detections; d++) {
+            if (detection_track_[d] >= 0) {
+                (*track_ids)[d] = tracks_[detection_track_[d]].id_;
+            }
+        }
+    }
+
+    /*****************************************************************************
+     *  Track management
+     ****************************************************************************/
+
+    int kept = 0;
+    for (int t = 0; t < n_tracks; t++) {
+        if (tracks_[t].misses_ <= max_misses_) {
+            if (kept != t) {
+                tracks_[kept] = tracks_[t];
+                filters_.CopyTrack(t, kept);
+            }
+            kept++;
+        }
+    }
+    tracks_.erase(tracks_.begin() + kept, tracks_.end());
+
+    //detections no track gated start new tracks. One in the gate of a track
+    //started earlier in the frame updates that track instead, so the lidar
+    //and the radar detection of a new target start a single track. Radar
+    //detections go first: a range rate update of a track without a heading
+    //would put all of it into the speed along x.
+    new_tracks_.clear();
+    new_filters_.clear();
+    new_taken_.clear();
+    for (int i = 0; i < 2 * n_detections; i++) {
+        int d = i % n_detections;
+        const MeasurementPackage &detection = detections[d];
+        bool radar = detection.sensor_type_ == MeasurementPackage::RADAR;
+        if (radar != (i < n_detections) || detection_track_[d] >= 0 || detection_gated_[d]) {
+            continue;
+        }
+        int n = 0;
+        while (n < (int) new_filters_.size() && (new_taken_[2 * n + radar] || !InGate(new_filters_[n], detection))) {
+            n++;
+        }
+
+        if (n < (int) new_filters_.size()) {
+            UKF &ukf = new_filters_[n];
+            if (radar) {
+                ukf.Update(ukf.radar_model_, detection.raw_measurements_.head<models::RadarModel::n_z>());
+            } else {
+                ukf.Update(ukf.lidar_model_, detection.raw_measurements_.head<models::LidarModel::n_z>());
+            }
+            new_tracks_[n].hits_++;
+        } else {
+            Track track;
+            track.id_ = next_id_++;
+            track.hits_ = 1;
+            track.misses_ = 0;
+            track.timestamp_ = timestamp;
+            new_tracks_.push_back(track);
+            new_filters_.push_back(prototype_);
+            UKF &ukf = new_filters_.back();
+            ukf.use_sqrt_ = false;
+            if (radar) {
+                ukf.Initialize(ukf.radar_model_, timestamp, detection.raw_measurements_.head<models::RadarModel::n_z>());
+            } else {
+                ukf.Initialize(ukf.lidar_model_, timestamp, detection.raw_measurements_.head<models::LidarModel::n_z>());
+            }
+            new_taken_.push_back(0);
+            new_taken_.push_back(0);
+        }
+        new_taken_[2 * n + radar] = 1;
+        if (track_ids != NULL) {
+            (*track_ids)[d] = new_tracks_[n].id_;
+        }
+    }
+
+    filters_.Resize(kept + new_tracks_.size());
+    for (size_t n = 0; n < new_tracks_.size(); n++) {
+        filters_.SetTrack(tracks_.size(), new_filters_[n].x_, new_filters_[n].P_);
+        tracks_.push_back(new_tracks_[n]);
+    }
+
+    return associated;
+}
@@ -0,0 +1,204 @@
+#ifndef UNSCENTED_KALMAN_FILTER_TRACKER_HPP
+#define UNSCENTED_KALMAN_FILTER_TRACKER_HPP
+
+#include <vector>
+#include "lib/Eigen/Dense"
+#include "lib/Eigen/StdVector"
+#include "measurement_package.hpp"
+#include "ukf.hpp"
+#include "ukf_batch.hpp"
+
+/**
+ * Tracks many targets with one filter each, run together in a UKFBatch.
+ *
+ * Every frame all tracks are predicted to the frame time. A detection is a
+ * candidate for a track if its NIS against the innovation covariance S of
+ * UKFBatch::PredictLidar or PredictRadar, the S the update uses, is within
+ * the gate of its sensor. Candidates are associated greedily in order of
+ * increasing NIS, at most one detection per sensor, track and frame. A track
+ * with a lidar and a radar detection is updated with both in turn, like a UKF
+ * with two measurements of the same time. Detections that passed no gate start
+ * new tracks, one track for the lidar and the radar detection of a new
+ * target. Those that lost their tracks to better detections are dropped.
+ * Tracks without a detection for more than max_misses_ frames are dropped.
+ *
+ * Candidates come from a uniform grid over the plane, hashed into buckets.
+ * Each track is entered in the cells its position gate box overlaps and each
+ * detection looks up the cells of its own noise box, so gating costs about
+ * O(tracks + detections) instead of O(tracks x detections). The boxes are
+ * exact bounds of the lidar gate and first order ones of the radar gate.
+ */
+class Tracker {
+public:
+    /**
+     * A target, its filter is the row of the track in filters_
+     */
+    struct Track {
+        ///* unique over the lifetime of the tracker
+        long id_;
+
+        ///* number of detections associated with the track, including the first
+        int hits_;
+
+        ///* number of frames in a row without a detection
+        int misses_;
+
+        ///* time of the state of the track in us
+        long timestamp_;
+    };
+
+    typedef std::vector<Track> TrackVector;
+
+    ///* its noise parameters, initial covariance and trig mode apply to all
+    ///* tracks from the next frame on, use_sqrt_ does not apply
+    UKF prototype_;
+
+    ///* NIS gates, the 99% quantiles of the chi-square distribution
+    double lidar_gate_;
+    double radar_gate_;
+
+    ///* frames without a detection after which a track is dropped
+    int max_misses_;
+
+    ///* edge length of the grid cells in m
+    double cell_size_;
+
+    ///* if false every detection is gated against every track
+    bool use_grid_;
+
+    ///* the current tracks, ordered by id
+    TrackVector tracks_;
+
+    ///* the filters of the tracks, row t is the filter of tracks_[t]
+    UKFBatch filters_;
+
+    ///* number of NIS evaluations in the last frame
+    long gate_tests_;
+
+    /**
+     * Constructor
+     * @param prototype Filter the tracks are copied from
+     */
+    explicit Tracker(const UKF &prototype = UKF());
+
+    /**
+     * Destructor
+     */
+    virtual ~Tracker();
+
+    /**
+     * Processes the detections of one frame
+     * @param timestamp Time of the frame in us, not earlier than the last one
+     * @param detections Lidar and radar detections of the frame
+     * @param track_ids If given, receives the id of the track of every
+     * detection, new tracks included, -1 for dropped detections
+     * @return Number of detections associated with existing tracks
+     */
+    int ProcessFrame(long timestamp, const std::vector<MeasurementPackage> &detections,
+                     std::vector<long> *track_ids = NULL);
+
+private:
+    ///* predicted measurements and inverse innovation covariances of a track
+    struct Gate {
+        ///* false if S is not positive definite, the NIS then has no bound
+        ///* and the track is not gated
+        bool lidar_valid_;
+        bool radar_valid_;
+        models::LidarModel::Vector z_lidar_;
+        models::LidarModel::Matrix Si_lidar_;
+        models::RadarModel::Vector z_radar_;
+        models::RadarModel::Matrix Si_radar_;
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    ///* a detection that passed the gate of a track
+    struct Candidate {
+        double nis_;
+        int detection_;
+        int track_;
+
+        bool operator<(const Candidate &other) const;
+    };
+
+    ///* grid cells a box overlaps, inclusive
+    struct CellRange {
+        long x0_, y0_, x1_, y1_;
+    };
+
+    ///* id of the next new track
+    long next_id_;
+
+    ///* Work buffers, reused across frames
+    std::vector<Gate, Eigen::aligned_allocator<Gate> > gates_;
+    std::vector<Candidate> candidates_;
+    std::vector<int> bucket_start_;
+    std::vector<int> bucket_tracks_;
+    std::vector<CellRange> track_cells_;
+    std::vector<int> oversized_;
+    std::vector<int> last_tested_;
+    std::vector<int> detection_track_;
+    ///* the detection passed the gate of a track
+    std::vector<char> detection_gated_;
+    ///* entry 2 * t for a lidar, 2 * t + 1 for a radar detection of track t
+    std::vector<char> track_taken_;
+    ///* tracks started in the frame, with their filters and track_taken_ entries
+    TrackVector new_tracks_;
+    std::vector<UKF, Eigen::aligned_allocator<UKF> > new_filters_;
+    std::vector<char> new_taken_;
+    UKFBatch::TrackArray delta_t_;
+    UKFBatch::TrackArray lidar_active_;
+    UKFBatch::TrackArray radar_active_;
+    UKFBatch::TrackMatrix z_lidar_;
+    UKFBatch::TrackMatrix z_radar_;
+    UKFBatch::TrackMatrix z_pred_;
+    UKFBatch::TrackMatrix S_;
+
+    /**
+     * Cells of the box [x - half_x, x + half_x] x [y - half_y, y + half_y]
+     * @param max_cells Maximum number of cells of the box
+     * @return false if the box has more cells or is not finite, range is then invalid
+     */
+    bool Cells(double x, double y, double half_x, double half_y, double max_cells, CellRange &range) const;
+
+    /**
+     * @return The bucket of a cell
+     */
+    int Bucket(long cell_x, long cell_y) const;
+
+    /**
+     * Enters every track in the buckets of the cells its gate box overlaps
+     * @param gate The larger gate of the sensors in the frame
+     */
+    void BuildGrid(double gate);
+
+    /**
+     * Inverts an innovation covariance
+     * @return false if S is not positive definite
+     */
+    template<int n_z>
+    static bool Invert(const Eigen::Matrix<double, n_z, n_z> &S, Eigen::Matrix<double, n_z, n_z> &Si);
+
+    /**
+     * Gates a detection against a track and records it as a candidate if it passes
+     */
+    void Test(const MeasurementPackage &detection, int d, int t);
+
+    /**
+     * Gates a detection against the filter of a track started in this frame
+     * @return true if the NIS is within the gate of the sensor
+     */
+    bool InGate(UKF &ukf, const MeasurementPackage &detection) const;
+};
+
+template<int n_z>
+bool Tracker::Invert(const Eigen::Matrix<double, n_z, n_z> &S, Eigen::Matrix<double, n_z, n_z> &Si) {
+    Eigen::LLT<Eigen::Matrix<double, n_z, n_z> > llt(S);
+    if (llt.info() != Eigen::Success) {
+        return false;
+    }
+    Si = llt.solve(Eigen::Matrix<double, n_z, n_z>::Identity());
+    return true;
+}
+
+#endif //UNSCENTED_KALMAN_FILTER_TRACKER_HPP
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include "log_reader.hpp"
+#include "output_writer.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+namespace {
+    ///* the members of NoiseParameters in declaration order
+    const char *const kNames[tuning::kParameterCount] = {
+            "std_a", "std_yawdd", "std_laspx", "std_laspy", "std_radr", "std_radphi", "std_radrd"};
+
+    double NoiseParameters::*const kMembers[tuning::kParameterCount] = {
+            &NoiseParameters::std_a, &NoiseParameters::std_yawdd, &NoiseParameters::std_laspx,
+            &NoiseParameters::std_laspy, &NoiseParameters::std_radr, &NoiseParameters::std_radphi,
+            &NoiseParameters::std_radrd};
+
+    ///* more values for one parameter are most likely a typo in the step
+    const long kMaxValues = 10000;
+
+    /**
+     * Parses a whole string as a number
+     */
+    bool parseNumber(const std::string &text, double &value) {
+        char *end;
+        value = std::strtod(text.c_str(), &end);
+        return !text.empty() && *end == '\0' && std::isfinite(value);
+    }
+
+    /**
+     * Rounds a value to 15 significant digits, which drops the rounding error
+     * of from + k * step: 0.3:1.2:0.1 gives 0.9, not 0.8999999999999999
+     */
+    double roundDecimal(double value) {
+        char text[32];
+        std::to_chars_result result = std::to_chars(text, text + sizeof(text), value,
+                                                    std::chars_format::general, 15);
+        std::from_chars(text, result.ptr, value);
+        return value;
+    }
+
+    /**
+     * @return The number of NIS values over the 95% limit fits the 5% of a
+     * consistent filter: its chi-square statistic against the binomial
+     * expectation, with 1 degree of freedom, is within the limit. Sensors
+     * without measurements do not count.
+     */
+    bool isConsistent(const tools::NISAccumulator &nis, double limit) {
+        if (nis.count == 0) {
+            return true;
+        }
+        double expected = 0.05 * nis.count;
+        double deviation = nis.over - expected;
+        return deviation * deviation / (expected * 0.95) <= limit;
+    }
+}
+
+namespace tuning {
+
+    const char *ParameterName(int i) {
+        return kNames[i];
+    }
+
+    double &Parameter(NoiseParameters &noise, int i) {
+        return noise.*kMembers[i];
+    }
+
+    bool ParseSpec(const std::string &spec, Grid &grid, std::string &error) {
+        size_t equals = spec.find('=');
+        if (equals == std::string::npos) {
+            error = "expected name=values in " + spec;
+            return false;
+        }
+        std::string name = spec.substr(0, equals);
+        std::replace(name.begin(), name.end(), '-', '_');
+        int parameter = std::find(kNames, kNames + kParameterCount, name) - kNames;
+        if (parameter == kParameterCount) {
+            error = "unknown parameter " + spec.substr(0, equals);
+            return false;
+        }
+
+        std::string values = spec.substr(equals + 1);
+        std::vector<double> &out = grid.values[parameter];
+        if (values.find(':') != std::string::npos) {
+            size_t first = values.find(':');
+            size_t second = values.find(':', first + 1);
+            double from, to, step;
+            if (second == std::string::npos
+                || !parseNumber(values.substr(0, first), from)
+                || !parseNumber(values.substr(first + 1, second - first - 1), to)
+                || !parseNumber(values.substr(second + 1), step)) {
+                error = "expected from:to:step in " + spec;
+                return false;
+            }
+            if (!(step > 0) || to < from || (to - from) / step >= kMaxValues) {
+                error = "empty or too large range in " + spec;
+                return false;
+            }
+            // the end is included despite the rounding of the steps
+            long n = (long) std::floor((to - from) / step + 1e-9) + 1;
+            for (long k = 0; k < n; k++) {
+                out.push_back(roundDecimal(from + k * step));
+            }
+            return true;
+        }
+
+        size_t begin = 0;
+        while (true) {
+            size_t comma = values.find(',', begin);
+            double value;
+            if (!parseNumber(values.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin),
+                             value)) {
+                error = "expected a list of numbers in " + spec;
+                return false;
+            }
+            out.push_back(value);
+            if (comma == std::string::npos) {
+                return true;
+            }
+            begin = comma + 1;
+        }
+    }
+
+    std::vector<NoiseParameters> Configurations(const Grid &grid, const NoiseParameters &defaults) {
+        std::vector<NoiseParameters> configurations(1, defaults);
+        for (int i = 0; i < kParameterCount; i++) {
+            const std::vector<double> &values = grid.values[i];
+            if (values.empty()) {
+                continue;
+            }
+            std::vector<NoiseParameters> expanded;
+            expanded.reserve(configurations.size() * values.size());
+            for (size_t c = 0; c < configurations.size(); c++) {
+                for (size_t v = 0; v < values.size(); v++) {
+                    NoiseParameters noise = configurations[c];
+                    Parameter(noise, i) = values[v];
+                    expanded.push_back(noise);
+                }
+            }
+            configurations.swap(expanded);
+        }
+        return configurations;
+    }
+
+    bool LoadLog(const std::string &file_name, std::vector<binary_log::Record> &records) {
+        LogReader in_file;
+        if (!in_file.Open(file_name)) {
+            return false;
+        }
+        records.clear();
+        MeasurementPackage meas_package;
+        GroundTruthPackage gt_package;
+        binary_log::Record record;
+        while (in_file.Next(meas_package, gt_package)) {
+            binary_log::FromPackages(meas_package, gt_package, record);
+            records.push_back(record);
+        }
+        return true;
+    }
+
+    std::vector<Result> Evaluate(const std::vector<std::vector<binary_log::Record> > &logs,
+                                 const std::vector<NoiseParameters> &configurations,
+                                 const ReplayOptions &options, int threads) {
+        std::vector<Result> results(configurations.size());
+        parallel::For((int) results.size(), threads, [&](int c) {
+            ReplayOptions job_options = options;
+            job_options.noise = &configurations[c];
+            job_options.verbose = false;
+            job_options.time_stages = false;
+            job_options.smooth_threads = 1;
+
+            ReplayResult total;
+            for (size_t l = 0; l < logs.size(); l++) {
+                LogReader in_file;
+                in_file.OpenRecords(logs[l].empty() ? NULL : &logs[l][0], logs[l].size());
+                OutputWriter no_output;
+                total.Merge(processStream(in_file, no_output, job_options));
+            }
+
+            Result &result = results[c];
+            result.noise = configurations[c];
+            result.rmse = total.rmse;
+            result.lidar_nis = total.lidar_nis;
+            result.radar_nis = total.radar_nis;
+            result.nees = total.nees;
+            result.consistent = false;
+        });
+        return results;
+    }
+
+    void Rank(std::vector<Result> &results, double nis_limit) {
+        for (size_t i = 0; i < results.size(); i++) {
+            Result &result = results[i];
+            result.consistent = result.rmse.count > 0
+                                && isConsistent(result.lidar_nis, nis_limit)
+                                && isConsistent(result.radar_nis, nis_limit);
+        }
+        // stable, equal configurations keep the grid order
+        std::stable_sort(results.begin(), results.end(), [](const Result &a, const Result &b) {
+            if (a.consistent != b.consistent) {
+                return a.consistent;
+            }
+            return a.rmse.RMSE().sum() < b.rmse.RMSE().sum();
+        });
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef UNSCENTED_KALMAN_FILTER_TUNING_HPP
+#define UNSCENTED_KALMAN_FILTER_TUNING_HPP
+
+#include <string>
+#include <vector>
+#include "binary_log.hpp"
+#include "replay.hpp"
+#include "ukf.hpp"
+
+/**
+ * Noise parameter sweeps: every combination of the given parameter values is
+ * replayed over one or more logs and the configurations are ranked by
+ * consistency and accuracy.
+ */
+namespace tuning {
+
+    ///* number of members of NoiseParameters
+    const int kParameterCount = 7;
+
+    ///* 95% limit of the chi-square distribution with 1 degree of freedom, the default of Rank
+    const double kNISLimit95 = 3.841;
+
+    /**
+     * @return The name of the i-th member of NoiseParameters, like "std_a"
+     */
+    const char *ParameterName(int i);
+
+    /**
+     * @return The i-th member of NoiseParameters
+     */
+    double &Parameter(NoiseParameters &noise, int i);
+
+    /**
+     * Values to try per parameter, an empty list keeps the default
+     */
+    struct Grid {
+        std::vector<double> values[kParameterCount];
+    };
+
+    /**
+     * Adds the values of a spec to the grid. A spec is name=v1,v2,... or
+     * name=from:to:step with to included, name a member of NoiseParameters
+     * with - or _, like std-a=0.3:1.2:0.1.
+     * @param error Receives the reason if the spec is invalid
+     * @return false if the spec is invalid
+     */
+    bool ParseSpec(const std::string &spec, Grid &grid, std::string &error);
+
+    /**
+     * @return Every combination of the grid values, defaults for the
+     * parameters without values. The last parameter varies fastest.
+     */
+    std::vector<NoiseParameters> Configurations(const Grid &grid, const NoiseParameters &defaults);
+
+    /**
+     * Reads a text or binary log into memory as binary records
+     * @return false if the log cannot be opened
+     */
+    bool LoadLog(const std::string &file_name, std::vector<binary_log::Record> &records);
+
+    /**
+     * Accuracy and consistency of a configuration over all logs, the part of
+     * ReplayResult a sweep keeps
+     */
+    struct Result {
+        NoiseParameters noise;
+        tools::RMSEAccumulator rmse;
+        tools::NISAccumulator lidar_nis;
+        tools::NISAccumulator radar_nis;
+        tools::NEESAccumulator nees;
+        ///* the NIS shares of all sensors with measurements pass the chi-square test of Rank
+        bool consistent;
+    };
+
+    /**
+     * Replays every configuration over all logs on up to threads threads, one
+     * configuration per job. The logs are shared read-only between the jobs
+     * and no rows are written.
+     * @param options Applied to every replay, its noise is replaced
+     * @return The results in the order of the configurations
+     */
+    std::vector<Result> Evaluate(const std::vector<std::vector<binary_log::Record> > &logs,
+                                 const std::vector<NoiseParameters> &configurations,
+                                 const ReplayOptions &options, int threads);
+
+    /**
+     * Sorts the consistent configurations first, then by the sum of the
+     * position RMSE. The NIS shares and the RMSE are the ones of
+     * tools::CalculateNISPerformance and tools::CalculateRMSE, accumulated
+     * while replaying. A configuration is consistent if, for every sensor,
+     * the number n_over of its n NIS values above the 95% limit passes a
+     * chi-square test against the 5% a consistent filter has:
+     * (n_over - 0.05 n)^2 / (0.05 * 0.95 n) <= nis_limit.
+     * @param nis_limit Chi-square limit with 1 degree of freedom, 3.841 is the 95% level
+     */
+    void Rank(std::vector<Result> &results, double nis_limit);
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_TUNING_HPP
@@ -1,13 +1,15 @@
 #include <iostream>
 #include "ukf.hpp"
+#include "tools.hpp"
+#include "ctrv_kernel.hpp"
 
-using Eigen::VectorXd;
-using Eigen::MatrixXd;
+static_assert(UKF::n_x_ == models::n_x, "measurement models and UKF disagree on the state");
 
 /**
  * Initializes Unscented Kalman filter
  */
-UKF::UKF() {
+template<typename Scalar>
+UKFT<Scalar>::UKFT() {
     /*****************************************************************************
      *  Process noise
      ****************************************************************************/
@@ -45,129 +47,157 @@ UKF::UKF() {
      *  Initialisation
      ****************************************************************************/
 
-    is_initialized_ = false;
+    use_sqrt_ = false;
+
+    use_fast_trig_ = false;
+
+    stats_ = NULL;
 
-    n_x_ = 5;
+    observer_ = NULL;
 
-    n_aug_ = n_x_ + 2;
+    previous_timestamp_ = 0;
+
+    NIS_radar_ = 0;
+
+    NIS_laser_ = 0;
 
     lambda_ = 3 - n_aug_;
 
-    // initial state vector
-    x_ = VectorXd(5);
-    x_aug = VectorXd(7);
+    sigma_scale_ = std::sqrt(lambda_ + n_aug_);
 
-    Q_ = MatrixXd(2, 2);
-    Q_ << std_a_ * std_a_, 0,
-            0, std_yawdd_ * std_yawdd_;
+    Reset();
+
+    // the noise rows of the sigma points are set by SetNoise
+    Xsig_.fill(0.0);
+
+    weights_.segment(1, 2 * n_aug_).fill(Scalar(0.5) / (n_aug_ + lambda_));
+    weights_(0) = lambda_ / (lambda_ + n_aug_);
+
+    SetNoise(Noise());
+}
 
-    // initial covariance matrix
-    P_ = MatrixXd(5, 5);
-    P_ << 1, 0, 0, 0, 0,
+template<typename Scalar>
+typename UKFT<Scalar>::StateMatrix UKFT<Scalar>::InitialCovariance() {
+    StateMatrix P;
+    P << 1, 0, 0, 0, 0,
             0, 1, 0, 0, 0,
             0, 0, 1000, 0, 0,
             0, 0, 0, 100, 0,
             0, 0, 0, 0, 1;
+    return P;
+}
 
-    P_aug = MatrixXd(7, 7);
-    P_aug.topLeftCorner(n_x_, n_x_) = P_;
-    P_aug.bottomRightCorner(Q_.rows(), Q_.cols()) = Q_;
+template<typename Scalar>
+void UKFT<Scalar>::Reset() {
+    is_initialized_ = false;
 
-    weights_ = VectorXd(2 * n_aug_ + 1);
-    weights_.segment(1, 2 * n_aug_).fill(0.5d / (n_aug_ + lambda_));
-    weights_(0) = lambda_ / (lambda_ + n_aug_);
+    // initial state vector and covariance matrix
+    x_.fill(0.0);
+    P_ = InitialCovariance();
 
-    //create sigma point matrix
-    Xsig_ = MatrixXd(n_aug_, 2 * n_aug_ + 1);
-    Xsig_pred_ = MatrixXd(n_x_, 2 * n_aug_ + 1);
+    // square roots for the square-root mode
+    sqrt_P_ = P_.llt().matrixL();
+}
 
-    n_z_radar_ = 3;
-    Zsig_ = MatrixXd(n_z_radar_, 2 * n_aug_ + 1);
+template<typename Scalar>
+UKFT<Scalar>::~UKFT() {}
 
+template<typename Scalar>
+void UKFT<Scalar>::SetNoise(const NoiseParameters &noise) {
+    std_a_ = noise.std_a;
+    std_yawdd_ = noise.std_yawdd;
+    std_laspx_ = noise.std_laspx;
+    std_laspy_ = noise.std_laspy;
+    std_radr_ = noise.std_radr;
+    std_radphi_ = noise.std_radphi;
+    std_radrd_ = noise.std_radrd;
 
-    H_laser_ = MatrixXd(2, 5);
-    H_laser_ << 1, 0, 0, 0, 0,
-            0, 1, 0, 0, 0;
+    Q_ << std_a_ * std_a_, 0,
+            0, std_yawdd_ * std_yawdd_;
+    sqrt_Q_ = Q_.llt().matrixL();
+
+    // the noise rows of the sigma points only depend on Q_: zero but for the
+    // scaled factor of Q_ in the noise columns
+    Xsig_.template bottomRows<2>().setZero();
+    Xsig_.template block<2, 2>(n_x_, 1 + n_x_) = sigma_scale_ * sqrt_Q_;
+    Xsig_.template block<2, 2>(n_x_, 1 + n_aug_ + n_x_) = -sigma_scale_ * sqrt_Q_;
 
-    R_laser_ = MatrixXd(2, 2);
-    R_laser_ << std_laspx_, 0,
+    typename LidarModel::Matrix R_laser;
+    R_laser << std_laspx_, 0,
             0, std_laspy_;
+    lidar_model_.SetNoise(R_laser);
 
-    R_radar_ = MatrixXd(n_z_radar_, n_z_radar_);
-    R_radar_ << std_radr_ * std_radr_, 0, 0,
+    typename RadarModel::Matrix R_radar;
+    R_radar << std_radr_ * std_radr_, 0, 0,
             0, std_radphi_ * std_radphi_, 0,
             0, 0, std_radrd_ * std_radrd_;
+    radar_model_.SetNoise(R_radar);
 }
 
-UKF::~UKF() {}
+template<typename Scalar>
+NoiseParameters UKFT<Scalar>::Noise() const {
+    NoiseParameters noise = {std_a_, std_yawdd_, std_laspx_, std_laspy_, std_radr_, std_radphi_, std_radrd_};
+    return noise;
+}
 
 /**
  * @param {MeasurementPackage} meas_package The latest measurement data of
  * either radar or laser.
  */
-void UKF::ProcessMeasurement(MeasurementPackage measurement_pack) {
-    /*****************************************************************************
-     *  Initialization
-     ****************************************************************************/
-    if (!is_initialized_) {
-        // first measurement
-        std::cout << "UKF: " << std::endl;
-
-        double px = 0;
-        double py = 0;
-
-        if (measurement_pack.sensor_type_ == MeasurementPackage::RADAR) {
-            double rho = measurement_pack.raw_measurements_[0];
-            double phi = measurement_pack.raw_measurements_[1];
-
-            px = rho * cos(phi);
-            py = rho * sin(phi);
-
-            // If initial values are zero they will set to an initial guess
-            // and the uncertainty will be increased.
-            // Initial zeros would cause the algorithm to fail when using only Radar data.
-            if(fabs(px) < 0.0001){
-                px = 1;
-                P_(0,0) = 1000;
-            }
-            if(fabs(py) < 0.0001){
-                py = 1;
-                P_(1,1) = 1000;
-            }
-
-        } else if (measurement_pack.sensor_type_ == MeasurementPackage::LASER) {
-            px = measurement_pack.raw_measurements_[0];
-            py = measurement_pack.raw_measurements_[1];
-        }
-
-        x_ << px, py, 0, 0, 0;
-        x_aug << x_.array(), 0, 0;
-        previous_timestamp_ = measurement_pack.timestamp_;
+template<typename Scalar>
+void UKFT<Scalar>::ProcessMeasurement(const MeasurementPackage &measurement_pack) {
+    if (measurement_pack.sensor_type_ == MeasurementPackage::RADAR) {
+        // Radar updates
+        NIS_radar_ = ProcessMeasurement(radar_model_, measurement_pack.timestamp_,
+                                        measurement_pack.raw_measurements_.head<RadarModel::n_z>().template cast<Scalar>(),
+                                        timing::RADAR_UPDATE);
+    } else {
+        // Laser updates
+        NIS_laser_ = ProcessMeasurement(lidar_model_, measurement_pack.timestamp_,
+                                        measurement_pack.raw_measurements_.head<LidarModel::n_z>().template cast<Scalar>(),
+                                        timing::LIDAR_UPDATE);
+    }
+}
 
-        is_initialized_ = true;
+/**
+ * Laser and radar measurements of the same time share one prediction and
+ * are applied in one 5-dimensional update.
+ */
+template<typename Scalar>
+void UKFT<Scalar>::ProcessJointMeasurement(const MeasurementPackage &laser_pack, const MeasurementPackage &radar_pack) {
+    if (is_initialized_ && prediction::IsStale(previous_timestamp_, laser_pack.timestamp_)) {
+        Reset();
+    }
+    if (!is_initialized_) {
+        ProcessMeasurement(laser_pack);
+        ProcessMeasurement(radar_pack);
         return;
     }
 
-    /*****************************************************************************
-     *  Prediction
-     ****************************************************************************/
-
-    double dt = (measurement_pack.timestamp_ - previous_timestamp_) / 1000000.0;
-    previous_timestamp_ = measurement_pack.timestamp_;
-
-    Prediction(dt);
-
-    /*****************************************************************************
-     *  Update
-     ****************************************************************************/
-
+    PredictTo(laser_pack.timestamp_);
+    timing::ScopedTimer timer(stats_, timing::JOINT_UPDATE);
+    UpdateJoint(lidar_model_, laser_pack.raw_measurements_.head<LidarModel::n_z>().template cast<Scalar>(),
+                radar_model_, radar_pack.raw_measurements_.head<RadarModel::n_z>().template cast<Scalar>(),
+                NIS_laser_, NIS_radar_);
+}
 
-    if (measurement_pack.sensor_type_ == MeasurementPackage::RADAR) {
-        // Radar updates
-        UpdateRadar(measurement_pack);
-    } else {
-        // Laser updates
-        UpdateLidar(measurement_pack);
+/**
+ * Predicts the state to the given time.
+ * @param {long} timestamp in us
+ */
+template<typename Scalar>
+void UKFT<Scalar>::PredictTo(long timestamp) {
+    timing::ScopedTimer timer(stats_, timing::PREDICT);
+    Scalar dt = (timestamp - previous_timestamp_) / Scalar(1000000);
+    previous_timestamp_ = timestamp;
+
+    // Long gaps are integrated in equal smaller steps: with the negative
+    // weight of the center sigma point a single large CTRV step can leave P_
+    // indefinite.
+    int steps = prediction::StepCount(dt);
+    Scalar step = dt / steps;
+    for (int i = 0; i < steps; i++) {
+        Prediction(step);
     }
 }
 
@@ -176,85 +206,55 @@ void UKF::ProcessMeasurement(MeasurementPackage measurement_pack) {
  * @param {double} delta_t the change in time (in seconds) between the last
  * measurement and this one.
  */
-void UKF::Prediction(double delta_t) {
-
-    //create augmented mean state
-    x_aug << x_.array(), 0, 0;
-
-    P_aug.topLeftCorner(n_x_, n_x_) = P_;
-    P_aug.bottomRightCorner(Q_.rows(), Q_.cols()) = Q_;
-
-    //calculate square root of P
-    MatrixXd A = P_aug.llt().matrixL();
+template<typename Scalar>
+void UKFT<Scalar>::Prediction(Scalar delta_t) {
+    if (observer_ != NULL) {
+        observer_->BeforePrediction(*this);
+    }
 
-    //create augmented sigma points
-    Xsig_.colwise() = x_aug;
-    MatrixXd offset = A * sqrt(lambda_ + n_aug_);
+    //P_aug is block diagonal, so is its factor: only the state block of P
+    //is factored, in square-root mode it is carried over from the last step
+    StateMatrix offset;
+    if (use_sqrt_) {
+        offset = sigma_scale_ * sqrt_P_;
+    } else {
+        offset = sigma_scale_ * StateMatrix(P_.llt().matrixL());
+    }
 
-    Xsig_.block(0, 1, n_aug_, n_aug_) += offset;
-    Xsig_.block(0, n_aug_ + 1, n_aug_, n_aug_) -= offset;
+    //create augmented sigma points: the state rows are x_ and x_ +/- the
+    //offset, the noise columns leave them at x_. The noise rows are constant.
+    Xsig_.template topRows<n_x_>().colwise() = x_;
+    Xsig_.template block<n_x_, n_x_>(0, 1) += offset;
+    Xsig_.template block<n_x_, n_x_>(0, n_aug_ + 1) -= offset;
 
 
     //predict sigma points
-    for (int i = 0; i < 2 * n_aug_ + 1; i++) {
-        //extract values for better readability
-        double p_x = Xsig_(0, i);
-        double p_y = Xsig_(1, i);
-        double v = Xsig_(2, i);
-        double yaw = Xsig_(3, i);
-        double yawd = Xsig_(4, i);
-        double nu_a = Xsig_(5, i);
-        double nu_yawdd = Xsig_(6, i);
-
-        //predicted state values
-        double px_p, py_p;
-
-        //avoid division by zero
-        if (fabs(yawd) > 0.001) {
-            px_p = p_x + v / yawd * (sin(yaw + yawd * delta_t) - sin(yaw));
-            py_p = p_y + v / yawd * (cos(yaw) - cos(yaw + yawd * delta_t));
-        } else {
-            px_p = p_x + v * delta_t * cos(yaw);
-            py_p = p_y + v * delta_t * sin(yaw);
-        }
-
-        double v_p = v;
-        double yaw_p = yaw + yawd * delta_t;
-        double yawd_p = yawd;
-
-        //add noise
-        px_p = px_p + 0.5 * nu_a * delta_t * delta_t * cos(yaw);
-        py_p = py_p + 0.5 * nu_a * delta_t * delta_t * sin(yaw);
-        v_p = v_p + nu_a * delta_t;
-
-        yaw_p = yaw_p + 0.5 * nu_yawdd * delta_t * delta_t;
-        yawd_p = yawd_p + nu_yawdd * delta_t;
-
-        //write predicted sigma point into right column
-        Xsig_pred_(0, i) = px_p;
-        Xsig_pred_(1, i) = py_p;
-        Xsig_pred_(2, i) = v_p;
-        Xsig_pred_(3, i) = yaw_p;
-        Xsig_pred_(4, i) = yawd_p;
-    }
+    ctrv::PredictSigmaPoints(Xsig_.data(), Xsig_pred_.data(), n_sig_, delta_t, use_fast_trig_);
 
     //predicted state mean
     x_.fill(0.0);
-    for (int i = 0; i < 2 * n_aug_ + 1; i++) {  //iterate over sigma points
+    for (int i = 0; i < n_sig_; i++) {  //iterate over sigma points
         x_ = x_ + weights_(i) * Xsig_pred_.col(i);
     }
 
     //predicted state covariance matrix
-    P_.fill(0.0);
-    for (int i = 0; i < 2 * n_aug_ + 1; i++) {  //iterate over sigma points
+    if (use_sqrt_) {
+        PredictSqrtCovariance();
+    } else {
+        P_.fill(0.0);
+        for (int i = 0; i < n_sig_; i++) {  //iterate over sigma points
 
-        // state difference
-        VectorXd x_diff = Xsig_pred_.col(i) - x_;
-        //angle normalization
-        while (x_diff(3) > M_PI) x_diff(3) -= 2. * M_PI;
-        while (x_diff(3) < -M_PI) x_diff(3) += 2. * M_PI;
+            // state difference
+            StateVector x_diff = Xsig_pred_.col(i) - x_;
+            //angle normalization
+            x_diff(3) = tools::NormalizeAngle(x_diff(3));
 
-        P_ = P_ + weights_(i) * x_diff * x_diff.transpose();
+            P_ = P_ + weights_(i) * x_diff * x_diff.transpose();
+        }
+    }
+
+    if (observer_ != NULL) {
+        observer_->AfterPrediction(*this);
     }
 }
 
@@ -262,121 +262,49 @@ void UKF::Prediction(double delta_t) {
  * Updates the state and the state covariance matrix using a laser measurement.
  * @param {MeasurementPackage} meas_package
  */
-void UKF::UpdateLidar(MeasurementPackage measurement_pack) {
-    VectorXd z = measurement_pack.raw_measurements_;
-
-    VectorXd z_pred = H_laser_ * x_;
-    VectorXd z_diff = z - z_pred;
-    MatrixXd Ht = H_laser_.transpose();
-    MatrixXd S = H_laser_ * P_ * Ht + R_laser_;
-    MatrixXd Si = S.inverse();
-    MatrixXd PHt = P_ * Ht;
-    MatrixXd K = PHt * Si;
-
-    //new estimate
-    x_ = x_ + (K * z_diff);
-    long x_size = x_.size();
-    MatrixXd I = MatrixXd::Identity(x_size, x_size);
-    P_ = (I - K * H_laser_) * P_;
-
-    NIS_laser_ = z_diff.transpose() * Si * z_diff;
+template<typename Scalar>
+void UKFT<Scalar>::UpdateLidar(const MeasurementPackage &measurement_pack) {
+    NIS_laser_ = Update(lidar_model_,
+                        measurement_pack.raw_measurements_.head<LidarModel::n_z>().template cast<Scalar>());
 }
 
 /**
  * Updates the state and the state covariance matrix using a radar measurement.
  * @param {MeasurementPackage} meas_package
  */
-void UKF::UpdateRadar(MeasurementPackage measurement_pack) {
-    //transform sigma points into measurement space
-    for (int i = 0; i < 2 * n_aug_ + 1; i++) {
-
-        // extract values for better readibility
-        double p_x = Xsig_pred_(0, i);
-        double p_y = Xsig_pred_(1, i);
-        double v = Xsig_pred_(2, i);
-        double yaw = Xsig_pred_(3, i);
-
-        double v_y = cos(yaw) * v;
-        double v_x = sin(yaw) * v;
-
-        // measurement model
-        double rho = sqrt(p_x * p_x + p_y * p_y);
-        double phi = atan2(p_y, p_x);
-        double rho_dot = (p_x * v_y + p_y * v_x) / rho;
-
-        if (rho != rho) {
-            rho = 0;
-        }
-        if (phi != phi) {
-            phi = 0;
-        }
-        if (rho_dot != rho_dot) {
-            rho_dot = 0;
-        }
-
-        Zsig_(0, i) = rho;
-        Zsig_(1, i) = phi;
-        Zsig_(2, i) = rho_dot;
-    }
-
-    //mean predicted measurement
-    VectorXd z_pred = VectorXd(n_z_radar_);
-    z_pred.fill(0.0);
-    for (int i = 0; i < 2 * n_aug_ + 1; i++) {
-        z_pred = z_pred + weights_(i) * Zsig_.col(i);
-    }
-
-    //measurement covariance matrix S
-    MatrixXd S = MatrixXd(n_z_radar_, n_z_radar_);
-    S.fill(0.0);
-    for (int i = 0; i < 2 * n_aug_ + 1; i++) {  //2n+1 simga points
-        //residual
-        VectorXd z_diff = Zsig_.col(i) - z_pred;
-
-        //angle normalization
-        while (z_diff(1) > M_PI) z_diff(1) -= 2. * M_PI;
-        while (z_diff(1) < -M_PI) z_diff(1) += 2. * M_PI;
+template<typename Scalar>
+void UKFT<Scalar>::UpdateRadar(const MeasurementPackage &measurement_pack) {
+    NIS_radar_ = Update(radar_model_,
+                        measurement_pack.raw_measurements_.head<RadarModel::n_z>().template cast<Scalar>());
+}
 
-        S = S + weights_(i) * z_diff * z_diff.transpose();
+/**
+ * Square-root mode: computes the factor of the predicted state covariance by
+ * a QR decomposition of the positively weighted deviations, followed by a
+ * rank-1 downdate for the negative weight of the center sigma point.
+ */
+template<typename Scalar>
+void UKFT<Scalar>::PredictSqrtCovariance() {
+    Eigen::Matrix<Scalar, n_sig_ - 1, n_x_> M;
+    StateVector x_diff0 = Xsig_pred_.col(0) - x_;
+    x_diff0(3) = tools::NormalizeAngle(x_diff0(3));
+    for (int i = 1; i < n_sig_; i++) {
+        StateVector x_diff = Xsig_pred_.col(i) - x_;
+        x_diff(3) = tools::NormalizeAngle(x_diff(3));
+        M.row(i - 1) = std::sqrt(weights_(i)) * x_diff.transpose();
     }
+    sqrt_P_ = cholesky::LowerFactorQR(M);
 
-    //add measurement noise covariance matrix
-    S = S + R_radar_;
-
-    //calculate cross correlation matrix
-    MatrixXd Tc = MatrixXd(n_x_, n_z_radar_);
-    Tc.fill(0.0);
-    for (int i = 0; i < 2 * n_aug_ + 1; i++) {  //2n+1 simga points
-
-        //residual
-        VectorXd z_diff = Zsig_.col(i) - z_pred;
-        //angle normalization
-        while (z_diff(1) > M_PI) z_diff(1) -= 2. * M_PI;
-        while (z_diff(1) < -M_PI) z_diff(1) += 2. * M_PI;
-
-        // state difference
-        VectorXd x_diff = Xsig_pred_.col(i) - x_;
-        //angle normalization
-        while (x_diff(3) > M_PI) x_diff(3) -= 2. * M_PI;
-        while (x_diff(3) < -M_PI) x_diff(3) += 2. * M_PI;
-
-        Tc = Tc + weights_(i) * x_diff * z_diff.transpose();
+    // if the downdate would make P indefinite the conservative factor
+    // without the center point is kept
+    StateMatrix L = sqrt_P_;
+    if (cholesky::RankUpdate(L, x_diff0, weights_(0))) {
+        sqrt_P_ = L;
     }
 
-    //Kalman gain K;
-    MatrixXd K = Tc * S.inverse();
-
-    //residual
-    VectorXd z = measurement_pack.raw_measurements_;
-    VectorXd z_diff = z - z_pred;
-
-    //angle normalization
-    while (z_diff(1) > M_PI) z_diff(1) -= 2. * M_PI;
-    while (z_diff(1) < -M_PI) z_diff(1) += 2. * M_PI;
+    P_ = sqrt_P_ * sqrt_P_.transpose();
+}
 
-    //update state mean and covariance matrix
-    x_ = x_ + K * z_diff;
-    P_ = P_ - K * S * K.transpose();
+template class UKFT<double>;
 
-    NIS_radar_ = z_diff.transpose() * S.inverse() * z_diff;
-}
+template class UKFT<float>;
@@ -1,125 +1,651 @@
 #ifndef UNSCENTED_KALMAN_FILTER_UKF_HPP
 #define UNSCENTED_KALMAN_FILTER_UKF_HPP
 
+#include <algorithm>
+#include <cmath>
 #include "lib/Eigen/Dense"
+#include "cholesky.hpp"
+#include "measurement_models.hpp"
 #include "measurement_package.hpp"
+#include "timing.hpp"
 #include "ground_truth_package.hpp"
+#include "tools.hpp"
 #include <vector>
 
-class UKF {
+/**
+ * Process and measurement noise of the UKF. std_laspx and std_laspy are
+ * variances like UKF::std_laspx_ and UKF::std_laspy_, which enter R directly.
+ */
+struct NoiseParameters {
+    ///* process noise longitudinal acceleration in m/s^2 and yaw acceleration in rad/s^2
+    double std_a;
+    double std_yawdd;
+    ///* laser noise position1 and position2
+    double std_laspx;
+    double std_laspy;
+    ///* radar noise radius in m, angle in rad and radius change in m/s
+    double std_radr;
+    double std_radphi;
+    double std_radrd;
+};
+
+/**
+ * How the gap to the next measurement is predicted, by UKFT and IMM alike
+ */
+namespace prediction {
+
+    ///* gaps up to this long in s are predicted in one step
+    const double kMaxStep = 0.1;
+
+    ///* longer gaps are split into equal steps of at most this length in s
+    const double kSubstep = 0.05;
+
+    ///* after a longer gap in us the state is stale, the filter restarts from the next measurement
+    const long kMaxGap = 30000000;
+
+    /**
+     * @param dt Gap in s
+     * @return The number of equal steps the gap is predicted in, at least 1
+     * and at most the steps of kMaxGap
+     */
+    inline int StepCount(double dt) {
+        if (!(dt > kMaxStep)) {
+            return 1;
+        }
+        const double max_steps = std::ceil(kMaxGap * 1e-6 / kSubstep);
+        return (int) std::min(std::ceil(dt / kSubstep), max_steps);
+    }
+
+    /**
+     * @return true if a measurement at timestamp is too long after the
+     * previous one in us to predict the state to it
+     */
+    inline bool IsStale(long previous_timestamp, long timestamp) {
+        return timestamp - previous_timestamp > kMaxGap;
+    }
+}
+
+template<typename Scalar_>
+class UKFT;
+
+/**
+ * Receives every prediction step of a UKFT, long gaps as several steps. The
+ * Smoother records the forward pass with it.
+ */
+template<typename Scalar>
+class PredictionObserverT {
+public:
+    virtual ~PredictionObserverT() {}
+
+    /**
+     * Called after the filter was initialized from a measurement, at the
+     * start or after a stale gap. The state does not follow from the last one.
+     */
+    virtual void AfterInitialize(const UKFT<Scalar> &ukf) = 0;
+
+    /**
+     * Called before a prediction step, x_ and P_ are the state it starts from
+     */
+    virtual void BeforePrediction(const UKFT<Scalar> &ukf) = 0;
+
+    /**
+     * Called after a prediction step: the top rows of Xsig_ are the sigma
+     * points of the state before the step, Xsig_pred_ their prediction and
+     * x_ and P_ the predicted state
+     */
+    virtual void AfterPrediction(const UKFT<Scalar> &ukf) = 0;
+};
+
+/**
+ * Unscented Kalman filter with the CTRV process model, templated on the
+ * scalar type. UKF is the double precision filter; UKFT<float> halves the
+ * memory traffic and doubles the SIMD width at the cost of accuracy, see the
+ * single precision section of the README.
+ */
+template<typename Scalar_>
+class UKFT {
 public:
+    typedef Scalar_ Scalar;
 
     ///* initially set to false, set to true in first call of ProcessMeasurement
     bool is_initialized_;
 
-    ///* state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
-    Eigen::VectorXd x_;
+    ///* if true the Cholesky factor sqrt_P_ is propagated instead of P_
+    bool use_sqrt_;
 
-    ///* state covariance matrix
-    Eigen::MatrixXd P_;
+    ///* if true the process and radar models use the trig::Fast approximations,
+    ///* in single precision only the radar model
+    bool use_fast_trig_;
 
-    ///* process noise
-    Eigen::MatrixXd Q_;
+    ///* if not NULL the prediction and update stages are timed into it
+    timing::StageStats *stats_;
+
+    ///* if not NULL it is called around every prediction step, see PredictionObserverT
+    PredictionObserverT<Scalar> *observer_;
+
+    ///* State dimension
+    static const int n_x_ = 5;
 
-    Eigen::MatrixXd H_laser_;
+    ///* Augmented state dimension
+    static const int n_aug_ = n_x_ + 2;
+
+    ///* Number of sigma points
+    static const int n_sig_ = 2 * n_aug_ + 1;
+
+    typedef Eigen::Matrix<Scalar, n_x_, 1> StateVector;
+    typedef Eigen::Matrix<Scalar, n_x_, n_x_> StateMatrix;
+    typedef Eigen::Matrix<Scalar, n_aug_, n_sig_, Eigen::RowMajor> AugSigmaMatrix;
+    typedef Eigen::Matrix<Scalar, n_x_, n_sig_, Eigen::RowMajor> SigmaMatrix;
+    typedef Eigen::Matrix<Scalar, n_sig_, 1> WeightVector;
+    typedef models::LidarModelT<Scalar> LidarModel;
+    typedef models::RadarModelT<Scalar> RadarModel;
+
+    ///* state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
+    StateVector x_;
 
-    Eigen::MatrixXd R_laser_;
+    ///* state covariance matrix
+    StateMatrix P_;
 
-    Eigen::MatrixXd R_radar_;
+    ///* lower Cholesky factor of P_, maintained in square-root mode
+    StateMatrix sqrt_P_;
 
-    ///* augumented state vector
-    Eigen::VectorXd x_aug;
+    ///* process noise
+    Eigen::Matrix<Scalar, 2, 2> Q_;
 
-    ///* augumented state covariance matrix
-    Eigen::MatrixXd P_aug;
+    ///* lower Cholesky factor of Q_
+    Eigen::Matrix<Scalar, 2, 2> sqrt_Q_;
 
-    ///* predicted sigma points matrix
-    Eigen::MatrixXd Xsig_pred_;
+    ///* measurement models with the noise of the sensors
+    LidarModel lidar_model_;
 
-    ///* Sigma points
-    Eigen::MatrixXd Xsig_;
+    RadarModel radar_model_;
 
-    Eigen::MatrixXd Zsig_;
+    ///* predicted sigma points matrix, row-major so each state component is contiguous
+    SigmaMatrix Xsig_pred_;
 
-    int n_z_radar_;
+    ///* augmented sigma points, the noise rows are kept by SetNoise
+    AugSigmaMatrix Xsig_;
 
     ///* previous_timestamp  in us
     long previous_timestamp_;
 
     ///* Process noise standard deviation longitudinal acceleration in m/s^2
-    double std_a_;
+    Scalar std_a_;
 
     ///* Process noise standard deviation yaw acceleration in rad/s^2
-    double std_yawdd_;
+    Scalar std_yawdd_;
 
     ///* Laser measurement noise standard deviation position1 in m
-    double std_laspx_;
+    Scalar std_laspx_;
 
     ///* Laser measurement noise standard deviation position2 in m
-    double std_laspy_;
+    Scalar std_laspy_;
 
     ///* Radar measurement noise standard deviation radius in m
-    double std_radr_;
+    Scalar std_radr_;
 
     ///* Radar measurement noise standard deviation angle in rad
-    double std_radphi_;
+    Scalar std_radphi_;
 
     ///* Radar measurement noise standard deviation radius change in m/s
-    double std_radrd_ ;
+    Scalar std_radrd_ ;
 
     ///* Weights of sigma points
-    Eigen::VectorXd weights_;
-
-    ///* State dimension
-    int n_x_;
-
-    ///* Augmented state dimension
-    int n_aug_;
+    WeightVector weights_;
 
     ///* Sigma point spreading parameter
-    double lambda_;
+    Scalar lambda_;
+
+    ///* sqrt(lambda_ + n_aug_), the scale of the sigma point offsets
+    Scalar sigma_scale_;
 
     ///* the current NIS for radar
-    double NIS_radar_;
+    Scalar NIS_radar_;
 
     ///* the current NIS for laser
-    double NIS_laser_;
+    Scalar NIS_laser_;
 
     /**
      * Constructor
      */
-    UKF();
+    UKFT();
 
     /**
      * Destructor
      */
-    virtual ~UKF();
+    virtual ~UKFT();
+
+    /**
+     * @return The covariance the state starts with before the first measurement
+     */
+    static StateMatrix InitialCovariance();
+
+    /**
+     * Forgets the state, the next measurement initializes the filter again
+     */
+    void Reset();
+
+    /**
+     * Sets the std_* members and recomputes the process noise Q_, its factor
+     * and the noise of the measurement models from them
+     */
+    void SetNoise(const NoiseParameters &noise);
+
+    /**
+     * @return The std_* members
+     */
+    NoiseParameters Noise() const;
 
     /**
      * ProcessMeasurement
      * @param meas_package The latest measurement data of either radar or laser
      * @param gt_package The ground truth of the state x at measurement time
      */
-    void ProcessMeasurement(MeasurementPackage measurement_pack);
+    void ProcessMeasurement(const MeasurementPackage &measurement_pack);
+
+    /**
+     * Processes a laser and a radar measurement with the same timestamp with
+     * one prediction and one stacked update. Sets the marginal NIS of both.
+     */
+    void ProcessJointMeasurement(const MeasurementPackage &laser_pack, const MeasurementPackage &radar_pack);
+
+    /**
+     * Initializes the filter with the first measurement of any model, later
+     * measurements are predicted to and updated with. A measurement more than
+     * prediction::kMaxGap after the previous one initializes it again.
+     * @param timestamp Time of the measurement in us
+     * @param stage Stage the update is timed as
+     * @return The NIS of the measurement, 0 for the first one
+     */
+    template<class Model>
+    Scalar ProcessMeasurement(const Model &model, long timestamp, const typename Model::Vector &z,
+                              timing::Stage stage);
+
+    /**
+     * Initializes the state from a measurement of any model, like the first
+     * ProcessMeasurement but without the log line
+     * @param timestamp Time of the measurement in us
+     */
+    template<class Model>
+    void Initialize(const Model &model, long timestamp, const typename Model::Vector &z);
+
+    /**
+     * Predicts the state to the given time, long gaps in several steps
+     * @param timestamp Time in us
+     */
+    void PredictTo(long timestamp);
 
     /**
      * Prediction Predicts sigma points, the state, and the state covariance
      * matrix
      * @param delta_t Time between k and k+1 in s
      */
-    void Prediction(double delta_t);
+    void Prediction(Scalar delta_t);
+
+    /**
+     * Updates the state and the state covariance matrix with a measurement of
+     * any model. Linear models use the Kalman update, all others the unscented
+     * transform of the predicted sigma points.
+     * @param z_diff_out If given, receives the residual
+     * @param S_out If given, receives the innovation covariance
+     * @return The NIS of the measurement
+     */
+    template<class Model>
+    Scalar Update(const Model &model, const typename Model::Vector &z,
+                  typename Model::Vector *z_diff_out = NULL, typename Model::Matrix *S_out = NULL);
+
+    /**
+     * Predicts a measurement of any model without updating, with the
+     * innovation covariance S that Update uses. Lets a caller gate
+     * measurements before associating them with the filter.
+     * @param z_pred Receives the predicted measurement
+     * @param S Receives the innovation covariance
+     */
+    template<class Model>
+    void PredictMeasurement(const Model &model, typename Model::Vector &z_pred, typename Model::Matrix &S) const;
+
+    /**
+     * Updates with two simultaneous measurements in one stacked update
+     * @param nis_a, nis_b Receive the marginal NIS of each measurement
+     */
+    template<class A, class B>
+    void UpdateJoint(const A &model_a, const typename A::Vector &z_a,
+                     const B &model_b, const typename B::Vector &z_b,
+                     Scalar &nis_a, Scalar &nis_b);
 
     /**
      * Updates the state and the state covariance matrix using a laser measurement
      * @param meas_package The measurement at k+1
      */
-    void UpdateLidar(MeasurementPackage measurement_pack);
+    void UpdateLidar(const MeasurementPackage &measurement_pack);
 
     /**
      * Updates the state and the state covariance matrix using a radar measurement
      * @param meas_package The measurement at k+1
      */
-    void UpdateRadar(MeasurementPackage measurement_pack);
+    void UpdateRadar(const MeasurementPackage &measurement_pack);
+
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+    /**
+     * Transforms the predicted sigma points into measurement space
+     * @param Zsig Receives the measurement sigma points
+     * @param z_pred Receives their weighted mean
+     */
+    template<class Model>
+    void MeasureSigmaPoints(const Model &model, Eigen::Matrix<Scalar, Model::n_z, n_sig_> &Zsig,
+                            typename Model::Vector &z_pred) const;
+
+    /**
+     * @return The innovation covariance of the measurement sigma points, including R
+     */
+    template<class Model>
+    typename Model::Matrix MeasurementCovariance(const Model &model, const Eigen::Matrix<Scalar, Model::n_z, n_sig_> &Zsig,
+                                                 const typename Model::Vector &z_pred) const;
+
+    /**
+     * Square-root mode: predicts sqrt_P_ from the predicted sigma points
+     */
+    void PredictSqrtCovariance();
+
+    /**
+     * Square-root mode: updates the state and sqrt_P_
+     * @return The NIS of the measurement
+     */
+    template<int n_z>
+    Scalar SqrtUpdate(const Eigen::Matrix<Scalar, n_z, 1> &z_diff,
+                      const Eigen::Matrix<Scalar, n_z, n_z> &sqrt_S,
+                      const Eigen::Matrix<Scalar, n_x_, n_z> &Tc);
 };
 
+typedef UKFT<double> UKF;
+
+template<typename Scalar>
+const int UKFT<Scalar>::n_x_;
+
+template<typename Scalar>
+const int UKFT<Scalar>::n_aug_;
+
+template<typename Scalar>
+const int UKFT<Scalar>::n_sig_;
+
+template<typename Scalar>
+template<class Model>
+Scalar UKFT<Scalar>::ProcessMeasurement(const Model &model, long timestamp, const typename Model::Vector &z,
+                                        timing::Stage stage) {
+    /*****************************************************************************
+     *  Initialization
+     ****************************************************************************/
+    if (is_initialized_ && prediction::IsStale(previous_timestamp_, timestamp)) {
+        Reset();
+    }
+    if (!is_initialized_) {
+        // first measurement
+        Initialize(model, timestamp, z);
+        return 0;
+    }
+
+    /*****************************************************************************
+     *  Prediction
+     ****************************************************************************/
+
+    PredictTo(timestamp);
+
+    /*****************************************************************************
+     *  Update
+     ****************************************************************************/
+
+    timing::ScopedTimer timer(stats_, stage);
+    return Update(model, z);
+}
+
+template<typename Scalar>
+template<class Model>
+void UKFT<Scalar>::Initialize(const Model &model, long timestamp, const typename Model::Vector &z) {
+    model.Initialize(z, x_, P_);
+    sqrt_P_ = P_.llt().matrixL();
+    previous_timestamp_ = timestamp;
+
+    is_initialized_ = true;
+
+    if (observer_ != NULL) {
+        observer_->AfterInitialize(*this);
+    }
+}
+
+template<typename Scalar>
+template<class Model>
+Scalar UKFT<Scalar>::Update(const Model &model, const typename Model::Vector &z,
+                            typename Model::Vector *z_diff_out, typename Model::Matrix *S_out) {
+    const int n_z = Model::n_z;
+    typedef typename Model::Vector ZVector;
+    typedef typename Model::Matrix ZMatrix;
+    typedef Eigen::Matrix<Scalar, n_x_, n_z> CrossMatrix;
+
+    if constexpr (Model::is_linear) {
+        ZVector z_pred = model.H * x_;
+        ZVector z_diff = z - z_pred;
+        Model::Normalize(z_diff);
+        if (z_diff_out != NULL) {
+            *z_diff_out = z_diff;
+        }
+
+        if (use_sqrt_) {
+            //innovation factor from the stacked [H * sqrt(P), sqrt(R)]
+            Eigen::Matrix<Scalar, n_x_ + n_z, n_z> M;
+            M.template topRows<n_x_>() = (model.H * sqrt_P_).transpose();
+            M.template bottomRows<n_z>() = model.sqrt_R.transpose();
+            ZMatrix sqrt_S = cholesky::LowerFactorQR(M);
+            if (S_out != NULL) {
+                *S_out = sqrt_S * sqrt_S.transpose();
+            }
+
+            return this->template SqrtUpdate<n_z>(z_diff, sqrt_S, P_ * model.H.transpose());
+        }
+
+        CrossMatrix Ht = model.H.transpose();
+        ZMatrix S = model.H * P_ * Ht + model.R;
+        if (S_out != NULL) {
+            *S_out = S;
+        }
+        ZMatrix Si = S.inverse();
+        CrossMatrix PHt = P_ * Ht;
+        CrossMatrix K = PHt * Si;
+
+        //new estimate
+        x_ = x_ + (K * z_diff);
+        P_ = (StateMatrix::Identity() - K * model.H) * P_;
+
+        return z_diff.transpose() * Si * z_diff;
+    } else {
+        //transform sigma points into measurement space
+        Eigen::Matrix<Scalar, n_z, n_sig_> Zsig;
+        ZVector z_pred;
+        MeasureSigmaPoints(model, Zsig, z_pred);
+
+        //calculate cross correlation matrix
+        CrossMatrix Tc;
+        Tc.fill(0.0);
+        for (int i = 0; i < n_sig_; i++) {  //2n+1 simga points
+
+            //residual
+            ZVector z_diff = Zsig.col(i) - z_pred;
+            //angle normalization
+            Model::Normalize(z_diff);
+
+            // state difference
+            StateVector x_diff = Xsig_pred_.col(i) - x_;
+            //angle normalization
+            x_diff(3) = tools::NormalizeAngle(x_diff(3));
+
+            Tc = Tc + weights_(i) * x_diff * z_diff.transpose();
+        }
+
+        //residual
+        ZVector z_diff = z - z_pred;
+
+        //angle normalization
+        Model::Normalize(z_diff);
+        if (z_diff_out != NULL) {
+            *z_diff_out = z_diff;
+        }
+
+        if (use_sqrt_) {
+            //innovation factor from the positively weighted residuals and sqrt(R),
+            //followed by a downdate for the negative center weight
+            Eigen::Matrix<Scalar, n_sig_ - 1 + n_z, n_z> M;
+            ZVector z_diff0 = Zsig.col(0) - z_pred;
+            Model::Normalize(z_diff0);
+            for (int i = 1; i < n_sig_; i++) {
+                ZVector z_diff_i = Zsig.col(i) - z_pred;
+                Model::Normalize(z_diff_i);
+                M.row(i - 1) = std::sqrt(weights_(i)) * z_diff_i.transpose();
+            }
+            M.template bottomRows<n_z>() = model.sqrt_R.transpose();
+            ZMatrix sqrt_S = cholesky::LowerFactorQR(M);
+            ZMatrix sqrt_S_down = sqrt_S;
+            if (cholesky::RankUpdate(sqrt_S_down, z_diff0, weights_(0))) {
+                sqrt_S = sqrt_S_down;
+            }
+            if (S_out != NULL) {
+                *S_out = sqrt_S * sqrt_S.transpose();
+            }
+
+            return this->template SqrtUpdate<n_z>(z_diff, sqrt_S, Tc);
+        }
+
+        //measurement covariance matrix S
+        ZMatrix S = MeasurementCovariance(model, Zsig, z_pred);
+        if (S_out != NULL) {
+            *S_out = S;
+        }
+
+        //Kalman gain K;
+        ZMatrix Si = S.inverse();
+        CrossMatrix K = Tc * Si;
+
+        //update state mean and covariance matrix
+        x_ = x_ + K * z_diff;
+        P_ = P_ - K * S * K.transpose();
+
+        return z_diff.transpose() * Si * z_diff;
+    }
+}
+
+template<typename Scalar>
+template<class Model>
+void UKFT<Scalar>::PredictMeasurement(const Model &model, typename Model::Vector &z_pred,
+                                      typename Model::Matrix &S) const {
+    if constexpr (Model::is_linear) {
+        z_pred = model.H * x_;
+        S = model.H * P_ * model.H.transpose() + model.R;
+    } else {
+        Eigen::Matrix<Scalar, Model::n_z, n_sig_> Zsig;
+        MeasureSigmaPoints(model, Zsig, z_pred);
+        S = MeasurementCovariance(model, Zsig, z_pred);
+    }
+}
+
+template<typename Scalar>
+template<class Model>
+void UKFT<Scalar>::MeasureSigmaPoints(const Model &model, Eigen::Matrix<Scalar, Model::n_z, n_sig_> &Zsig,
+                                      typename Model::Vector &z_pred) const {
+    for (int i = 0; i < n_sig_; i++) {
+        if (use_fast_trig_) {
+            Zsig.col(i) = model.template Measure<trig::Fast>(Xsig_pred_.col(i));
+        } else {
+            Zsig.col(i) = model.template Measure<trig::Exact>(Xsig_pred_.col(i));
+        }
+    }
+
+    //mean predicted measurement
+    z_pred.fill(0.0);
+    for (int i = 0; i < n_sig_; i++) {
+        z_pred = z_pred + weights_(i) * Zsig.col(i);
+    }
+}
+
+template<typename Scalar>
+template<class Model>
+typename Model::Matrix UKFT<Scalar>::MeasurementCovariance(const Model &model,
+                                                           const Eigen::Matrix<Scalar, Model::n_z, n_sig_> &Zsig,
+                                                           const typename Model::Vector &z_pred) const {
+    typename Model::Matrix S;
+    S.fill(0.0);
+    for (int i = 0; i < n_sig_; i++) {  //2n+1 simga points
+        //residual
+        typename Model::Vector z_diff = Zsig.col(i) - z_pred;
+
+        //angle normalization
+        Model::Normalize(z_diff);
+
+        S = S + weights_(i) * z_diff * z_diff.transpose();
+    }
+
+    //add measurement noise covariance matrix
+    return S + model.R;
+}
+
+template<typename Scalar>
+template<class A, class B>
+void UKFT<Scalar>::UpdateJoint(const A &model_a, const typename A::Vector &z_a,
+                               const B &model_b, const typename B::Vector &z_b,
+                               Scalar &nis_a, Scalar &nis_b) {
+    typedef models::StackedModel<A, B> Stacked;
+    Stacked model(model_a, model_b);
+    typename Stacked::Vector z;
+    z << z_a, z_b;
+
+    typename Stacked::Vector z_diff;
+    typename Stacked::Matrix S;
+    Update(model, z, &z_diff, &S);
+
+    //marginal NIS of each measurement against its block of S
+    typename A::Vector z_diff_a = z_diff.template head<A::n_z>();
+    typename B::Vector z_diff_b = z_diff.template tail<B::n_z>();
+    typename A::Matrix S_a = S.template topLeftCorner<A::n_z, A::n_z>();
+    typename B::Matrix S_b = S.template bottomRightCorner<B::n_z, B::n_z>();
+    nis_a = z_diff_a.transpose() * S_a.inverse() * z_diff_a;
+    nis_b = z_diff_b.transpose() * S_b.inverse() * z_diff_b;
+}
+
+/**
+ * Square-root mode: applies a measurement update given the residual, the
+ * lower factor of the innovation covariance S and the cross correlation Tc.
+ * @return The NIS of the measurement
+ */
+template<typename Scalar>
+template<int n_z>
+Scalar UKFT<Scalar>::SqrtUpdate(const Eigen::Matrix<Scalar, n_z, 1> &z_diff,
+                                const Eigen::Matrix<Scalar, n_z, n_z> &sqrt_S,
+                                const Eigen::Matrix<Scalar, n_x_, n_z> &Tc) {
+    //U = Tc * sqrt(S)^-T and K = U * sqrt(S)^-1, so that K * S * K^T = U * U^T
+    Eigen::Matrix<Scalar, n_z, n_x_> Ut = sqrt_S.template triangularView<Eigen::Lower>().solve(Tc.transpose());
+    Eigen::Matrix<Scalar, n_z, n_x_> Kt = sqrt_S.transpose().template triangularView<Eigen::Upper>().solve(Ut);
+
+    x_ = x_ + Kt.transpose() * z_diff;
+
+    //P = P - U * U^T as n_z rank-1 downdates
+    StateMatrix L = sqrt_P_;
+    bool downdated = true;
+    for (int j = 0; j < n_z && downdated; j++) {
+        downdated = cholesky::RankUpdate(L, StateVector(Ut.row(j).transpose()), Scalar(-1));
+    }
+    if (downdated) {
+        sqrt_P_ = L;
+    } else {
+        // fall back to a full factorization, keep the prior if even that fails
+        StateMatrix P = sqrt_P_ * sqrt_P_.transpose() - Ut.transpose() * Ut;
+        Eigen::LLT<StateMatrix> llt(P);
+        if (llt.info() == Eigen::Success) {
+            sqrt_P_ = llt.matrixL();
+        }
+    }
+    P_ = sqrt_P_ * sqrt_P_.transpose();
+
+    return sqrt_S.template triangularView<Eigen::Lower>().solve(z_diff).squaredNorm();
+}
+
 #endif //UNSCENTED_KALMAN_FILTER_UKF_HPP
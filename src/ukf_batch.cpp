@@ -0,0 +1,538 @@
+#include <algorithm>
+#include <cmath>
+#include "ukf_batch.hpp"
+#include "tools.hpp"
+#include "ctrv_kernel.hpp"
+#include "fast_trig.hpp"
+
+namespace {
+    /**
+     * Computes atan2 of n value pairs
+     */
+    template<class Trig>
+    void atan2s(const double *y, const double *x, double *out, int n) {
+        for (int t = 0; t < n; t++) {
+            out[t] = Trig::Atan2(y[t], x[t]);
+        }
+    }
+}
+
+const int UKFBatch::n_x_;
+const int UKFBatch::n_aug_;
+const int UKFBatch::n_sig_;
+const int UKFBatch::n_z_radar_;
+
+/**
+ * Initializes all tracks with a zero state and the initial covariance of the
+ * prototype filter.
+ */
+UKFBatch::UKFBatch(int n_tracks, const UKF &prototype) {
+    n_tracks_ = n_tracks;
+    Configure(prototype);
+
+    x_ = TrackMatrix::Zero(n_tracks, n_x_);
+    P_ = TrackMatrix(n_tracks, n_x_ * n_x_);
+    for (int r = 0; r < n_x_; r++) {
+        for (int c = 0; c < n_x_; c++) {
+            P(r, c).setConstant(prototype.P_(r, c));
+        }
+    }
+    Xsig_pred_ = TrackMatrix::Zero(n_tracks, n_x_ * n_sig_);
+
+    NIS_radar_ = TrackArray::Zero(n_tracks);
+    NIS_laser_ = TrackArray::Zero(n_tracks);
+
+    AllocateBuffers();
+}
+
+UKFBatch::~UKFBatch() {}
+
+void UKFBatch::Configure(const UKF &prototype) {
+    std_a_ = prototype.std_a_;
+    std_yawdd_ = prototype.std_yawdd_;
+    R_laser_ = prototype.lidar_model_.R;
+    R_radar_ = prototype.radar_model_.R;
+    lambda_ = prototype.lambda_;
+    weights_ = prototype.weights_;
+    use_fast_trig_ = prototype.use_fast_trig_;
+    radar_moments_ = false;
+}
+
+void UKFBatch::AllocateBuffers() {
+    L_ = TrackMatrix::Zero(n_tracks_, n_x_ * n_x_);
+    sig_ = TrackMatrix(n_tracks_, n_aug_);
+    trig_ = TrackMatrix(n_tracks_, 4);
+    Zsig_ = TrackMatrix(n_tracks_, n_z_radar_ * n_sig_);
+    diff_ = TrackMatrix(n_tracks_, n_x_ + n_z_radar_);
+    S_ = TrackMatrix(n_tracks_, 3);
+    S_radar_ = TrackMatrix(n_tracks_, n_z_radar_ * n_z_radar_);
+    Si_ = TrackMatrix(n_tracks_, n_z_radar_ * n_z_radar_);
+    Tc_ = TrackMatrix(n_tracks_, n_x_ * n_z_radar_);
+    K_ = TrackMatrix(n_tracks_, n_x_ * n_z_radar_);
+    z_pred_ = TrackMatrix(n_tracks_, n_z_radar_);
+    z_diff_ = TrackMatrix(n_tracks_, n_z_radar_);
+    nis_ = TrackArray(n_tracks_);
+    step_ = TrackArray(n_tracks_);
+    factored_ = TrackArray(n_tracks_);
+    steps_ = Eigen::ArrayXi(n_tracks_);
+}
+
+void UKFBatch::Resize(int n_tracks) {
+    if (n_tracks == n_tracks_) {
+        return;
+    }
+    int added = n_tracks - n_tracks_;
+    x_.conservativeResize(n_tracks, Eigen::NoChange);
+    P_.conservativeResize(n_tracks, Eigen::NoChange);
+    Xsig_pred_.conservativeResize(n_tracks, Eigen::NoChange);
+    NIS_radar_.conservativeResize(n_tracks);
+    NIS_laser_.conservativeResize(n_tracks);
+    if (added > 0) {
+        x_.bottomRows(added).setZero();
+        P_.bottomRows(added).setZero();
+        Xsig_pred_.bottomRows(added).setZero();
+        NIS_radar_.tail(added).setZero();
+        NIS_laser_.tail(added).setZero();
+    }
+    n_tracks_ = n_tracks;
+    AllocateBuffers();
+    radar_moments_ = false;
+}
+
+void UKFBatch::CopyTrack(int from, int to) {
+    x_.row(to) = x_.row(from);
+    P_.row(to) = P_.row(from);
+    Xsig_pred_.row(to) = Xsig_pred_.row(from);
+    NIS_radar_(to) = NIS_radar_(from);
+    NIS_laser_(to) = NIS_laser_(from);
+    radar_moments_ = false;
+}
+
+void UKFBatch::SetTrack(int track, const UKF::StateVector &x, const UKF::StateMatrix &P) {
+    for (int r = 0; r < n_x_; r++) {
+        x_(track, r) = x(r);
+        for (int c = 0; c < n_x_; c++) {
+            P_(track, r + c * n_x_) = P(r, c);
+        }
+    }
+}
+
+UKF::StateVector UKFBatch::State(int track) const {
+    UKF::StateVector x;
+    for (int r = 0; r < n_x_; r++) {
+        x(r) = x_(track, r);
+    }
+    return x;
+}
+
+UKF::StateMatrix UKFBatch::Covariance(int track) const {
+    UKF::StateMatrix P;
+    for (int r = 0; r < n_x_; r++) {
+        for (int c = 0; c < n_x_; c++) {
+            P(r, c) = P_(track, r + c * n_x_);
+        }
+    }
+    return P;
+}
+
+void UKFBatch::MirrorCovariance() {
+    for (int r = 0; r < n_x_; r++) {
+        for (int c = r + 1; c < n_x_; c++) {
+            P(r, c) = P(c, r);
+        }
+    }
+}
+
+void UKFBatch::NormalizeAngles(TrackMatrix::ColXpr angles) {
+    double *a = angles.data();
+    for (int t = 0; t < n_tracks_; t++) {
+        a[t] = tools::NormalizeAngle(a[t]);
+    }
+}
+
+/**
+ * Splits the gap of every track into the steps of prediction::StepCount.
+ * Tracks that take fewer steps than others keep the state of their last step.
+ */
+void UKFBatch::Prediction(const TrackArray &delta_t) {
+    int max_steps = 1;
+    bool uniform = true;
+    for (int t = 0; t < n_tracks_; t++) {
+        steps_(t) = prediction::StepCount(delta_t(t));
+        step_(t) = delta_t(t) / steps_(t);
+        uniform = uniform && steps_(t) == steps_(0);
+        max_steps = std::max(max_steps, steps_(t));
+    }
+
+    if (uniform) {
+        for (int i = 0; i < max_steps; i++) {
+            Step(step_);
+        }
+        return;
+    }
+
+    for (int i = 0; i < max_steps; i++) {
+        x_before_ = x_;
+        P_before_ = P_;
+        Xsig_pred_before_ = Xsig_pred_;
+        Step(step_);
+        for (int t = 0; t < n_tracks_; t++) {
+            if (i >= steps_(t)) {
+                x_.row(t) = x_before_.row(t);
+                P_.row(t) = P_before_.row(t);
+                Xsig_pred_.row(t) = Xsig_pred_before_.row(t);
+            }
+        }
+    }
+}
+
+/**
+ * Predicts sigma points, the state, and the state covariance of every track.
+ * The augmented covariance is block diagonal, so its square root is the
+ * Cholesky factor of P next to the constant noise standard deviations.
+ */
+void UKFBatch::Step(const TrackArray &delta_t) {
+    radar_moments_ = false;
+
+    //calculate square root of P, column by column. Like Eigen's LLT in UKF,
+    //the factorization of a track stops at the first pivot that is not
+    //positive and leaves the remaining columns as they are in P.
+    factored_.setOnes();
+    for (int j = 0; j < n_x_; j++) {
+        L(j, j) = P(j, j);
+        for (int k = 0; k < j; k++) {
+            L(j, j) -= L(j, k).square();
+        }
+        factored_ = (L(j, j) <= 0).select(0.0, factored_);
+        L(j, j) = (factored_ > 0).select(L(j, j).sqrt(), P(j, j));
+
+        for (int i = j + 1; i < n_x_; i++) {
+            L(i, j) = P(i, j);
+            for (int k = 0; k < j; k++) {
+                L(i, j) -= L(i, k) * L(j, k);
+            }
+            L(i, j) = (factored_ > 0).select(L(i, j) / L(j, j), P(i, j));
+        }
+    }
+
+    const double scale = sqrt(lambda_ + n_aug_);
+
+    //predict sigma points
+    for (int i = 0; i < n_sig_; i++) {
+        //create augmented sigma point i of every track
+        sig_.leftCols(n_x_) = x_;
+        sig_.rightCols(n_aug_ - n_x_).setZero();
+
+        if (i > 0) {
+            int j = (i - 1) % n_aug_;
+            double sign = i <= n_aug_ ? scale : -scale;
+            if (j < n_x_) {
+                for (int k = j; k < n_x_; k++) {
+                    sig_.col(k) += sign * L(k, j);
+                }
+            } else if (j == n_x_) {
+                sig_.col(j).setConstant(sign * std_a_);
+            } else {
+                sig_.col(j).setConstant(sign * std_yawdd_);
+            }
+        }
+
+        TrackMatrix::ColXpr p_x = sig_.col(0);
+        TrackMatrix::ColXpr p_y = sig_.col(1);
+        TrackMatrix::ColXpr v = sig_.col(2);
+        TrackMatrix::ColXpr yaw = sig_.col(3);
+        TrackMatrix::ColXpr yawd = sig_.col(4);
+        TrackMatrix::ColXpr nu_a = sig_.col(5);
+        TrackMatrix::ColXpr nu_yawdd = sig_.col(6);
+
+        TrackMatrix::ColXpr sin_yaw = trig_.col(0);
+        TrackMatrix::ColXpr cos_yaw = trig_.col(1);
+        TrackMatrix::ColXpr sin_yaw_p = trig_.col(2);
+        TrackMatrix::ColXpr cos_yaw_p = trig_.col(3);
+
+        //predicted yaw without noise, needed for the turning case
+        Xp(3, i) = yaw + yawd * delta_t;
+
+        if (use_fast_trig_) {
+            ctrv::SinCosFast(yaw.data(), sin_yaw.data(), cos_yaw.data(), n_tracks_);
+            ctrv::SinCosFast(Xp(3, i).data(), sin_yaw_p.data(), cos_yaw_p.data(), n_tracks_);
+        } else {
+            ctrv::SinCos(yaw.data(), sin_yaw.data(), cos_yaw.data(), n_tracks_);
+            ctrv::SinCos(Xp(3, i).data(), sin_yaw_p.data(), cos_yaw_p.data(), n_tracks_);
+        }
+
+        //avoid division by zero, both branches are evaluated for all tracks
+        Xp(0, i) = (yawd.abs() > 0.001).select(
+                p_x + v / yawd * (sin_yaw_p - sin_yaw),
+                p_x + v * delta_t * cos_yaw);
+        Xp(1, i) = (yawd.abs() > 0.001).select(
+                p_y + v / yawd * (cos_yaw - cos_yaw_p),
+                p_y + v * delta_t * sin_yaw);
+
+        //add noise
+        Xp(0, i) += 0.5 * nu_a * delta_t * delta_t * cos_yaw;
+        Xp(1, i) += 0.5 * nu_a * delta_t * delta_t * sin_yaw;
+        Xp(2, i) = v + nu_a * delta_t;
+        Xp(3, i) += 0.5 * nu_yawdd * delta_t * delta_t;
+        Xp(4, i) = yawd + nu_yawdd * delta_t;
+    }
+
+    //predicted state mean
+    x_.setZero();
+    for (int i = 0; i < n_sig_; i++) {
+        for (int k = 0; k < n_x_; k++) {
+            x_.col(k) += weights_(i) * Xp(k, i);
+        }
+    }
+
+    //predicted state covariance matrix, lower triangle
+    P_.setZero();
+    for (int i = 0; i < n_sig_; i++) {
+        // state difference
+        for (int k = 0; k < n_x_; k++) {
+            diff_.col(k) = Xp(k, i) - x_.col(k);
+        }
+        NormalizeAngles(diff_.col(3));
+
+        for (int r = 0; r < n_x_; r++) {
+            for (int c = 0; c <= r; c++) {
+                P(r, c) += weights_(i) * diff_.col(r) * diff_.col(c);
+            }
+        }
+    }
+    MirrorCovariance();
+}
+
+void UKFBatch::PredictLidar(TrackMatrix &z_pred, TrackMatrix &S) const {
+    z_pred = x_.leftCols(2);
+    S.resize(n_tracks_, 4);
+    for (int a = 0; a < 2; a++) {
+        for (int b = 0; b < 2; b++) {
+            S.col(a + b * 2) = P_.col(a + b * n_x_) + R_laser_(a, b);
+        }
+    }
+}
+
+/**
+ * Updates every active track with a laser measurement. The measurement model
+ * is linear, so this is the standard Kalman filter update with the 2x2
+ * innovation covariance inverted in closed form.
+ */
+void UKFBatch::UpdateLidar(const TrackMatrix &z, const TrackArray &active) {
+    //S = H * P * H^T + R, stored in S_ as (0,0), (0,1), (1,1)
+    S_.col(0) = P(0, 0) + R_laser_(0, 0);
+    S_.col(1) = P(0, 1) + R_laser_(0, 1);
+    S_.col(2) = P(1, 1) + R_laser_(1, 1);
+
+    nis_ = S_.col(0) * S_.col(2) - S_.col(1) * S_.col(1);
+    Si_.col(0) = S_.col(2) / nis_;
+    Si_.col(1) = -S_.col(1) / nis_;
+    Si_.col(2) = S_.col(0) / nis_;
+
+    //Kalman gain K = P * H^T * S^-1, column r + a * n_x
+    for (int r = 0; r < n_x_; r++) {
+        K_.col(r) = P(r, 0) * Si_.col(0) + P(r, 1) * Si_.col(1);
+        K_.col(r + n_x_) = P(r, 0) * Si_.col(1) + P(r, 1) * Si_.col(2);
+    }
+
+    //residual
+    z_diff_.col(0) = z.col(0) - x_.col(0);
+    z_diff_.col(1) = z.col(1) - x_.col(1);
+
+    //P = (I - K * H) * P, written to L_ first since it reads rows 0 and 1 of P.
+    //Inactive tracks are selected out rather than multiplied by 0, their
+    //gain may not be finite.
+    for (int r = 0; r < n_x_; r++) {
+        for (int c = 0; c <= r; c++) {
+            L(r, c) = P(r, c) - (K_.col(r) * P(0, c) + K_.col(r + n_x_) * P(1, c));
+        }
+    }
+    for (int r = 0; r < n_x_; r++) {
+        for (int c = 0; c <= r; c++) {
+            P(r, c) = (active > 0).select(L(r, c), P(r, c));
+        }
+    }
+    MirrorCovariance();
+
+    //new estimate
+    for (int r = 0; r < n_x_; r++) {
+        x_.col(r) = (active > 0).select(x_.col(r) + K_.col(r) * z_diff_.col(0) + K_.col(r + n_x_) * z_diff_.col(1),
+                                        x_.col(r));
+    }
+
+    nis_ = z_diff_.col(0).square() * Si_.col(0)
+           + 2 * z_diff_.col(0) * z_diff_.col(1) * Si_.col(1)
+           + z_diff_.col(1).square() * Si_.col(2);
+    NIS_laser_ = (active > 0).select(nis_, NIS_laser_);
+}
+
+/**
+ * Transforms the predicted sigma point i of every track into radar space
+ */
+void UKFBatch::MeasureRadar(int i) {
+    TrackMatrix::ColXpr p_x = Xp(0, i);
+    TrackMatrix::ColXpr p_y = Xp(1, i);
+    TrackMatrix::ColXpr v = Xp(2, i);
+    TrackMatrix::ColXpr yaw = Xp(3, i);
+    TrackMatrix::ColXpr rho = Zsig_.col(i * n_z_radar_);
+    TrackMatrix::ColXpr phi = Zsig_.col(1 + i * n_z_radar_);
+    TrackMatrix::ColXpr rho_dot = Zsig_.col(2 + i * n_z_radar_);
+    TrackMatrix::ColXpr sin_yaw = trig_.col(0);
+    TrackMatrix::ColXpr cos_yaw = trig_.col(1);
+
+    if (use_fast_trig_) {
+        ctrv::SinCosFast(yaw.data(), sin_yaw.data(), cos_yaw.data(), n_tracks_);
+        atan2s<trig::Fast>(p_y.data(), p_x.data(), phi.data(), n_tracks_);
+    } else {
+        ctrv::SinCos(yaw.data(), sin_yaw.data(), cos_yaw.data(), n_tracks_);
+        atan2s<trig::Exact>(p_y.data(), p_x.data(), phi.data(), n_tracks_);
+    }
+
+    rho = (p_x * p_x + p_y * p_y).sqrt();
+    rho_dot = (p_x * (cos_yaw * v) + p_y * (sin_yaw * v)) / rho;
+
+    //NaN, from a track at the radar, is the only value unequal to itself
+    rho = (rho == rho).select(rho, 0.0);
+    phi = (phi == phi).select(phi, 0.0);
+    rho_dot = (rho_dot == rho_dot).select(rho_dot, 0.0);
+}
+
+void UKFBatch::PredictRadarMoments() {
+    if (radar_moments_) {
+        return;
+    }
+    //transform sigma points into measurement space
+    for (int i = 0; i < n_sig_; i++) {
+        MeasureRadar(i);
+    }
+
+    //mean predicted measurement
+    z_pred_.setZero();
+    for (int i = 0; i < n_sig_; i++) {
+        for (int a = 0; a < n_z_radar_; a++) {
+            z_pred_.col(a) += weights_(i) * Zsig_.col(a + i * n_z_radar_);
+        }
+    }
+
+    //measurement covariance S, lower triangle
+    S_radar_.setZero();
+    for (int i = 0; i < n_sig_; i++) {
+        for (int a = 0; a < n_z_radar_; a++) {
+            diff_.col(n_x_ + a) = Zsig_.col(a + i * n_z_radar_) - z_pred_.col(a);
+        }
+        NormalizeAngles(diff_.col(n_x_ + 1));
+
+        for (int a = 0; a < n_z_radar_; a++) {
+            for (int b = 0; b <= a; b++) {
+                S_radar_.col(a + b * n_z_radar_) += weights_(i) * diff_.col(n_x_ + a) * diff_.col(n_x_ + b);
+            }
+        }
+    }
+
+    //add measurement noise covariance matrix
+    for (int a = 0; a < n_z_radar_; a++) {
+        for (int b = 0; b <= a; b++) {
+            S_radar_.col(a + b * n_z_radar_) += R_radar_(a, b);
+        }
+    }
+    radar_moments_ = true;
+}
+
+void UKFBatch::PredictRadar(TrackMatrix &z_pred, TrackMatrix &S) {
+    PredictRadarMoments();
+    z_pred = z_pred_;
+    S.resize(n_tracks_, n_z_radar_ * n_z_radar_);
+    for (int a = 0; a < n_z_radar_; a++) {
+        for (int b = 0; b < n_z_radar_; b++) {
+            S.col(a + b * n_z_radar_) = S_radar_.col(std::max(a, b) + std::min(a, b) * n_z_radar_);
+        }
+    }
+}
+
+/**
+ * Updates every active track with a radar measurement. The 3x3 innovation
+ * covariance is symmetric and inverted in closed form.
+ */
+void UKFBatch::UpdateRadar(const TrackMatrix &z, const TrackArray &active) {
+    PredictRadarMoments();
+
+    //cross correlation Tc
+    Tc_.setZero();
+    for (int i = 0; i < n_sig_; i++) {
+        for (int k = 0; k < n_x_; k++) {
+            diff_.col(k) = Xp(k, i) - x_.col(k);
+        }
+        for (int a = 0; a < n_z_radar_; a++) {
+            diff_.col(n_x_ + a) = Zsig_.col(a + i * n_z_radar_) - z_pred_.col(a);
+        }
+        NormalizeAngles(diff_.col(3));
+        NormalizeAngles(diff_.col(n_x_ + 1));
+
+        for (int a = 0; a < n_z_radar_; a++) {
+            for (int r = 0; r < n_x_; r++) {
+                Tc_.col(r + a * n_x_) += weights_(i) * diff_.col(r) * diff_.col(n_x_ + a);
+            }
+        }
+    }
+
+    //S^-1 from the cofactors of the symmetric S
+    TrackMatrix::ColXpr s00 = S_radar_.col(0), s10 = S_radar_.col(1), s20 = S_radar_.col(2);
+    TrackMatrix::ColXpr s11 = S_radar_.col(4), s21 = S_radar_.col(5), s22 = S_radar_.col(8);
+    Si_.col(0) = s11 * s22 - s21 * s21;
+    Si_.col(1) = s20 * s21 - s10 * s22;
+    Si_.col(2) = s10 * s21 - s20 * s11;
+    Si_.col(4) = s00 * s22 - s20 * s20;
+    Si_.col(5) = s10 * s20 - s00 * s21;
+    Si_.col(8) = s00 * s11 - s10 * s10;
+    nis_ = s00 * Si_.col(0) + s10 * Si_.col(1) + s20 * Si_.col(2);
+    for (int a = 0; a < n_z_radar_; a++) {
+        for (int b = 0; b <= a; b++) {
+            Si_.col(a + b * n_z_radar_) /= nis_;
+            Si_.col(b + a * n_z_radar_) = Si_.col(a + b * n_z_radar_);
+        }
+    }
+
+    //Kalman gain K = Tc * S^-1
+    for (int r = 0; r < n_x_; r++) {
+        for (int a = 0; a < n_z_radar_; a++) {
+            K_.col(r + a * n_x_) = Tc_.col(r) * Si_.col(a * n_z_radar_)
+                                   + Tc_.col(r + n_x_) * Si_.col(1 + a * n_z_radar_)
+                                   + Tc_.col(r + 2 * n_x_) * Si_.col(2 + a * n_z_radar_);
+        }
+    }
+
+    //residual
+    for (int a = 0; a < n_z_radar_; a++) {
+        z_diff_.col(a) = z.col(a) - z_pred_.col(a);
+    }
+    NormalizeAngles(z_diff_.col(1));
+
+    //P = P - K * S * K^T = P - K * Tc^T, inactive tracks are selected out
+    for (int r = 0; r < n_x_; r++) {
+        for (int c = 0; c <= r; c++) {
+            L(r, c) = P(r, c);
+            for (int a = 0; a < n_z_radar_; a++) {
+                L(r, c) -= K_.col(r + a * n_x_) * Tc_.col(c + a * n_x_);
+            }
+            P(r, c) = (active > 0).select(L(r, c), P(r, c));
+        }
+    }
+    MirrorCovariance();
+
+    //update state mean
+    for (int r = 0; r < n_x_; r++) {
+        diff_.col(r) = x_.col(r);
+        for (int a = 0; a < n_z_radar_; a++) {
+            diff_.col(r) += K_.col(r + a * n_x_) * z_diff_.col(a);
+        }
+        x_.col(r) = (active > 0).select(diff_.col(r), x_.col(r));
+    }
+
+    nis_.setZero();
+    for (int a = 0; a < n_z_radar_; a++) {
+        for (int b = 0; b < n_z_radar_; b++) {
+            nis_ += z_diff_.col(a) * Si_.col(a + b * n_z_radar_) * z_diff_.col(b);
+        }
+    }
+    NIS_radar_ = (active > 0).select(nis_, NIS_radar_);
+}
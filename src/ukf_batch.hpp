@@ -0,0 +1,217 @@
+#ifndef UNSCENTED_KALMAN_FILTER_UKF_BATCH_HPP
+#define UNSCENTED_KALMAN_FILTER_UKF_BATCH_HPP
+
+#include "lib/Eigen/Dense"
+#include "ukf.hpp"
+
+/**
+ * Runs the CTRV unscented Kalman filter of UKF for many tracks at once.
+ *
+ * All per-track quantities are stored as structure of arrays: every scalar
+ * of the state, the covariance and the predicted sigma points is a column of
+ * n_tracks_ contiguous values. Each filter step is then a sequence of array
+ * operations across the track dimension, which Eigen vectorizes.
+ *
+ * The steps follow UKF: long gaps are predicted in the equal steps of
+ * prediction::StepCount, and the updates are those of the standard form,
+ * use_sqrt_ does not apply. Restarting a stale track is up to the caller.
+ */
+class UKFBatch {
+public:
+    typedef Eigen::ArrayXd TrackArray;
+    typedef Eigen::ArrayXXd TrackMatrix;
+
+    ///* number of tracks
+    int n_tracks_;
+
+    ///* state, column k holds component k of every track
+    TrackMatrix x_;
+
+    ///* state covariance, column r + c * n_x holds entry (r, c) of every track
+    TrackMatrix P_;
+
+    ///* predicted sigma points, column k + i * n_x holds component k of sigma point i
+    TrackMatrix Xsig_pred_;
+
+    ///* the current NIS for radar of every track
+    TrackArray NIS_radar_;
+
+    ///* the current NIS for laser of every track
+    TrackArray NIS_laser_;
+
+    /**
+     * Constructor
+     * @param n_tracks Number of tracks in the batch
+     * @param prototype Filter whose noise parameters and initial covariance
+     * are used for every track
+     */
+    UKFBatch(int n_tracks, const UKF &prototype = UKF());
+
+    /**
+     * Destructor
+     */
+    virtual ~UKFBatch();
+
+    /**
+     * Takes the noise parameters, the sigma point weights and the trig mode
+     * of a filter for all tracks
+     */
+    void Configure(const UKF &prototype);
+
+    /**
+     * Changes the number of tracks, the first ones are kept. New tracks have
+     * a zero state and covariance until SetTrack.
+     */
+    void Resize(int n_tracks);
+
+    /**
+     * Overwrites track to with track from
+     */
+    void CopyTrack(int from, int to);
+
+    /**
+     * Overwrites the state and covariance of a single track
+     */
+    void SetTrack(int track, const UKF::StateVector &x, const UKF::StateMatrix &P);
+
+    /**
+     * @return The state of a single track
+     */
+    UKF::StateVector State(int track) const;
+
+    /**
+     * @return The state covariance of a single track
+     */
+    UKF::StateMatrix Covariance(int track) const;
+
+    /**
+     * Predicts sigma points, the state, and the state covariance of every
+     * track, long gaps in several steps like UKF::PredictTo
+     * @param delta_t Time between k and k+1 in s, per track
+     */
+    void Prediction(const TrackArray &delta_t);
+
+    /**
+     * Predicts the laser measurement of every track without updating, like
+     * UKF::PredictMeasurement
+     * @param z_pred Receives one row [px py] per track
+     * @param S Receives the innovation covariance, column a + b * 2 holds
+     * entry (a, b) of every track
+     */
+    void PredictLidar(TrackMatrix &z_pred, TrackMatrix &S) const;
+
+    /**
+     * Predicts the radar measurement of every track from the sigma points of
+     * the last Prediction without updating, like UKF::PredictMeasurement
+     * @param z_pred Receives one row [rho phi rho_dot] per track
+     * @param S Receives the innovation covariance, column a + b * 3 holds
+     * entry (a, b) of every track
+     */
+    void PredictRadar(TrackMatrix &z_pred, TrackMatrix &S);
+
+    /**
+     * Updates every track with a laser measurement
+     * @param z Measurements, one row [px py] per track
+     * @param active 1 for tracks that received a measurement, 0 for tracks
+     * that keep their predicted state
+     */
+    void UpdateLidar(const TrackMatrix &z, const TrackArray &active);
+
+    /**
+     * Updates every track with a radar measurement using the sigma points of
+     * the last Prediction
+     * @param z Measurements, one row [rho phi rho_dot] per track
+     * @param active 1 for tracks that received a measurement, 0 for tracks
+     * that keep their predicted state
+     */
+    void UpdateRadar(const TrackMatrix &z, const TrackArray &active);
+
+private:
+    static const int n_x_ = UKF::n_x_;
+    static const int n_aug_ = UKF::n_aug_;
+    static const int n_sig_ = UKF::n_sig_;
+    static const int n_z_radar_ = models::RadarModel::n_z;
+
+    ///* Process noise standard deviations
+    double std_a_;
+    double std_yawdd_;
+
+    ///* Measurement noise covariances
+    models::LidarModel::Matrix R_laser_;
+    models::RadarModel::Matrix R_radar_;
+
+    ///* Sigma point spreading parameter and weights
+    double lambda_;
+    UKF::WeightVector weights_;
+
+    ///* taken from the prototype, see UKF::use_fast_trig_
+    bool use_fast_trig_;
+
+    ///* Work buffers, allocated with the tracks so that filter steps do not allocate
+    TrackMatrix L_;
+    TrackMatrix sig_;
+    TrackMatrix trig_;
+    TrackMatrix Zsig_;
+    TrackMatrix diff_;
+    TrackMatrix S_;
+    TrackMatrix S_radar_;
+    TrackMatrix Si_;
+    TrackMatrix Tc_;
+    TrackMatrix K_;
+    TrackMatrix z_pred_;
+    TrackMatrix z_diff_;
+    TrackArray nis_;
+    TrackArray step_;
+    Eigen::ArrayXi steps_;
+    ///* 1 for the tracks whose factor of P is complete so far
+    TrackArray factored_;
+
+    ///* Zsig_, z_pred_ and S_radar_ belong to the current predicted sigma points
+    bool radar_moments_;
+
+    ///* state of the tracks before a step, for gaps that take more steps on some tracks than on others
+    TrackMatrix x_before_;
+    TrackMatrix P_before_;
+    TrackMatrix Xsig_pred_before_;
+
+    TrackMatrix::ColXpr P(int r, int c) { return P_.col(r + c * n_x_); }
+
+    TrackMatrix::ColXpr L(int r, int c) { return L_.col(r + c * n_x_); }
+
+    TrackMatrix::ColXpr Xp(int k, int i) { return Xsig_pred_.col(k + i * n_x_); }
+
+    /**
+     * Sizes the work buffers for n_tracks_
+     */
+    void AllocateBuffers();
+
+    /**
+     * Predicts sigma points, the state, and the state covariance of every
+     * track in one step
+     */
+    void Step(const TrackArray &delta_t);
+
+    /**
+     * Transforms the predicted sigma point i of every track into radar space
+     */
+    void MeasureRadar(int i);
+
+    /**
+     * Transforms the predicted sigma points into radar space, stores their
+     * mean in z_pred_ and the lower triangle of the innovation covariance,
+     * including R, in S_radar_. Does nothing if they are still current.
+     */
+    void PredictRadarMoments();
+
+    /**
+     * Overwrites the upper triangle of P_ with the lower one
+     */
+    void MirrorCovariance();
+
+    /**
+     * Wraps every entry of a track column into [-pi, pi]
+     */
+    void NormalizeAngles(TrackMatrix::ColXpr angles);
+};
+
+#endif //UNSCENTED_KALMAN_FILTER_UKF_BATCH_HPP
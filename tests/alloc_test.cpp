@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "../src/log_reader.hpp"
+#include "../src/ukf.hpp"
+
+using namespace std;
+
+///* number of heap allocations made so far
+static long allocations = 0;
+
+#ifdef __GLIBC__
+// Eigen allocates dynamic matrices with malloc, not operator new, so malloc
+// is counted as well; operator new counts once and bypasses it
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    allocations++;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size) {
+    allocations++;
+    return __libc_realloc(p, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size) {
+    allocations++;
+    *p = __libc_memalign(alignment, size);
+    return *p == NULL ? 12 : 0;
+}
+}
+
+static void *allocate(size_t size) {
+    return __libc_malloc(size);
+}
+#else
+static void *allocate(size_t size) {
+    return malloc(size);
+}
+#endif
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = allocate(size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
+
+///* measurements processed before counting, the filter is initialized and past its first gaps
+const size_t kWarmUp = 100;
+
+/**
+ * Replays the packages through a filter and counts the allocations of the
+ * ProcessMeasurement calls after the warm-up
+ * @return false if any call allocated
+ */
+bool checkSteadyState(const char *name, bool use_sqrt, const vector<MeasurementPackage> &packages) {
+    UKF ukf;
+    ukf.use_sqrt_ = use_sqrt;
+    for (size_t i = 0; i < kWarmUp; i++) {
+        ukf.ProcessMeasurement(packages[i]);
+    }
+
+    long before = allocations;
+    for (size_t i = kWarmUp; i < packages.size(); i++) {
+        ukf.ProcessMeasurement(packages[i]);
+    }
+    long count = allocations - before;
+
+    printf("%-10s %zu measurements, %ld allocations  %s\n", name, packages.size() - kWarmUp, count,
+           count == 0 ? "ok" : "FAILED");
+    return count == 0;
+}
+
+int main() {
+    const string data_1 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-1.txt";
+
+    LogReader in_file;
+    if (!in_file.Open(data_1)) {
+        fprintf(stderr, "Cannot read sample data: %s\n", data_1.c_str());
+        return EXIT_FAILURE;
+    }
+    vector<MeasurementPackage> packages;
+    MeasurementPackage meas_package;
+    GroundTruthPackage gt_package;
+    while (in_file.Next(meas_package, gt_package)) {
+        packages.push_back(meas_package);
+    }
+    if (packages.size() <= kWarmUp) {
+        fprintf(stderr, "Too few measurements in %s\n", data_1.c_str());
+        return EXIT_FAILURE;
+    }
+
+    bool ok = checkSteadyState("standard", false, packages);
+    ok = checkSteadyState("sqrt", true, packages) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
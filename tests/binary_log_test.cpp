@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../src/binary_log.hpp"
+#include "../src/replay.hpp"
+
+using namespace std;
+
+const string kBinaryLog = "binary_log_test.ukfb";
+const string kTextOutput = "binary_log_test-text.txt";
+const string kBinaryOutput = "binary_log_test-binary.txt";
+
+vector<string> readLines(const string &file_name) {
+    ifstream in(file_name.c_str());
+    vector<string> lines;
+    string line;
+    while (getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/**
+ * Converts a text log into a binary one, like ukf_log_convert
+ * @return The number of records, -1 if the conversion failed
+ */
+long convert(const string &in_name, const string &out_name) {
+    LogReader in_file;
+    binary_log::Writer out_file;
+    if (!in_file.Open(in_name) || !out_file.Open(out_name)) {
+        return -1;
+    }
+    MeasurementPackage meas_package;
+    GroundTruthPackage gt_package;
+    long records = 0;
+    while (in_file.Next(meas_package, gt_package)) {
+        if (!out_file.Write(meas_package, gt_package)) {
+            return -1;
+        }
+        records++;
+    }
+    return out_file.Close() ? records : -1;
+}
+
+/**
+ * Replays a log into out_name with the default options
+ */
+ReplayResult replay(const string &file_name, const string &out_name) {
+    LogReader in_file;
+    OutputWriter out_file;
+    if (!in_file.Open(file_name) || !out_file.Open(out_name)) {
+        fprintf(stderr, "Cannot replay %s\n", file_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    ReplayResult result = processStream(in_file, out_file, ReplayOptions());
+    out_file.Close();
+    return result;
+}
+
+/**
+ * Converts a text log and replays both: every row has to be the same
+ * @return false if the binary log replays differently
+ */
+bool checkRoundTrip(const char *name, const string &file_name) {
+    long records = convert(file_name, kBinaryLog);
+    LogReader reader;
+    bool ok = records > 0 && reader.Open(kBinaryLog) && reader.IsBinary();
+    reader.Close();
+
+    ReplayResult text = replay(file_name, kTextOutput);
+    ReplayResult binary = replay(kBinaryLog, kBinaryOutput);
+    vector<string> text_rows = readLines(kTextOutput);
+    vector<string> binary_rows = readLines(kBinaryOutput);
+    ok = ok && text_rows.size() == (size_t) records && text_rows == binary_rows
+         && text.rmse.squared_error == binary.rmse.squared_error;
+    printf("%-14s %ld records  %s\n", name, records, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * Overwrites a 32 bit field of the header of the binary log
+ */
+void patchHeader(size_t offset, uint32_t value) {
+    FILE *file = fopen(kBinaryLog.c_str(), "r+b");
+    if (file == NULL || fseek(file, offset, SEEK_SET) != 0 || fwrite(&value, sizeof(value), 1, file) != 1) {
+        fprintf(stderr, "Cannot patch %s\n", kBinaryLog.c_str());
+        exit(EXIT_FAILURE);
+    }
+    fclose(file);
+}
+
+/**
+ * Logs of another version or byte order have the magic of a binary log but
+ * do not open
+ * @return false if such a log opened
+ */
+bool checkRejected(const string &file_name) {
+    LogReader reader;
+    bool ok = convert(file_name, kBinaryLog) > 0;
+
+    patchHeader(offsetof(binary_log::Header, version), binary_log::kVersion + 1);
+    ok = ok && !reader.Open(kBinaryLog);
+
+    convert(file_name, kBinaryLog);
+    uint32_t swapped = __builtin_bswap32(binary_log::kByteOrderMark);
+    patchHeader(offsetof(binary_log::Header, byte_order), swapped);
+    ok = ok && !reader.Open(kBinaryLog);
+
+    printf("%-14s %s\n", "rejected", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    const string data_1 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-1.txt";
+    const string data_2 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-2.txt";
+
+    bool ok = checkRoundTrip("data-1", data_1);
+    ok = checkRoundTrip("data-2", data_2) && ok;
+    ok = checkRejected(data_1) && ok;
+
+    remove(kBinaryLog.c_str());
+    remove(kTextOutput.c_str());
+    remove(kBinaryOutput.c_str());
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../src/checkpoint.hpp"
+#include "../src/replay.hpp"
+
+using namespace std;
+
+const string kCheckpointFile = "checkpoint_test.snapshots";
+const string kFullOutput = "checkpoint_test-full.txt";
+const string kResumedOutput = "checkpoint_test-resumed.txt";
+
+vector<string> readLines(const string &file_name) {
+    ifstream in(file_name.c_str());
+    vector<string> lines;
+    string line;
+    while (getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/**
+ * Replays a log into out_name, from the offset of options.resume if given
+ */
+ReplayResult replay(const string &file_name, const string &out_name, const ReplayOptions &options) {
+    LogReader in_file;
+    OutputWriter out_file;
+    if (!in_file.Open(file_name) || !out_file.Open(out_name)
+        || (options.resume != NULL && !in_file.Seek(options.resume->header.log_offset))) {
+        fprintf(stderr, "Cannot replay %s\n", file_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    ReplayResult result = processStream(in_file, out_file, options);
+    out_file.Close();
+    return result;
+}
+
+bool sameStatistics(const ReplayResult &a, const ReplayResult &b) {
+    return a.rmse.count == b.rmse.count && a.rmse.squared_error == b.rmse.squared_error
+           && a.lidar_nis.count == b.lidar_nis.count && a.lidar_nis.over == b.lidar_nis.over
+           && a.radar_nis.count == b.radar_nis.count && a.radar_nis.over == b.radar_nis.over
+           && a.nees.count == b.nees.count && a.nees.over == b.nees.over && a.nees.sum == b.nees.sum;
+}
+
+/**
+ * Replays a log with snapshots, resumes from the last one and compares the
+ * rows and the statistics of the resumed replay with the tail of the full one
+ * @return false if a row or a statistic differs
+ */
+bool checkResume(const char *name, const string &file_name, ReplayOptions options, checkpoint::FilterKind kind) {
+    checkpoint::Writer checkpoints;
+    if (!checkpoints.Open(kCheckpointFile)) {
+        fprintf(stderr, "Cannot open %s\n", kCheckpointFile.c_str());
+        exit(EXIT_FAILURE);
+    }
+    options.checkpoints = &checkpoints;
+    options.checkpoint_every = 500;
+    ReplayResult full = replay(file_name, kFullOutput, options);
+    checkpoints.Close();
+    options.checkpoints = NULL;
+
+    checkpoint::Snapshot snapshot;
+    bool ok = checkpoint::ReadSnapshot(kCheckpointFile, LONG_MAX, snapshot) && checkpoint::Fits(snapshot, kind);
+    options.resume = &snapshot;
+    ReplayResult resumed = replay(file_name, kResumedOutput, options);
+
+    vector<string> full_rows = readLines(kFullOutput);
+    vector<string> resumed_rows = readLines(kResumedOutput);
+    size_t skipped = snapshot.header.count;
+    ok = ok && skipped > 0 && !resumed.resume_failed
+         && resumed_rows.size() == full_rows.size() - skipped
+         && equal(resumed_rows.begin(), resumed_rows.end(), full_rows.begin() + skipped)
+         && sameStatistics(resumed, full);
+    printf("%-12s resumed after %zu of %zu rows  %s\n", name, skipped, full_rows.size(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * A filter state cut short does not load: the filter stays untouched and a
+ * resume from it writes nothing
+ * @return false if the state was loaded or rows were written
+ */
+bool checkTruncated(const string &file_name) {
+    checkpoint::Snapshot snapshot;
+    bool ok = checkpoint::ReadSnapshot(kCheckpointFile, LONG_MAX, snapshot) && !snapshot.filter.empty();
+    snapshot.filter.pop_back();
+
+    UKF ukf;
+    ukf.x_.setConstant(1);
+    UKF::StateMatrix P = ukf.P_;
+    ok = ok && !checkpoint::LoadFilter(snapshot.filter, ukf)
+         && ukf.x_ == UKF::StateVector::Constant(1) && ukf.P_ == P;
+
+    ReplayOptions options;
+    options.resume = &snapshot;
+    ReplayResult result = replay(file_name, kResumedOutput, options);
+    ok = ok && result.resume_failed && result.rmse.count == 0 && readLines(kResumedOutput).empty();
+    printf("%-12s %s\n", "truncated", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    const string data_1 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-1.txt";
+
+    ReplayOptions options;
+    bool ok = checkResume("UKF", data_1, options, checkpoint::UKF_DOUBLE);
+    options.use_sqrt = true;
+    ok = checkResume("UKF sqrt", data_1, options, checkpoint::UKF_DOUBLE) && ok;
+    options.use_sqrt = false;
+    options.use_float = true;
+    ok = checkResume("float", data_1, options, checkpoint::UKF_FLOAT) && ok;
+    options.use_float = false;
+    options.use_imm = true;
+    ok = checkResume("IMM", data_1, options, checkpoint::IMM_FILTER) && ok;
+    ok = checkTruncated(data_1) && ok;
+
+    remove(kCheckpointFile.c_str());
+    remove(kFullOutput.c_str());
+    remove(kResumedOutput.c_str());
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "../src/replay.hpp"
+
+using namespace std;
+
+///* largest relative difference of a fast trig RMSE from the libm one
+const double kMaxRmseError = 1e-4;
+
+///* largest difference of a fast trig NIS share from the libm one
+const double kMaxNisError = 0.01;
+
+/**
+ * Replays a log with the given options and no output
+ */
+ReplayResult replay(const string &file_name, const ReplayOptions &options) {
+    LogReader in_file;
+    OutputWriter out_file;
+    if (!in_file.Open(file_name) || !out_file.Open("/dev/null")) {
+        fprintf(stderr, "Cannot replay %s\n", file_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    return processStream(in_file, out_file, options);
+}
+
+/**
+ * Replays a log with libm and with the polynomial sin, cos and atan2. The
+ * polynomials change the results if the RMSE is more than kMaxRmseError off
+ * or a NIS share more than kMaxNisError.
+ * @return false if the fast trig filter is off
+ */
+bool checkFastTrig(const char *name, const string &file_name, ReplayOptions options) {
+    options.fast_trig = false;
+    ReplayResult expected = replay(file_name, options);
+    options.fast_trig = true;
+    ReplayResult actual = replay(file_name, options);
+
+    Eigen::VectorXd actual_rmse = actual.rmse.RMSE();
+    Eigen::VectorXd expected_rmse = expected.rmse.RMSE();
+    double rmse_error = ((actual_rmse - expected_rmse).array() / expected_rmse.array()).abs().maxCoeff();
+    double nis_error = max(fabs(actual.lidar_nis.Share() - expected.lidar_nis.Share()),
+                           fabs(actual.radar_nis.Share() - expected.radar_nis.Share()));
+    bool ok = rmse_error < kMaxRmseError && nis_error < kMaxNisError;
+    printf("%-20s rmse %.7f %.7f (%.1e off), nis %.2f%% %.2f%% (%.1e off)  %s\n", name,
+           actual_rmse(0), actual_rmse(1), rmse_error,
+           actual.radar_nis.Share() * 100, actual.lidar_nis.Share() * 100, nis_error,
+           ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    const string data_1 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-1.txt";
+    const string data_2 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-2.txt";
+
+    bool ok = true;
+    for (int log = 0; log < 2; log++) {
+        const string &file_name = log == 0 ? data_1 : data_2;
+        string prefix = log == 0 ? "data-1" : "data-2";
+        ReplayOptions options;
+        ok = checkFastTrig(prefix.c_str(), file_name, options) && ok;
+        options.use_sqrt = true;
+        ok = checkFastTrig((prefix + " (sqrt)").c_str(), file_name, options) && ok;
+        options.use_sqrt = false;
+        options.use_float = true;
+        ok = checkFastTrig((prefix + " (float)").c_str(), file_name, options) && ok;
+        options.use_float = false;
+        options.use_imm = true;
+        ok = checkFastTrig((prefix + " (imm)").c_str(), file_name, options) && ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
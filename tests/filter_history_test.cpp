@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/binary_log.hpp"
+#include "../src/filter_history.hpp"
+#include "../src/imm.hpp"
+#include "../src/log_reader.hpp"
+#include "../src/replay.hpp"
+#include "../src/ukf.hpp"
+
+using namespace std;
+
+const string kInOrderOutput = "filter_history_test-in-order.txt";
+const string kSwappedOutput = "filter_history_test-swapped.txt";
+
+///* largest position difference in m of a row written before its late
+///* predecessor arrived from the row of the in-order replay
+const double kRowTolerance = 0.05;
+
+///* largest relative difference of the RMSE and the mean NEES of the replay
+///* with late measurements from the in-order replay
+const double kStatisticsTolerance = 0.05;
+
+bool earlier(const MeasurementPackage &a, const MeasurementPackage &b) {
+    return a.timestamp_ < b.timestamp_;
+}
+
+/**
+ * Processes the measurements in order of time, like a log without late ones
+ */
+template<class Filter>
+Filter replayInOrder(vector<MeasurementPackage> packages) {
+    stable_sort(packages.begin(), packages.end(), earlier);
+    Filter ukf;
+    for (const MeasurementPackage &meas_package : packages) {
+        ukf.ProcessMeasurement(meas_package);
+    }
+    return ukf;
+}
+
+template<class Filter>
+bool sameState(const Filter &a, const Filter &b) {
+    return a.x_ == b.x_ && a.P_ == b.P_;
+}
+
+/**
+ * Delivers the measurements delayed by up to max_lag, in order of arrival.
+ * After every arrival the filter has to hold the state of an in-order replay
+ * of the measurements that arrived so far.
+ * @return false if a state differs or a measurement was dropped
+ */
+template<class Filter>
+bool checkShuffled(const char *name, const vector<MeasurementPackage> &packages, long max_lag) {
+    mt19937 gen(1);
+    uniform_int_distribution<long> delay(0, max_lag);
+    vector<pair<long, size_t> > arrivals;
+    for (size_t i = 0; i < packages.size(); i++) {
+        // the first one starts the filter, nothing can go before it
+        arrivals.push_back(make_pair(packages[i].timestamp_ + (i == 0 ? 0 : delay(gen)), i));
+    }
+    sort(arrivals.begin(), arrivals.end());
+
+    Filter ukf;
+    FilterHistoryT<Filter> history(ukf, max_lag, 64);
+    vector<MeasurementPackage> arrived;
+    bool ok = true;
+    for (const pair<long, size_t> &arrival : arrivals) {
+        const MeasurementPackage &meas_package = packages[arrival.second];
+        ok = history.Process(meas_package) && ok;
+        arrived.push_back(meas_package);
+        ok = ok && sameState(ukf, replayInOrder<Filter>(arrived));
+    }
+    ok = ok && history.dropped_count_ == 0 && history.late_count_ > 0;
+    printf("%-16s %zu measurements, %ld late  %s\n", name, packages.size(), history.late_count_,
+           ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * Fills a small ring buffer several times over, then inserts a late
+ * measurement that is still buffered and drops one older than the oldest
+ * buffered measurement and one beyond the lag bound.
+ * @return false if the late one changed the state wrongly or a dropped one changed it at all
+ */
+template<class Filter>
+bool checkEviction(const char *name, const vector<MeasurementPackage> &packages) {
+    const int capacity = 8;
+    const size_t count = 30;
+    const long max_lag = 10000000;
+
+    Filter ukf;
+    FilterHistoryT<Filter> history(ukf, max_lag, capacity);
+    vector<MeasurementPackage> processed;
+    for (size_t i = 0; i < count; i++) {
+        if (i != count - 3) {
+            history.Process(packages[i]);
+            processed.push_back(packages[i]);
+        }
+    }
+
+    // buffered: inserted at its time
+    bool ok = history.Process(packages[count - 3]);
+    processed.push_back(packages[count - 3]);
+    ok = ok && sameState(ukf, replayInOrder<Filter>(processed)) && history.late_count_ == 1;
+
+    // older than the oldest of the buffered measurements
+    Filter before = ukf;
+    MeasurementPackage evicted = packages[count - capacity - 2];
+    evicted.timestamp_ += 1;
+    ok = ok && !history.Process(evicted) && sameState(ukf, before);
+
+    // beyond the lag bound
+    MeasurementPackage old = packages[count - 1];
+    old.timestamp_ -= max_lag + 1;
+    ok = ok && !history.Process(old) && sameState(ukf, before) && history.dropped_count_ == 2;
+
+    printf("%-16s %s\n", name, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+vector<string> readLines(const string &file_name) {
+    ifstream in(file_name.c_str());
+    vector<string> lines;
+    string line;
+    while (getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/**
+ * Replays records into out_name
+ */
+ReplayResult replay(const vector<binary_log::Record> &records, const string &out_name, const ReplayOptions &options) {
+    LogReader in_file;
+    OutputWriter out_file;
+    if (!out_file.Open(out_name)) {
+        fprintf(stderr, "Cannot open %s\n", out_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    in_file.OpenRecords(records.data(), records.size());
+    ReplayResult result = processStream(in_file, out_file, options);
+    out_file.Close();
+    return result;
+}
+
+/**
+ * @return The largest difference of the estimated positions of two rows
+ */
+double positionDifference(const string &a, const string &b) {
+    istringstream row_a(a), row_b(b);
+    double x_a, y_a, x_b, y_b;
+    row_a >> x_a >> y_a;
+    row_b >> x_b >> y_b;
+    return max(fabs(x_a - x_b), fabs(y_a - y_b));
+}
+
+bool near(double a, double b) {
+    return fabs(a - b) <= kStatisticsTolerance * fabs(b);
+}
+
+/**
+ * Replays a log with every tenth measurement swapped with the one after it,
+ * with max_lag, and in order. The row of a late measurement has to show the
+ * state right after it, as in the in-order replay; the row of its successor,
+ * written before it arrived, can only be close. The statistics have to
+ * follow the rows.
+ * @return false if a row or a statistic differs
+ */
+bool checkReplay(const vector<MeasurementPackage> &packages, const vector<GroundTruthPackage> &gt_packages) {
+    vector<binary_log::Record> in_order(packages.size()), swapped(packages.size());
+    vector<size_t> arrival;
+    for (size_t i = 0; i < packages.size(); i++) {
+        binary_log::FromPackages(packages[i], gt_packages[i], in_order[i]);
+        arrival.push_back(i);
+    }
+    // not the first measurement, nothing can go before it
+    long late = 0;
+    for (size_t i = 5; i + 1 < arrival.size(); i += 10) {
+        swap(arrival[i], arrival[i + 1]);
+        late++;
+    }
+    for (size_t i = 0; i < arrival.size(); i++) {
+        swapped[i] = in_order[arrival[i]];
+    }
+
+    ReplayOptions options;
+    ReplayResult expected = replay(in_order, kInOrderOutput, options);
+    options.max_lag = 200000;
+    ReplayResult result = replay(swapped, kSwappedOutput, options);
+    vector<string> expected_rows = readLines(kInOrderOutput);
+    vector<string> rows = readLines(kSwappedOutput);
+
+    bool ok = rows.size() == expected_rows.size() && result.late_count == late && result.dropped_count == 0;
+    double row_difference = 0;
+    for (size_t i = 0; ok && i < rows.size(); i++) {
+        const string &expected_row = expected_rows[arrival[i]];
+        if (i > 0 && arrival[i] < arrival[i - 1]) {
+            ok = rows[i] == expected_row;
+        } else {
+            row_difference = max(row_difference, positionDifference(rows[i], expected_row));
+        }
+    }
+    ok = ok && row_difference <= kRowTolerance
+         && near(result.rmse.RMSE()(0), expected.rmse.RMSE()(0))
+         && near(result.rmse.RMSE()(1), expected.rmse.RMSE()(1))
+         && near(result.nees.Mean(), expected.nees.Mean())
+         && fabs(result.lidar_nis.Share() - expected.lidar_nis.Share()) <= 1
+         && fabs(result.radar_nis.Share() - expected.radar_nis.Share()) <= 1;
+    printf("%-16s %ld late, rows within %.3f m, RMSE %.4f %.4f in order %.4f %.4f  %s\n", "replay", late,
+           row_difference, result.rmse.RMSE()(0), result.rmse.RMSE()(1), expected.rmse.RMSE()(0),
+           expected.rmse.RMSE()(1), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    const string data_1 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-1.txt";
+
+    LogReader in_file;
+    if (!in_file.Open(data_1)) {
+        fprintf(stderr, "Cannot read sample data: %s\n", data_1.c_str());
+        return EXIT_FAILURE;
+    }
+    vector<MeasurementPackage> log;
+    vector<GroundTruthPackage> gt_log;
+    MeasurementPackage meas_package;
+    GroundTruthPackage gt_package;
+    while (in_file.Next(meas_package, gt_package)) {
+        log.push_back(meas_package);
+        gt_log.push_back(gt_package);
+    }
+    vector<MeasurementPackage> packages(log.begin(), log.begin() + min((size_t) 150, log.size()));
+
+    bool ok = checkShuffled<UKF>("shuffled UKF", packages, 200000);
+    ok = checkShuffled<IMM>("shuffled IMM", packages, 200000) && ok;
+    ok = checkEviction<UKF>("evicted UKF", packages) && ok;
+    ok = checkEviction<IMM>("evicted IMM", packages) && ok;
+    ok = checkReplay(log, gt_log) && ok;
+
+    remove(kInOrderOutput.c_str());
+    remove(kSwappedOutput.c_str());
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../src/ctrv_kernel.hpp"
+#include "../src/fast_trig.hpp"
+#include "../src/replay.hpp"
+
+using namespace std;
+
+///* largest relative difference of a float RMSE from the double one
+const double kMaxRmseError = 1e-3;
+
+///* largest difference of a float NIS share from the double one
+const double kMaxNisError = 0.01;
+
+///* largest absolute error of the single precision sine and cosine against sinf and cosf
+const double kMaxSinCosError = 1.2e-7;
+
+/**
+ * Replays a log with the given options and no output
+ */
+ReplayResult replay(const string &file_name, const ReplayOptions &options) {
+    LogReader in_file;
+    OutputWriter out_file;
+    if (!in_file.Open(file_name) || !out_file.Open("/dev/null")) {
+        fprintf(stderr, "Cannot replay %s\n", file_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    return processStream(in_file, out_file, options);
+}
+
+/**
+ * Replays a log with the double and the single precision filter. The float
+ * filter diverges if its RMSE is more than kMaxRmseError off or a NIS share
+ * more than kMaxNisError.
+ * @return false if the float filter diverged
+ */
+bool checkFloat(const char *name, const string &file_name, ReplayOptions options) {
+    options.use_float = false;
+    ReplayResult expected = replay(file_name, options);
+    options.use_float = true;
+    ReplayResult actual = replay(file_name, options);
+
+    Eigen::VectorXd actual_rmse = actual.rmse.RMSE();
+    Eigen::VectorXd expected_rmse = expected.rmse.RMSE();
+    double rmse_error = ((actual_rmse - expected_rmse).array() / expected_rmse.array()).abs().maxCoeff();
+    double nis_error = max(fabs(actual.lidar_nis.Share() - expected.lidar_nis.Share()),
+                           fabs(actual.radar_nis.Share() - expected.radar_nis.Share()));
+    bool ok = rmse_error < kMaxRmseError && nis_error < kMaxNisError;
+    printf("%-16s rmse %.7f %.7f (%.1e off), nis %.2f%% %.2f%% (%.1e off)  %s\n", name,
+           actual_rmse(0), actual_rmse(1), rmse_error,
+           actual.radar_nis.Share() * 100, actual.lidar_nis.Share() * 100, nis_error,
+           ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * Compares the single precision sine and cosine of the CTRV kernel and of
+ * trig::SinCosReduced with sinf and cosf on a dense grid up to the libm
+ * fallback.
+ * @return false if an error exceeds kMaxSinCosError
+ */
+bool checkSinCos() {
+    const int samples = 2000000;
+    const float range = trig::Reduction<float>::MaxReduced();
+    vector<float> x(samples), s(samples), c(samples);
+    for (int i = 0; i < samples; i++) {
+        x[i] = -range + 2 * range * ((float) i / samples);
+    }
+    ctrv::SinCos(x.data(), s.data(), c.data(), samples);
+
+    double kernel_error = 0, reduced_error = 0;
+    for (int i = 0; i < samples; i++) {
+        kernel_error = max(kernel_error, (double) max(fabsf(s[i] - sinf(x[i])), fabsf(c[i] - cosf(x[i]))));
+        float s_r, c_r;
+        trig::SinCosReduced(x[i], s_r, c_r);
+        reduced_error = max(reduced_error, (double) max(fabsf(s_r - sinf(x[i])), fabsf(c_r - cosf(x[i]))));
+    }
+    bool ok = kernel_error < kMaxSinCosError && reduced_error < kMaxSinCosError;
+    printf("%-16s kernel %.3e, reduced %.3e  %s\n", "sin/cos", kernel_error, reduced_error, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    const string data_1 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-1.txt";
+    const string data_2 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-2.txt";
+
+    ReplayOptions options;
+    const char *names[] = {"data-1", "data-1 (sqrt)", "data-2", "data-2 (sqrt)"};
+    bool ok = checkSinCos();
+    for (int i = 0; i < 4; i++) {
+        options.use_sqrt = i % 2 == 1;
+        ok = checkFloat(names[i], i < 2 ? data_1 : data_2, options) && ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "../src/ukf.hpp"
+
+using namespace std;
+
+///* largest difference of the states and covariances, relative to values above 1
+const double kTolerance = 1e-9;
+
+/**
+ * A sensor that is not built in: the position like the lidar, but declared
+ * nonlinear so its updates go through the sigma points. The unscented
+ * transform of a linear map is exact, so it has to update like LidarModel.
+ */
+struct PositionModel : public models::MeasurementModel<2> {
+    static const bool is_linear = false;
+
+    template<class Trig = trig::Exact>
+    Vector Measure(const StateVector &x) const {
+        return x.head<2>();
+    }
+
+    void Initialize(const Vector &z, StateVector &x, StateMatrix &) const {
+        x << z(0), z(1), 0, 0, 0;
+    }
+};
+
+/**
+ * A linear one-dimensional sensor of the speed, like a wheel encoder
+ */
+struct SpeedModel : public models::MeasurementModel<1> {
+    static const bool is_linear = true;
+
+    Eigen::Matrix<double, 1, models::n_x> H;
+
+    SpeedModel() {
+        H << 0, 0, 1, 0, 0;
+    }
+
+    void Initialize(const Vector &z, StateVector &x, StateMatrix &) const {
+        x << 0, 0, z(0), 0, 0;
+    }
+};
+
+double difference(const UKF &a, const UKF &b) {
+    double error = 0;
+    for (int i = 0; i < UKF::n_x_; i++) {
+        error = max(error, fabs(a.x_(i) - b.x_(i)) / max(1.0, fabs(b.x_(i))));
+        for (int j = 0; j < UKF::n_x_; j++) {
+            error = max(error, fabs(a.P_(i, j) - b.P_(i, j)) / max(1.0, fabs(b.P_(i, j))));
+        }
+    }
+    return error;
+}
+
+/**
+ * Runs a short track through two filters, one updated with LidarModel and one
+ * with PositionModel through UKF::ProcessMeasurement<Model>
+ * @return false if the filters differ
+ */
+bool checkPositionModel(const char *name, bool use_sqrt) {
+    UKF lidar, position;
+    lidar.use_sqrt_ = use_sqrt;
+    position.use_sqrt_ = use_sqrt;
+    PositionModel model;
+    model.SetNoise(lidar.lidar_model_.R);
+
+    double error = 0;
+    double nis_error = 0;
+    for (int k = 0; k < 40; k++) {
+        long timestamp = 1000000 + k * 50000L;
+        PositionModel::Vector z(10 + 0.2 * k + 0.05 * sin(k), 3 + 0.001 * k * k);
+        double nis_lidar = lidar.ProcessMeasurement(lidar.lidar_model_, timestamp, z, timing::LIDAR_UPDATE);
+        double nis_position = position.ProcessMeasurement(model, timestamp, z, timing::LIDAR_UPDATE);
+        error = max(error, difference(position, lidar));
+        nis_error = max(nis_error, fabs(nis_position - nis_lidar) / max(1.0, nis_lidar));
+    }
+
+    bool ok = error < kTolerance && nis_error < kTolerance;
+    printf("%-16s max difference %.1e, nis %.1e  %s\n", name, error, nis_error, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * Updates with SpeedModel and compares with the Kalman update written out
+ * @return false if the state, covariance or NIS differ
+ */
+bool checkSpeedModel() {
+    UKF ukf;
+    SpeedModel model;
+    SpeedModel::Matrix R;
+    R << 0.04;
+    model.SetNoise(R);
+
+    ukf.ProcessMeasurement(ukf.lidar_model_, 1000000, UKF::LidarModel::Vector(10, 3), timing::LIDAR_UPDATE);
+    ukf.PredictTo(1050000);
+    UKF expected = ukf;
+
+    SpeedModel::Vector z;
+    z << 2.5;
+    double nis = ukf.Update(model, z);
+
+    double S = expected.P_(2, 2) + R(0, 0);
+    double residual = z(0) - expected.x_(2);
+    UKF::StateVector K = expected.P_.col(2) / S;
+    expected.x_ += K * residual;
+    expected.P_ -= K * expected.P_.row(2);
+    double nis_expected = residual * residual / S;
+
+    double error = difference(ukf, expected);
+    bool ok = error < kTolerance && fabs(nis - nis_expected) < kTolerance * nis_expected;
+    printf("%-16s max difference %.1e, nis %.3g  %s\n", "speed", error, nis, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    bool ok = checkPositionModel("position", false);
+    ok = checkPositionModel("position (sqrt)", true) && ok;
+    ok = checkSpeedModel() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/output_writer.hpp"
+
+using namespace std;
+
+const string kOutput = "output_writer_test.txt";
+
+vector<string> readLines(const string &file_name) {
+    ifstream in(file_name.c_str());
+    vector<string> lines;
+    string line;
+    while (getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+void writeRow(OutputWriter &out, long i) {
+    out.WriteText("L");
+    out.WriteInteger(1477010443000000 + i * 50000);
+    out.Write(0.1 * i);
+    out.Write(-1.0 / 3);
+    out.EndRow();
+}
+
+/**
+ * With --flush-rows n the rows reach the file in blocks of n, the rest on Close
+ * @return false if rows were written early or late
+ */
+bool checkFlushRows() {
+    OutputWriter out;
+    OutputWriter::FlushPolicy policy = {3, 0};
+    bool ok = out.Open(kOutput);
+    out.SetFlushPolicy(policy);
+
+    size_t expected[] = {0, 0, 3, 3, 3, 6, 6};
+    for (int i = 0; i < 7; i++) {
+        writeRow(out, i);
+        ok = ok && readLines(kOutput).size() == expected[i];
+    }
+    ok = out.Close() && ok && readLines(kOutput).size() == 7;
+    printf("%-12s %s\n", "flush rows", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * Without a policy the rows stay buffered until Close, with seconds Idle
+ * writes them
+ * @return false if rows were written early or late
+ */
+bool checkBuffered() {
+    OutputWriter out;
+    bool ok = out.Open(kOutput);
+    for (int i = 0; i < 100; i++) {
+        writeRow(out, i);
+    }
+    out.Idle();
+    ok = ok && readLines(kOutput).empty();
+    ok = out.Close() && ok && readLines(kOutput).size() == 100;
+
+    OutputWriter::FlushPolicy policy = {0, 3600};
+    ok = out.Open(kOutput) && ok;
+    out.SetFlushPolicy(policy);
+    writeRow(out, 0);
+    writeRow(out, 1);
+    ok = ok && readLines(kOutput).empty();
+    out.Idle();
+    ok = ok && readLines(kOutput).size() == 2;
+    ok = out.Close() && ok && readLines(kOutput).size() == 2;
+    printf("%-12s %s\n", "buffered", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * The smallest buffer, about a row, is flushed whenever it fills. The rows
+ * and the shortest representations of the values stay intact.
+ * @return false if a row or value differs
+ */
+bool checkSmallBuffer() {
+    OutputWriter out(16);
+    bool ok = out.Open(kOutput);
+    for (int i = 0; i < 50; i++) {
+        writeRow(out, i);
+    }
+    ok = out.Close() && ok;
+
+    vector<string> lines = readLines(kOutput);
+    ok = ok && lines.size() == 50;
+    for (size_t i = 0; ok && i < lines.size(); i++) {
+        istringstream row(lines[i]);
+        string sensor;
+        long timestamp;
+        double value, third;
+        row >> sensor >> timestamp >> value >> third;
+        ok = sensor == "L" && timestamp == 1477010443000000 + (long) i * 50000
+             && value == 0.1 * i && third == -1.0 / 3;
+    }
+    printf("%-12s %s\n", "small buffer", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    bool ok = checkFlushRows();
+    ok = checkBuffered() && ok;
+    ok = checkSmallBuffer() && ok;
+    remove(kOutput.c_str());
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/imm.hpp"
+#include "../src/log_reader.hpp"
+#include "../src/smoother.hpp"
+#include "../src/tools.hpp"
+#include "../src/ukf.hpp"
+
+using namespace std;
+
+/**
+ * The subtraction loop the angles were wrapped with before
+ */
+double wrapByLoop(double angle) {
+    while (angle > M_PI) angle -= 2. * M_PI;
+    while (angle < -M_PI) angle += 2. * M_PI;
+    return angle;
+}
+
+/**
+ * NormalizeAngle has to agree with the loop on the angles a filter sees and
+ * wrap the huge angles of a diverged filter into [-pi, pi] in one step.
+ * @return false if an angle is wrapped wrongly
+ */
+bool checkNormalizeAngle() {
+    mt19937 gen(1);
+    uniform_real_distribution<double> turns(-8, 8);
+    double error = 0;
+    for (int i = 0; i < 100000; i++) {
+        double angle = turns(gen) * 2 * M_PI;
+        error = max(error, fabs(tools::NormalizeAngle(angle) - wrapByLoop(angle)));
+    }
+    bool ok = error < 1e-12;
+
+    const double huge[] = {1e6, -1e6, 1e12, -1e15, 1e300, -1e300};
+    for (double angle : huge) {
+        double wrapped = tools::NormalizeAngle(angle);
+        ok = ok && wrapped >= -M_PI && wrapped <= M_PI;
+    }
+    ok = ok && std::isnan(tools::NormalizeAngle(NAN));
+
+    printf("%-12s max difference to the loop %.1e  %s\n", "angles", error, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * Gaps up to kMaxStep take one step, longer ones equal steps of at most
+ * kSubstep that add up to the gap
+ * @return false if a gap is split wrongly
+ */
+bool checkStepCount() {
+    bool ok = prediction::StepCount(0) == 1 && prediction::StepCount(0.05) == 1
+              && prediction::StepCount(prediction::kMaxStep) == 1;
+    const double gaps[] = {0.1001, 0.5, 1, 2.37, 29.9};
+    for (double gap : gaps) {
+        int steps = prediction::StepCount(gap);
+        ok = ok && steps > 1 && gap / steps <= prediction::kSubstep + 1e-12
+             && gap / (steps - 1) > prediction::kSubstep;
+    }
+    printf("%-12s %s\n", "step count", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * Runs a log through a filter and checks that P stays a finite positive
+ * definite matrix after every measurement. A single prediction over the 1 s
+ * gaps of data-2 breaks this for the single precision filter.
+ * @return false if P lost its positive definiteness or the RMSE exceeds max_rmse
+ */
+template<class Filter>
+bool checkPositiveDefinite(const char *name, const vector<MeasurementPackage> &packages,
+                           const vector<GroundTruthPackage> &ground_truth, bool use_sqrt, double max_rmse) {
+    typedef typename Filter::StateMatrix StateMatrix;
+    Filter ukf;
+    ukf.use_sqrt_ = use_sqrt;
+    tools::RMSEAccumulator rmse(2);
+    int indefinite = 0;
+    for (size_t i = 0; i < packages.size(); i++) {
+        ukf.ProcessMeasurement(packages[i]);
+        Eigen::LLT<StateMatrix> llt(ukf.P_);
+        if (llt.info() != Eigen::Success || !ukf.P_.allFinite()) {
+            indefinite++;
+        }
+        rmse.Add(ukf.x_.template head<2>().template cast<double>(), ground_truth[i].gt_values_.head<2>());
+    }
+    Eigen::VectorXd error = rmse.RMSE();
+    bool ok = indefinite == 0 && error.allFinite() && error.maxCoeff() < max_rmse;
+    printf("%-12s %d of %zu indefinite, rmse %.6f %.6f  %s\n", name, indefinite, packages.size(),
+           error(0), error(1), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * @return A laser measurement at time t in us
+ */
+MeasurementPackage laser(long t, double p_x, double p_y) {
+    MeasurementPackage meas_package;
+    meas_package.timestamp_ = t;
+    meas_package.sensor_type_ = MeasurementPackage::LASER;
+    meas_package.raw_measurements_.resize(2);
+    meas_package.raw_measurements_ << p_x, p_y;
+    return meas_package;
+}
+
+/**
+ * A few measurements of a target moving along x, 50 ms apart, starting at t in us
+ */
+vector<MeasurementPackage> track(long t, int count) {
+    vector<MeasurementPackage> packages;
+    for (int i = 0; i < count; i++) {
+        packages.push_back(laser(t + i * 50000L, 10 + i * 0.1, 2));
+    }
+    return packages;
+}
+
+/**
+ * A measurement more than kMaxGap after the previous one initializes the
+ * filter again, like the first one of a log; one exactly kMaxGap after it is
+ * predicted to.
+ * @return false if the filter did not restart or restarted too early
+ */
+template<class Filter>
+bool checkStaleRestart(const char *name) {
+    Filter ukf, restarted, fresh, predicted;
+    for (const MeasurementPackage &meas_package : track(60000000, 10)) {
+        ukf.ProcessMeasurement(meas_package);
+    }
+    restarted = ukf;
+    predicted = ukf;
+    MeasurementPackage late = laser(ukf.previous_timestamp_ + prediction::kMaxGap + 1, 40, -3);
+    restarted.ProcessMeasurement(late);
+    fresh.ProcessMeasurement(late);
+    late.timestamp_ -= 1;
+    predicted.ProcessMeasurement(late);
+
+    bool ok = restarted.x_ == fresh.x_ && restarted.P_ == fresh.P_
+              && restarted.previous_timestamp_ == fresh.previous_timestamp_
+              && !(predicted.P_ == fresh.P_);
+    printf("%-12s %s\n", name, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * The smoother does not smooth across a restart: the nodes before a stale
+ * gap are smoothed as if the log ended before it
+ * @return false if the nodes before the gap changed
+ */
+bool checkSmootherRestart() {
+    vector<MeasurementPackage> before = track(60000000, 20);
+    vector<MeasurementPackage> after = track(before.back().timestamp_ + prediction::kMaxGap + 1, 20);
+
+    UKF ukf_before;
+    Smoother smoother_before(ukf_before);
+    for (const MeasurementPackage &meas_package : before) {
+        ukf_before.ProcessMeasurement(meas_package);
+        smoother_before.Commit();
+    }
+    smoother_before.SmoothAll(1);
+
+    UKF ukf;
+    Smoother smoother(ukf);
+    vector<long> nodes;
+    for (const MeasurementPackage &meas_package : before) {
+        ukf.ProcessMeasurement(meas_package);
+        nodes.push_back(smoother.Commit());
+    }
+    for (const MeasurementPackage &meas_package : after) {
+        ukf.ProcessMeasurement(meas_package);
+        smoother.Commit();
+    }
+    smoother.SmoothAll(1);
+
+    bool ok = true;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        ok = ok && smoother.State(nodes[i]) == smoother_before.State(nodes[i])
+             && smoother.Covariance(nodes[i]) == smoother_before.Covariance(nodes[i]);
+    }
+    printf("%-12s %s\n", "smoother", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    const string data_2 = string(UKF_DATA_DIR) + "/sample-laser-radar-measurement-data-2.txt";
+
+    LogReader in_file;
+    if (!in_file.Open(data_2)) {
+        fprintf(stderr, "Cannot read sample data: %s\n", data_2.c_str());
+        return EXIT_FAILURE;
+    }
+    vector<MeasurementPackage> packages;
+    vector<GroundTruthPackage> ground_truth;
+    MeasurementPackage meas_package;
+    GroundTruthPackage gt_package;
+    while (in_file.Next(meas_package, gt_package)) {
+        packages.push_back(meas_package);
+        ground_truth.push_back(gt_package);
+    }
+
+    bool ok = checkNormalizeAngle();
+    ok = checkStepCount() && ok;
+    ok = checkPositiveDefinite<UKF>("double", packages, ground_truth, false, 0.2) && ok;
+    ok = checkPositiveDefinite<UKF>("double sqrt", packages, ground_truth, true, 0.2) && ok;
+    ok = checkPositiveDefinite<UKFT<float> >("float", packages, ground_truth, false, 0.2) && ok;
+    ok = checkPositiveDefinite<UKFT<float> >("float sqrt", packages, ground_truth, true, 0.2) && ok;
+    ok = checkStaleRestart<UKF>("stale UKF") && ok;
+    ok = checkStaleRestart<UKFT<float> >("stale float") && ok;
+    ok = checkStaleRestart<IMM>("stale IMM") && ok;
+    ok = checkSmootherRestart() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
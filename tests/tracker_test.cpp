@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../src/tracker.hpp"
+
+using namespace std;
+
+///* largest difference of a track from a UKF with the same measurements, relative to values above 1
+const double kTolerance = 1e-9;
+
+/**
+ * A target moving with constant turn rate and velocity
+ */
+struct Target {
+    double p_x, p_y, v, yaw, yawd;
+};
+
+void move(Target &t, double delta_t) {
+    t.p_x += t.v / t.yawd * (sin(t.yaw + t.yawd * delta_t) - sin(t.yaw));
+    t.p_y += t.v / t.yawd * (cos(t.yaw) - cos(t.yaw + t.yawd * delta_t));
+    t.yaw += t.yawd * delta_t;
+}
+
+MeasurementPackage lidar(const Target &t, long timestamp, mt19937 &gen) {
+    UKF ukf;
+    normal_distribution<double> normal;
+    MeasurementPackage detection;
+    detection.timestamp_ = timestamp;
+    detection.sensor_type_ = MeasurementPackage::LASER;
+    detection.raw_measurements_.resize(2);
+    // std_laspx_ holds the variance
+    detection.raw_measurements_ << t.p_x + sqrt(ukf.std_laspx_) * normal(gen),
+            t.p_y + sqrt(ukf.std_laspy_) * normal(gen);
+    return detection;
+}
+
+MeasurementPackage radar(const Target &t, long timestamp, mt19937 &gen) {
+    UKF ukf;
+    normal_distribution<double> normal;
+    double rho = sqrt(t.p_x * t.p_x + t.p_y * t.p_y);
+    MeasurementPackage detection;
+    detection.timestamp_ = timestamp;
+    detection.sensor_type_ = MeasurementPackage::RADAR;
+    detection.raw_measurements_.resize(3);
+    detection.raw_measurements_ << rho + ukf.std_radr_ * normal(gen),
+            atan2(t.p_y, t.p_x) + ukf.std_radphi_ * normal(gen),
+            (t.p_x * cos(t.yaw) + t.p_y * sin(t.yaw)) * t.v / rho + ukf.std_radrd_ * normal(gen);
+    return detection;
+}
+
+/**
+ * Two targets seen by the lidar and the radar in every frame, the detections
+ * shuffled. Each target has to keep one track with one id from the first
+ * frame on, and both detections of a target have to go to it.
+ * @return false if a frame has another number of tracks or an id changed
+ */
+bool checkMixedSensors() {
+    mt19937 gen(1);
+    Target targets[] = {{30, 10, 5, 0.5, 0.2}, {10, 40, 4, -1, -0.1}};
+    Tracker tracker;
+    long ids[2] = {-1, -1};
+    bool ok = true;
+    int frames = 20;
+    for (int frame = 0; frame < frames; frame++) {
+        long timestamp = 1000000 + frame * 100000L;
+        vector<MeasurementPackage> detections;
+        vector<int> target_of;
+        for (int i = 0; i < 2; i++) {
+            detections.push_back(lidar(targets[i], timestamp, gen));
+            detections.push_back(radar(targets[i], timestamp, gen));
+            target_of.push_back(i);
+            target_of.push_back(i);
+        }
+        vector<int> order = {0, 1, 2, 3};
+        shuffle(order.begin(), order.end(), gen);
+        vector<MeasurementPackage> shuffled;
+        for (int d : order) {
+            shuffled.push_back(detections[d]);
+        }
+
+        vector<long> track_ids;
+        int associated = tracker.ProcessFrame(timestamp, shuffled, &track_ids);
+        ok = ok && tracker.tracks_.size() == 2 && associated == (frame == 0 ? 0 : 4);
+        for (size_t d = 0; d < order.size(); d++) {
+            long &id = ids[target_of[order[d]]];
+            if (frame == 0 && id < 0) {
+                id = track_ids[d];
+            }
+            ok = ok && track_ids[d] == id;
+        }
+
+        for (Target &target : targets) {
+            move(target, 0.1);
+        }
+    }
+    ok = ok && ids[0] >= 0 && ids[1] >= 0 && ids[0] != ids[1];
+    printf("%-16s %zu tracks after %d frames, ids %ld %ld  %s\n", "mixed sensors", tracker.tracks_.size(), frames,
+           ids[0], ids[1], ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * A track with a lidar and a radar detection in a frame is updated like a UKF
+ * with the two measurements at the same time, the lidar first
+ * @return false if the track differs from the UKF
+ */
+bool checkSequentialUpdates() {
+    mt19937 gen(2);
+    Target target = {30, 10, 5, 0.5, 0.2};
+    Tracker tracker;
+    UKF ukf;
+    double error = 0;
+    for (int frame = 0; frame < 20; frame++) {
+        long timestamp = 1000000 + frame * 100000L;
+        vector<MeasurementPackage> detections;
+        detections.push_back(radar(target, timestamp, gen));
+        detections.push_back(lidar(target, timestamp, gen));
+        tracker.ProcessFrame(timestamp, detections);
+        if (frame == 0) {
+            ukf.ProcessMeasurement(detections[0]);
+            ukf.ProcessMeasurement(detections[1]);
+        } else {
+            ukf.ProcessMeasurement(detections[1]);
+            ukf.ProcessMeasurement(detections[0]);
+        }
+
+        UKF::StateVector x = tracker.filters_.State(0);
+        UKF::StateMatrix P = tracker.filters_.Covariance(0);
+        for (int i = 0; i < UKF::n_x_; i++) {
+            error = max(error, fabs(x(i) - ukf.x_(i)) / max(1.0, fabs(ukf.x_(i))));
+            for (int j = 0; j < UKF::n_x_; j++) {
+                error = max(error, fabs(P(i, j) - ukf.P_(i, j)) / max(1.0, fabs(ukf.P_(i, j))));
+            }
+        }
+        move(target, 0.1);
+    }
+    bool ok = tracker.tracks_.size() == 1 && error < kTolerance;
+    printf("%-16s max difference %.1e  %s\n", "sequential", error, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * Of two lidar detections in the gate of a track the one with the lower NIS
+ * updates it, the other is dropped instead of starting a track
+ * @return false if it started a track or both were dropped
+ */
+bool checkLostDetection() {
+    mt19937 gen(3);
+    Target target = {30, 10, 5, 0.5, 0.2};
+    Tracker tracker;
+    bool ok = true;
+    long id = -1;
+    for (int frame = 0; frame < 10; frame++) {
+        long timestamp = 1000000 + frame * 100000L;
+        vector<MeasurementPackage> detections;
+        detections.push_back(lidar(target, timestamp, gen));
+        if (frame > 0) {
+            MeasurementPackage clutter = detections[0];
+            clutter.raw_measurements_(0) += 0.2;
+            detections.push_back(clutter);
+        }
+        vector<long> track_ids;
+        tracker.ProcessFrame(timestamp, detections, &track_ids);
+        if (frame == 0) {
+            id = track_ids[0];
+        }
+        // the clutter is close enough to win in some frames
+        ok = ok && tracker.tracks_.size() == 1
+             && (frame == 0 || (min(track_ids[0], track_ids[1]) == -1 && max(track_ids[0], track_ids[1]) == id));
+        move(target, 0.1);
+    }
+    printf("%-16s %zu tracks  %s\n", "lost detection", tracker.tracks_.size(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    bool ok = checkMixedSensors();
+    ok = checkSequentialUpdates() && ok;
+    ok = checkLostDetection() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
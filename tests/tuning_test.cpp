@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../src/tuning.hpp"
+
+using namespace std;
+
+/**
+ * Range values are the decimals of the spec, not sums of rounded steps
+ * @return false if a value differs from its decimal
+ */
+bool checkRange() {
+    tuning::Grid grid;
+    string error;
+    bool ok = tuning::ParseSpec("std-a=0.3:1.2:0.1", grid, error);
+    const double expected[] = {0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 1.0, 1.1, 1.2};
+    const vector<double> &values = grid.values[0];
+    ok = ok && values.size() == 10;
+    for (size_t i = 0; ok && i < values.size(); i++) {
+        ok = values[i] == expected[i];
+    }
+    printf("%-12s %s\n", "range", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * A result with n lidar NIS values of which over are above the limit
+ */
+tuning::Result result(long n, long over) {
+    tuning::Result result;
+    result.rmse.count = n;
+    result.lidar_nis.count = n;
+    result.lidar_nis.over = over;
+    return result;
+}
+
+/**
+ * With 100 values the 95% chi-square test accepts 1 to 9 above the limit,
+ * with 1000 values 37 to 63
+ * @return false if a share is judged wrongly
+ */
+bool checkConsistency() {
+    const long counts[][4] = {{100, 0, 1, 9}, {1000, 36, 37, 63}};
+    bool ok = true;
+    for (const long *c : counts) {
+        vector<tuning::Result> results;
+        results.push_back(result(c[0], c[1]));
+        results.push_back(result(c[0], c[2]));
+        results.push_back(result(c[0], c[3]));
+        results.push_back(result(c[0], c[3] + 1));
+        tuning::Rank(results, tuning::kNISLimit95);
+        // ranked consistent first, in their order
+        ok = ok && results[0].lidar_nis.over == c[2] && results[0].consistent
+             && results[1].lidar_nis.over == c[3] && results[1].consistent
+             && !results[2].consistent && !results[3].consistent;
+    }
+    printf("%-12s %s\n", "consistency", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    bool ok = checkRange();
+    ok = checkConsistency() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../src/ukf.hpp"
+#include "../src/ukf_batch.hpp"
+
+using namespace std;
+
+///* largest difference between the batch and the independent filters, relative to values above 1
+const double kTolerance = 1e-7;
+
+/**
+ * A target moving with constant turn rate and velocity
+ */
+struct Target {
+    double p_x, p_y, v, yaw, yawd;
+
+    void Move(double delta_t) {
+        if (fabs(yawd) > 0.001) {
+            p_x += v / yawd * (sin(yaw + yawd * delta_t) - sin(yaw));
+            p_y += v / yawd * (cos(yaw) - cos(yaw + yawd * delta_t));
+        } else {
+            p_x += v * delta_t * cos(yaw);
+            p_y += v * delta_t * sin(yaw);
+        }
+        yaw += yawd * delta_t;
+    }
+};
+
+double difference(double actual, double expected) {
+    return fabs(actual - expected) / max(1.0, fabs(expected));
+}
+
+/**
+ * @return The largest difference of the state and covariance of a track
+ */
+double difference(const UKFBatch &batch, int track, const UKF &ukf) {
+    UKF::StateVector x = batch.State(track);
+    UKF::StateMatrix P = batch.Covariance(track);
+    double error = 0;
+    for (int r = 0; r < UKF::n_x_; r++) {
+        error = max(error, difference(x(r), ukf.x_(r)));
+        for (int c = 0; c < UKF::n_x_; c++) {
+            error = max(error, difference(P(r, c), ukf.P_(r, c)));
+        }
+    }
+    return error;
+}
+
+/**
+ * Runs n tracks through a batch and through n independent UKFs: gaps of one
+ * and of several prediction steps, different on every track, lidar and radar
+ * frames and tracks without a measurement in a frame
+ * @return false if a state, covariance, predicted measurement or NIS differs
+ */
+bool checkEquivalence(const char *name, int n, bool fast_trig) {
+    mt19937 gen(n);
+    uniform_real_distribution<double> uniform(0, 1);
+    normal_distribution<double> normal;
+
+    UKF prototype;
+    prototype.use_fast_trig_ = fast_trig;
+    vector<Target> targets(n);
+    vector<UKF, Eigen::aligned_allocator<UKF> > ukfs(n, prototype);
+    vector<long> timestamps(n, 0);
+    UKFBatch batch(n, prototype);
+    for (int t = 0; t < n; t++) {
+        Target &target = targets[t];
+        target.p_x = 20 + 80 * uniform(gen);
+        target.p_y = -50 + 100 * uniform(gen);
+        target.v = 5 + normal(gen);
+        target.yaw = 2 * M_PI * uniform(gen);
+        target.yawd = 0.3 * normal(gen);
+
+        models::LidarModel::Vector z(target.p_x, target.p_y);
+        ukfs[t].Initialize(ukfs[t].lidar_model_, 0, z);
+        batch.SetTrack(t, ukfs[t].x_, ukfs[t].P_);
+    }
+
+    UKFBatch::TrackArray delta_t(n);
+    UKFBatch::TrackArray active(n);
+    UKFBatch::TrackMatrix z_lidar(n, 2), z_radar(n, 3);
+    UKFBatch::TrackMatrix z_pred, S;
+    double error = 0;
+    for (int frame = 1; frame <= 40; frame++) {
+        for (int t = 0; t < n; t++) {
+            long gap = 50000;
+            if (frame == 10) {
+                // 1 to 5 steps, different on every track
+                gap += 60000 * (t % 5);
+            } else if (frame == 20) {
+                gap = 400000;
+            }
+            targets[t].Move(gap * 1e-6);
+            timestamps[t] += gap;
+            delta_t(t) = gap * 1e-6;
+            ukfs[t].PredictTo(timestamps[t]);
+        }
+        batch.Prediction(delta_t);
+
+        bool radar = frame % 2 == 1;
+        if (radar) {
+            batch.PredictRadar(z_pred, S);
+        } else {
+            batch.PredictLidar(z_pred, S);
+        }
+        for (int t = 0; t < n; t++) {
+            const Target &target = targets[t];
+            active(t) = (t + frame) % 5 != 0;
+            if (radar) {
+                models::RadarModel::Vector z_expected;
+                models::RadarModel::Matrix S_expected;
+                ukfs[t].PredictMeasurement(ukfs[t].radar_model_, z_expected, S_expected);
+                for (int a = 0; a < 3; a++) {
+                    error = max(error, difference(z_pred(t, a), z_expected(a)));
+                    for (int b = 0; b < 3; b++) {
+                        error = max(error, difference(S(t, a + b * 3), S_expected(a, b)));
+                    }
+                }
+
+                double rho = sqrt(target.p_x * target.p_x + target.p_y * target.p_y);
+                z_radar(t, 0) = rho + prototype.std_radr_ * normal(gen);
+                z_radar(t, 1) = atan2(target.p_y, target.p_x) + prototype.std_radphi_ * normal(gen);
+                z_radar(t, 2) = (target.p_x * cos(target.yaw) + target.p_y * sin(target.yaw)) * target.v / rho
+                                + prototype.std_radrd_ * normal(gen);
+                if (active(t)) {
+                    models::RadarModel::Vector z(z_radar(t, 0), z_radar(t, 1), z_radar(t, 2));
+                    ukfs[t].NIS_radar_ = ukfs[t].Update(ukfs[t].radar_model_, z);
+                }
+            } else {
+                models::LidarModel::Vector z_expected;
+                models::LidarModel::Matrix S_expected;
+                ukfs[t].PredictMeasurement(ukfs[t].lidar_model_, z_expected, S_expected);
+                for (int a = 0; a < 2; a++) {
+                    error = max(error, difference(z_pred(t, a), z_expected(a)));
+                    for (int b = 0; b < 2; b++) {
+                        error = max(error, difference(S(t, a + b * 2), S_expected(a, b)));
+                    }
+                }
+
+                // std_laspx_ holds the variance
+                z_lidar(t, 0) = target.p_x + sqrt(prototype.std_laspx_) * normal(gen);
+                z_lidar(t, 1) = target.p_y + sqrt(prototype.std_laspy_) * normal(gen);
+                if (active(t)) {
+                    models::LidarModel::Vector z(z_lidar(t, 0), z_lidar(t, 1));
+                    ukfs[t].NIS_laser_ = ukfs[t].Update(ukfs[t].lidar_model_, z);
+                }
+            }
+        }
+        if (radar) {
+            batch.UpdateRadar(z_radar, active);
+        } else {
+            batch.UpdateLidar(z_lidar, active);
+        }
+
+        for (int t = 0; t < n; t++) {
+            error = max(error, difference(batch, t, ukfs[t]));
+            error = max(error, difference(batch.NIS_radar_(t), ukfs[t].NIS_radar_));
+            error = max(error, difference(batch.NIS_laser_(t), ukfs[t].NIS_laser_));
+        }
+    }
+
+    bool ok = error <= kTolerance;
+    printf("%-12s %d tracks, max difference %.1e  %s\n", name, n, error, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    bool ok = checkEquivalence("libm", 64, false);
+    ok = checkEquivalence("fast trig", 64, true) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}